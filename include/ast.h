@@ -87,7 +87,7 @@ struct ASTNode* ProgramNode_new ();
  * @brief AST variable structure
  */
 typedef struct VarDeclNode {
-    char name[MAX_ID_LEN];      /**< @brief Variable name */
+    const char* name;           /**< @brief Variable name (interned; see @ref decaf_intern) */
     DecafType type;             /**< @brief Variable type */
     bool is_array;              /**< @brief True if the variable is an array, false if it's a scalar */
     int array_length;           /**< @brief Length of array (should be 1 if not an array) */
@@ -110,7 +110,7 @@ struct ASTNode* VarDeclNode_new (const char* name, DecafType type,
  * @brief AST parameter (used in function declarations)
  */
 typedef struct Parameter {
-    char name[MAX_ID_LEN];      /**< @brief Parameter formal name */
+    const char* name;           /**< @brief Parameter formal name (interned; see @ref decaf_intern) */
     DecafType type;             /**< @brief Parameter type */
     struct Parameter* next;     /**< @brief Pointer to next parameter (if in a list) */
 } Parameter;
@@ -134,7 +134,7 @@ void ParameterList_add_new (ParameterList* list, const char* name, DecafType typ
  * @brief AST function structure
  */
 typedef struct FuncDeclNode {
-    char name[MAX_ID_LEN];      /**< @brief Function name */
+    const char* name;           /**< @brief Function name (interned; see @ref decaf_intern) */
     DecafType return_type;      /**< @brief Function return type */
     ParameterList* parameters;  /**< @brief List of formal parameters */
     struct ASTNode* body;       /**< @brief Function body block */
@@ -341,7 +341,7 @@ struct ASTNode* UnaryOpNode_new (UnaryOpType operator, struct ASTNode* child, in
  * @c index can be @c NULL for non-array locations.
  */
 typedef struct LocationNode {
-    char name[MAX_ID_LEN];      /**< @brief Location/variable name */
+    const char* name;           /**< @brief Location/variable name (interned; see @ref decaf_intern) */
     struct ASTNode* index;      /**< @brief Index expression (can be @c NULL for non-array locations) */
 } LocationNode;
 
@@ -359,7 +359,7 @@ struct ASTNode* LocationNode_new (const char* name, struct ASTNode* index, int s
  * @brief AST function call expression structure
  */
 typedef struct FuncCallNode {
-    char name[MAX_ID_LEN];      /**< @brief Function name */
+    const char* name;           /**< @brief Function name (interned; see @ref decaf_intern) */
     struct NodeList* arguments; /**< @brief List of actual parameters/arguments */
 } FuncCallNode;
 
@@ -380,7 +380,7 @@ typedef struct LiteralNode {
     union {
         int integer;                /**< @brief Integer value (if @c type is @c INT) */
         bool boolean;               /**< @brief Boolean value (if @c type is @c BOOL) */
-        char string[MAX_LINE_LEN];  /**< @brief String value (if @c type is @c STR) */
+        const char* string;         /**< @brief String value (if @c type is @c STR; interned) */
     };
 } LiteralNode;
 
@@ -426,6 +426,91 @@ typedef struct Attribute
     struct Attribute* next; /**< @brief Next attribute (if stored in a list) */
 } Attribute;
 
+/**
+ * @brief Registered attribute keys
+ *
+ * The attributes listed here are used by the middle end, so their keys are
+ * interned once into these small integer IDs and their values are stored in
+ * fixed slots rather than in the searchable attribute list. The string-keyed
+ * accessors (e.g., @ref ASTNode_get_attribute) recognize the registered keys
+ * and redirect to the corresponding slot, so both interfaces always see the
+ * same value; any other (ad-hoc) key is stored in the attribute list as
+ * before.
+ *
+ * The first @ref NUM_INLINE_ATTRIBUTE_SLOTS slots are set on every node and
+ * are stored in typed fields of the @ref ASTNode itself; the others are only
+ * set on some nodes and are stored out of line in an @ref AttributeStore.
+ *
+ * Each slot has a fixed DOT printer and destructor (e.g., symbol tables are
+ * always freed with @c SymbolTable_free), so only the value itself is stored
+ * on the node; any printer or destructor passed to the string-keyed setters
+ * for a registered key is ignored.
+ */
+typedef enum AttributeSlot {
+    TYPE_SLOT,          /**< @brief Key "type" (stored in @ref ASTNode::inferred_type) */
+    PARENT_SLOT,        /**< @brief Key "parent" (stored in @ref ASTNode::parent) */
+    DEPTH_SLOT,         /**< @brief Key "depth" (stored in @ref ASTNode::depth) */
+    SYMBOL_TABLE_SLOT,  /**< @brief Key "symbolTable" */
+    DOTID_SLOT,         /**< @brief Key "dotid" */
+    SYMBOL_SLOT,        /**< @brief Key "symbol" (resolved @c Symbol* for locations, calls, and returns) */
+    CONSTANT_SLOT,      /**< @brief Key "constant" (folded value of constant expressions) */
+    NUM_ATTRIBUTE_SLOTS
+} AttributeSlot;
+
+/**
+ * @brief Number of registered attributes stored directly on each @ref ASTNode
+ */
+#define NUM_INLINE_ATTRIBUTE_SLOTS (DEPTH_SLOT + 1)
+
+/**
+ * @brief Bit set of the slots that have a value (bit @c (1<<slot) per slot)
+ *
+ * Widen this type before registering more slots than it has bits.
+ */
+typedef uint8_t AttributeSlotMask;
+
+_Static_assert(NUM_ATTRIBUTE_SLOTS <= 8 * sizeof(AttributeSlotMask),
+               "too many attribute slots for AttributeSlotMask");
+
+/**
+ * @brief Returned by @ref AttributeSlot_from_key for keys that are not registered
+ */
+#define NO_ATTRIBUTE_SLOT -1
+
+/**
+ * @brief Out-of-line attributes of an AST node
+ *
+ * Holds the ad-hoc attribute list and the registered attributes that are not
+ * stored inline (see @ref AttributeSlot). It is allocated the first time one
+ * of them is set, so most nodes never have one.
+ */
+typedef struct AttributeStore
+{
+    Attribute* list;        /**< @brief Ad-hoc attribute list (not a formal list because of
+                                        the provided accessor methods) */
+    void* slots[NUM_ATTRIBUTE_SLOTS - NUM_INLINE_ATTRIBUTE_SLOTS];
+                            /**< @brief Values of out-of-line registered attributes, indexed by
+                                        @ref AttributeSlot minus @ref NUM_INLINE_ATTRIBUTE_SLOTS */
+    AttributeSlotMask slot_mask;    /**< @brief Bit @c (1<<slot) is set if the slot has a value */
+} AttributeStore;
+
+/**
+ * @brief Look up the interned slot ID for an attribute key
+ *
+ * @param key Attribute key
+ * @returns The @ref AttributeSlot for the key or @ref NO_ATTRIBUTE_SLOT if the
+ * key is not registered
+ */
+int AttributeSlot_from_key (const char* key);
+
+/**
+ * @brief Return the attribute key of a registered slot
+ *
+ * @param slot Registered attribute ID
+ * @returns Attribute key (a static string)
+ */
+const char* AttributeSlot_to_key (AttributeSlot slot);
+
 /**
  * @brief Main AST node structure
  *
@@ -455,21 +540,43 @@ typedef struct Attribute
  * initialized correctly. Node structures must be explicitly freed using @ref
  * ASTNode_free.
  * 
+ * The @c type, @c symbolTable, @c parent, @c depth, @c dotid, @c symbol, and
+ * @c constant keys are registered (see @ref AttributeSlot) and are stored in
+ * slots instead of the attribute list. The @c type, @c parent, and @c depth
+ * attributes are read on almost every node, so they are the dedicated typed
+ * fields @c inferred_type, @c parent, and @c depth, which the attributes are
+ * views of; everything else lives in the node's @ref AttributeStore.
+ *
+ * Nodes are kept small so that whole trees stay cache-resident across the
+ * analysis passes: names and string literals are interned (see @ref
+ * decaf_intern) rather than stored inline, so the node-specific union is only
+ * a few pointers wide, and each node is allocated with only as much of the
+ * union as its type needs (so the union must stay the last member). Most
+ * expression nodes take 56 bytes.
+ *
  * Methods:
  * - @ref ASTNode_set_attribute
  * - @ref ASTNode_set_int_attribute
  * - @ref ASTNode_set_printable_attribute
  * - @ref ASTNode_has_attribute
  * - @ref ASTNode_get_attribute
+ * - @ref ASTNode_set_slot_attribute
+ * - @ref ASTNode_has_slot_attribute
+ * - @ref ASTNode_get_slot_attribute
  */
 typedef struct ASTNode
 {
     NodeType type;          /**< @brief Node type (discriminator/tag for the anonymous union) */
     int source_line;        /**< @brief Source code line number */
-    Attribute* attributes;  /**< @brief Attribute list (not a formal list because of the provided accessor methods) */
+    struct AttributeStore* attributes;  /**< @brief Out-of-line attributes (@c NULL if none) */
     struct ASTNode* next;   /**< @brief Next node (if stored in a list) */
+    struct ASTNode* parent; /**< @brief Uptree parent (the "parent" attribute; @c NULL if not set) */
+    DecafType inferred_type;/**< @brief Inferred type of an expression (the "type" attribute;
+                                        @c UNKNOWN if not yet inferred) */
+    int depth;              /**< @brief Tree depth (the "depth" attribute; -1 if not set) */
 
-    /* anonymous union of type-specific node data (C polymorphism) */
+    /* anonymous union of type-specific node data (C polymorphism); must be
+     * last because nodes are allocated without the unused tail of the union */
     union {
         struct ProgramNode program;
         struct VarDeclNode vardecl;
@@ -487,10 +594,47 @@ typedef struct ASTNode
     };
 } ASTNode;
 
-/*
- * Declare NodeList to be a linked list of ASTNode* elements.
+/**
+ * @brief List of ASTNode* elements
+ *
+ * The elements are stored in a contiguous array (for random access and
+ * traversal locality), and are also linked in order through their @c next
+ * pointers so that the list works with @ref FOR_EACH like the other list
+ * types. Elements must only be added using @ref NodeList_add.
+ */
+typedef struct NodeList {
+    struct ASTNode* head;   /**< @brief First element in list (or @c NULL if empty) */
+    struct ASTNode* tail;   /**< @brief Last element in list (or @c NULL if empty) */
+    int size;               /**< @brief Number of elements in list */
+    int capacity;           /**< @brief Allocated length of @c items */
+    struct ASTNode** items; /**< @brief Elements (in order) */
+} NodeList;
+
+/** @brief Allocate and initialize a new, empty list. */
+NodeList* NodeList_new ();
+
+/** @brief Add an item to the end of a list. */
+void NodeList_add (NodeList* list, struct ASTNode* item);
+
+/** @brief Look up the size of a list. */
+int NodeList_size (NodeList* list);
+
+/** @brief Test a list to see if it is empty. */
+bool NodeList_is_empty (NodeList* list);
+
+/**
+ * @brief Look up an element of a list by position
+ *
+ * @param list List to read
+ * @param index Position of element (must be less than the size of the list)
  */
-DECL_LIST_TYPE(Node, struct ASTNode*)
+static inline struct ASTNode* NodeList_get (NodeList* list, int index)
+{
+    return list->items[index];
+}
+
+/** @brief Deallocate a list and any contained items. */
+void NodeList_free (NodeList* list);
 
 /**
  * @brief Allocate a new AST node.
@@ -590,11 +734,109 @@ void* ASTNode_get_attribute (ASTNode* node, const char* key);
  */
 int ASTNode_get_int_attribute (ASTNode* node, const char* key);
 
+/**
+ * @brief Add or change a registered attribute for an AST node
+ *
+ * This is the interned-key equivalent of @ref ASTNode_set_printable_attribute;
+ * no key comparisons are necessary. The DOT printer and destructor are
+ * determined by the slot (see @ref AttributeSlot).
+ *
+ * @param node Node to add the attribute to
+ * @param slot Registered attribute ID
+ * @param value Attribute value (may be a pointer)
+ */
+void ASTNode_set_slot_attribute (ASTNode* node, AttributeSlot slot, void* value);
+
+/**
+ * @brief Add or change a registered integer attribute for an AST node
+ *
+ * @param node Node to add the attribute to
+ * @param slot Registered attribute ID
+ * @param value Attribute value
+ */
+void ASTNode_set_int_slot_attribute (ASTNode* node, AttributeSlot slot, int value);
+
+/**
+ * @brief Set the inferred type of an expression node
+ *
+ * Equivalent to setting the "type" attribute (@ref TYPE_SLOT); read it back
+ * directly from @ref ASTNode::inferred_type.
+ *
+ * @param node Node to annotate
+ * @param type Inferred type
+ */
+void ASTNode_set_inferred_type (ASTNode* node, DecafType type);
+
+/**
+ * @brief Check to see if a node has a particular registered attribute
+ *
+ * The inline attributes (@c type, @c parent, and @c depth) are present
+ * whenever their field holds something other than its "not set" value, so,
+ * e.g., a node whose inferred type is @c UNKNOWN has no "type" attribute.
+ *
+ * @param node Node to check
+ * @param slot Registered attribute ID
+ * @returns True if the node has the requested attribute, false if not
+ */
+bool ASTNode_has_slot_attribute (ASTNode* node, AttributeSlot slot);
+
+/**
+ * @brief Retrieve a particular registered attribute from a node
+ *
+ * @param node Node to access
+ * @param slot Registered attribute ID
+ * @returns Attribute value
+ */
+void* ASTNode_get_slot_attribute (ASTNode* node, AttributeSlot slot);
+
+/**
+ * @brief Retrieve a particular registered integer attribute from a node
+ *
+ * @param node Node to access
+ * @param slot Registered attribute ID
+ * @returns Attribute value
+ */
+int ASTNode_get_int_slot_attribute (ASTNode* node, AttributeSlot slot);
+
+/**
+ * @brief Print the value of a registered attribute in DOT graph format
+ *
+ * @param node Node to access (must have the attribute)
+ * @param slot Registered attribute ID
+ * @param output Output stream
+ */
+void ASTNode_print_slot_attribute (ASTNode* node, AttributeSlot slot, FILE* output);
+
+/**
+ * @brief Counts of attribute accesses made by a thread (reported by --stats)
+ */
+typedef struct AttributeStats
+{
+    unsigned long slot_lookups;     /**< @brief Registered attribute checks and reads (including
+                                                string-keyed accesses redirected to a slot) */
+    unsigned long keyed_lookups;    /**< @brief String-keyed attribute checks and reads */
+} AttributeStats;
+
+/**
+ * @brief Attribute access counts for the current thread (only updated while
+ * @ref attribute_stats_enabled is set)
+ */
+extern _Thread_local AttributeStats attribute_stats;
+
+/**
+ * @brief True if attribute accesses on the current thread should be counted
+ * in @ref attribute_stats (off by default, so the accessors only pay for a
+ * single check)
+ */
+extern _Thread_local bool attribute_stats_enabled;
+
 /**
  * @brief Deallocate an AST node structure
  * 
- * This will recursively free any children, so it is sufficient to free the
- * root of a tree in order to free the entire tree.
+ * This will also free any children, so it is sufficient to free the root of a
+ * tree in order to free the entire tree. The tree is walked iteratively (no
+ * recursion), so arbitrarily deep trees can be freed. If an @ref Arena is
+ * current, this does nothing (the tree will be released with the arena).
  * 
  * It is highly recommended that you subsequently set the pointer to @c NULL so
  * that you do not unintentionally dereference an invalid pointer.
@@ -26,16 +26,12 @@
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/**
- * @brief Maximum size (in bytes) of any Decaf source file
- */
-#define MAX_FILE_SIZE 65536
-
 /**
  * @brief Maximum length (in characters) of any single line of input
  */
@@ -83,19 +79,56 @@ const char* DecafType_to_string(DecafType type);
  */
 void print_escaped_string(const char* string, FILE* output);
 
+/**
+ * @brief Compute a 32-bit FNV-1a hash of a null-terminated string
+ *
+ * Used for the symbol table index and anywhere else that needs a fast,
+ * deterministic string hash.
+ *
+ * @param string String to hash
+ * @returns Hash value (never depends on anything but the string contents)
+ */
+uint32_t hash_string(const char* string);
+
+/**
+ * @brief Initial value for @ref hash_bytes (the 64-bit FNV offset basis)
+ */
+#define HASH_SEED 14695981039346656037ull
+
+/**
+ * @brief Mix a block of bytes into a running 64-bit FNV-1a hash
+ *
+ * Start with @ref HASH_SEED (or any other value, to obtain a different hash
+ * function) and chain calls to hash several blocks.
+ *
+ * @param hash Running hash value
+ * @param bytes Bytes to hash
+ * @param len Number of bytes
+ * @returns Updated hash value
+ */
+uint64_t hash_bytes(uint64_t hash, const void* bytes, size_t len);
+
+/**
+ * @brief Data structure used by @c setjmp / @c longjmp for exception handling
+ *
+ * Code that might throw an exception (i.e., the lexing and parsing phases)
+ * must be wrapped in a @c setjmp block on this buffer. Each thread has its own
+ * copy so that files can be compiled concurrently.
+ */
+extern _Thread_local jmp_buf decaf_error;
+
+/**
+ * @brief Message of the most recent exception on the current thread
+ */
+extern _Thread_local char decaf_error_msg[MAX_ERROR_LEN];
+
 /**
  * @brief Throw an exception with an error message using @c printf syntax
  *
  * This function uses the @c longjmp functionality in the standard C library to
- * implement exception handling for the lexing and parsing phases. The code
- * that might throw an exception must be wrapped in a @c setjmp block.
- *
- * Because this function must have access to the @c jmp_buf used to connect the
- * @c setjmp callsite with the @c longjmp, this function must be implemented in
- * the compiler or test driver (where the @c setjmp call will be) in other to
- * avoid having an @c extern static variable. Thus, there is no implementation
- * in @c common.c, and it is only declared here so that it can be called in the
- * various front end phases of compilation.
+ * implement exception handling for the lexing and parsing phases. The message
+ * is stored in @ref decaf_error_msg and control returns to the most recent
+ * @c setjmp on @ref decaf_error.
  */
 void Error_throw_printf (const char* format, ...);
 
@@ -110,6 +143,290 @@ void Error_throw_printf (const char* format, ...);
         exit(EXIT_FAILURE); \
     }
 
+/**
+ * @brief Default size (in bytes) of each chunk allocated by an @ref Arena
+ */
+#define ARENA_CHUNK_SIZE 65536
+
+/**
+ * @brief Single chunk of arena memory (chunks form a singly-linked list)
+ */
+typedef struct ArenaChunk
+{
+    struct ArenaChunk* next;    /**< @brief Previously-filled chunk (or @c NULL) */
+    size_t size;                /**< @brief Usable size (in bytes) of this chunk */
+    size_t used;                /**< @brief Number of bytes handed out so far */
+} ArenaChunk;
+
+/**
+ * @brief Set of interned strings (open addressing with linear probing)
+ *
+ * Each distinct string is stored exactly once, so interned strings can be
+ * shared freely and (if necessary) compared by pointer.
+ */
+typedef struct StringPool
+{
+    const char** entries;   /**< @brief Power-of-two sized array of interned strings
+                                        (@c NULL for empty slots) */
+    int capacity;           /**< @brief Number of slots in @c entries */
+    int size;               /**< @brief Number of interned strings */
+} StringPool;
+
+/**
+ * @brief Bump allocator for data that lives as long as a single compilation
+ *
+ * Allocations are carved sequentially out of large zero-initialized chunks;
+ * when a chunk fills up, a new one is added. Individual allocations are never
+ * freed; instead, the whole arena is released at once with @ref Arena_free (or
+ * cleared for reuse with @ref Arena_reset).
+ *
+ * Most compiler data structures (AST nodes, attributes, parameters, lists,
+ * symbols, symbol tables, and errors) are allocated with @ref decaf_calloc,
+ * which uses the current thread's arena if one has been installed with
+ * @ref Arena_set_current and the regular heap otherwise. While an arena is
+ * current, @ref decaf_free is a no-op and @c ASTNode_free returns immediately.
+ */
+typedef struct Arena
+{
+    ArenaChunk* head;       /**< @brief Chunk currently being filled */
+    ArenaChunk* spare;      /**< @brief Cleared chunks kept by @ref Arena_reset (used before
+                                        allocating new ones) */
+    size_t total_bytes;     /**< @brief Total number of bytes allocated (for statistics) */
+    StringPool strings;     /**< @brief Strings interned in this arena (see @ref Arena_intern) */
+} Arena;
+
+/**
+ * @brief Allocate a new, empty arena
+ */
+Arena* Arena_new ();
+
+/**
+ * @brief Allocate zero-initialized memory from an arena
+ *
+ * @param arena Arena to allocate from
+ * @param size Number of bytes requested
+ * @returns Pointer to the allocated memory (suitably aligned for any type)
+ */
+void* Arena_alloc (Arena* arena, size_t size);
+
+/**
+ * @brief Intern a string in an arena's string pool
+ *
+ * @param arena Arena to allocate from
+ * @param string String to intern
+ * @returns Pointer to the unique arena-owned copy of the string
+ */
+const char* Arena_intern (Arena* arena, const char* string);
+
+/**
+ * @brief Release everything that was allocated from an arena, but keep its
+ * memory for reuse
+ *
+ * Regular-sized chunks are cleared and kept for subsequent allocations (so a
+ * reset arena doesn't need to allocate again until it grows beyond its
+ * previous size); oversized chunks and the string pool are released.
+ */
+void Arena_reset (Arena* arena);
+
+/**
+ * @brief Deallocate an arena and everything that was allocated from it
+ */
+void Arena_free (Arena* arena);
+
+/**
+ * @brief Move everything that was allocated from one arena into another and
+ * deallocate the first one
+ *
+ * The allocations stay where they are and are released along with @p arena.
+ * Strings interned in @p other remain valid, but they are no longer in any
+ * string pool.
+ *
+ * @param arena Arena that takes ownership of the allocations
+ * @param other Arena to empty and deallocate (must not be current on any thread)
+ */
+void Arena_adopt (Arena* arena, Arena* other);
+
+/**
+ * @brief Install an arena as the allocation target for the current thread
+ *
+ * @param arena Arena to use (or @c NULL to go back to the regular heap)
+ */
+void Arena_set_current (Arena* arena);
+
+/**
+ * @brief Retrieve the current thread's arena (or @c NULL if there is none)
+ */
+Arena* Arena_current ();
+
+/**
+ * @brief Allocate zero-initialized memory from the current arena or the heap
+ *
+ * Drop-in replacement for @c calloc that is used by all of the compiler data
+ * structures that can be released in bulk.
+ */
+void* decaf_calloc (size_t count, size_t size);
+
+#ifdef DECAF_PROFILE
+/**
+ * @brief Version of @ref decaf_calloc that records its call site (profiling
+ * builds only; every call to @ref decaf_calloc is redirected here)
+ */
+void* decaf_calloc_at (size_t count, size_t size, const char* file, int line);
+#define decaf_calloc(COUNT, SIZE) decaf_calloc_at(COUNT, SIZE, __FILE__, __LINE__)
+#endif
+
+/**
+ * @brief Store a copy of a string for use by compiler data structures
+ *
+ * If an arena is current, the string is interned in its pool (see @ref
+ * Arena_intern); otherwise, a private heap copy is returned. Either way, the
+ * result must be treated as immutable and released with @ref decaf_free.
+ */
+const char* decaf_intern (const char* string);
+
+/**
+ * @brief Release memory allocated by @ref decaf_calloc
+ *
+ * Does nothing if an arena is current (the memory will be released with the
+ * arena).
+ */
+void decaf_free (void* ptr);
+
+/**
+ * @brief Contents of a Decaf source file
+ *
+ * Regular files are memory-mapped when possible; anything else (pipes,
+ * standard input, or files whose size is an exact multiple of the page size)
+ * is read into a heap buffer with a single bulk read. Either way, the text is
+ * NUL-terminated so that it can be handed directly to the lexer, and there is
+ * no limit on its size (other than available memory).
+ */
+typedef struct SourceText
+{
+    char* text;             /**< @brief File contents (NUL-terminated; private to this
+                                            structure, so it may be modified) */
+    size_t length;          /**< @brief Number of characters in @c text (not including the NUL) */
+    size_t mapped_length;   /**< @brief Length of the memory mapping (0 if @c text is on the heap) */
+} SourceText;
+
+/**
+ * @brief Read the entire contents of a source file
+ *
+ * @param filename Name of file to read (or "-" for standard input)
+ * @param source Structure to fill in
+ * @returns True if and only if the file read was successful.
+ */
+bool SourceText_read (const char* filename, SourceText* source);
+
+/**
+ * @brief Release the contents of a source file read by @ref SourceText_read
+ *
+ * @param source Structure to release (the structure itself is not freed)
+ */
+void SourceText_free (SourceText* source);
+
+/**
+ * @brief Size (in bytes) at which an @ref OutputBuffer writes its contents
+ */
+#define OUTPUT_BUFFER_FLUSH_SIZE 65536
+
+/**
+ * @brief Growable buffer that collects many small writes to a stream
+ *
+ * Text is appended to a heap buffer and written to the stream with a single
+ * @c fwrite whenever the buffer grows past @ref OUTPUT_BUFFER_FLUSH_SIZE (and
+ * when the buffer is flushed or freed), so the cost of stream I/O doesn't
+ * depend on how finely the output is formatted.
+ */
+typedef struct OutputBuffer
+{
+    FILE* output;           /**< @brief Stream that receives the buffered text */
+    char* data;             /**< @brief Buffered text (not NUL-terminated) */
+    size_t size;            /**< @brief Number of buffered characters */
+    size_t capacity;        /**< @brief Allocated length of @c data */
+} OutputBuffer;
+
+/**
+ * @brief Allocate a new, empty output buffer
+ *
+ * @param output Stream that receives the buffered text
+ */
+OutputBuffer* OutputBuffer_new (FILE* output);
+
+/**
+ * @brief Append text to an output buffer
+ *
+ * @param buffer Buffer to append to
+ * @param text Text to append (not necessarily NUL-terminated)
+ * @param len Number of characters to append
+ */
+void OutputBuffer_write (OutputBuffer* buffer, const char* text, size_t len);
+
+/**
+ * @brief Append a NUL-terminated string to an output buffer
+ */
+void OutputBuffer_puts (OutputBuffer* buffer, const char* text);
+
+/**
+ * @brief Append the decimal representation of an integer to an output buffer
+ * (faster than @ref OutputBuffer_printf)
+ */
+void OutputBuffer_put_int (OutputBuffer* buffer, long value);
+
+/**
+ * @brief Append formatted text to an output buffer using @c printf syntax
+ */
+void OutputBuffer_printf (OutputBuffer* buffer, const char* format, ...);
+
+/**
+ * @brief Write all buffered text to the stream
+ */
+void OutputBuffer_flush (OutputBuffer* buffer);
+
+/**
+ * @brief Flush and deallocate an output buffer (the stream is not closed)
+ */
+void OutputBuffer_free (OutputBuffer* buffer);
+
+/*
+ * PROFILING COUNTERS (make PROFILE=1)
+ */
+
+#ifdef DECAF_PROFILE
+
+/**
+ * @brief Record one event at an instrumented site (profiling builds only)
+ *
+ * Events are aggregated per (category, site, line) triple; for each one, the
+ * report lists the number of events and the total and average of their
+ * amounts (e.g., bytes allocated or list positions scanned). The report is
+ * printed on standard error when the process exits. Safe to call from any
+ * thread.
+ *
+ * @param category Kind of event (must be a string literal)
+ * @param site Name of the instrumented site (copied, so it may be transient)
+ * @param line Source line of the site (or 0 if not applicable)
+ * @param amount Quantity associated with the event
+ */
+void profile_record (const char* category, const char* site, int line, unsigned long amount);
+
+/**
+ * @brief Record an event with an amount (compiles to nothing unless the
+ * compiler is built with <tt>make PROFILE=1</tt>)
+ */
+#define PROFILE_RECORD(CATEGORY, SITE, LINE, AMOUNT) profile_record(CATEGORY, SITE, LINE, AMOUNT)
+
+#else
+
+#define PROFILE_RECORD(CATEGORY, SITE, LINE, AMOUNT) ((void)0)
+
+#endif
+
+/**
+ * @brief Count an event (see @ref PROFILE_RECORD)
+ */
+#define PROFILE_COUNT(CATEGORY, SITE) PROFILE_RECORD(CATEGORY, SITE, 0, 0)
+
 /**
  * @brief Declare a singly-linked list structure of the given type
  * 
@@ -158,7 +475,7 @@ void Error_throw_printf (const char* format, ...);
 #define DEF_LIST_IMPL(NAME, ELEMTYPE, FREEFUNC) \
     NAME ## List* NAME ## List_new () \
     { \
-        NAME ## List* list = (NAME ## List*)calloc(1, sizeof(NAME ## List)); \
+        NAME ## List* list = (NAME ## List*)decaf_calloc(1, sizeof(NAME ## List)); \
         CHECK_MALLOC_PTR(list); \
         list->head = NULL; \
         list->tail = NULL; \
@@ -192,7 +509,7 @@ void Error_throw_printf (const char* format, ...);
             next = cur->next; \
             FREEFUNC(cur); \
         } \
-        free(list); \
+        decaf_free(list); \
     }
 
 /**
@@ -0,0 +1,133 @@
+/**
+ * @file decaf.h
+ * @brief Library interface for embedding the compiler
+ *
+ * A @ref DecafContext runs the whole front end and analysis on a string of
+ * Decaf source code without touching the process (no files, no output
+ * streams, and no @c exit). Everything a compilation allocates (AST, symbol
+ * tables, interned strings, and errors) lives in the context's arena, which is
+ * cleared but not released between compilations, so compiling many small
+ * programs with the same context reuses the same memory.
+ *
+ * A context must only be used by one thread at a time, but different threads
+ * can use different contexts concurrently. Results (the tree and the errors)
+ * remain valid until the next compilation, @ref DecafContext_reset, or @ref
+ * DecafContext_free.
+ *
+ * Example:
+ *
+ * @code
+ * DecafContext* ctx = DecafContext_new(ALL_ERRORS);
+ * if (!DecafContext_compile_string(ctx, "def int main() { return 0; }")) {
+ *     if (DecafContext_get_fatal_error(ctx) != NULL) {
+ *         printf("%s", DecafContext_get_fatal_error(ctx));
+ *     } else {
+ *         ErrorList_print(DecafContext_get_errors(ctx), stdout);
+ *     }
+ * }
+ * DecafContext_free(ctx);
+ * @endcode
+ */
+
+#ifndef __DECAF_H
+#define __DECAF_H
+
+#include "common.h"
+#include "ast.h"
+#include "symbol.h"
+
+/**
+ * @brief Reusable compilation context
+ */
+typedef struct DecafContext
+{
+    /**
+     * @brief Arena that owns all data from the current compilation
+     */
+    Arena* arena;
+
+    /**
+     * @brief Mode for recording analysis errors
+     */
+    ErrorMode error_mode;
+
+    /**
+     * @brief Analyzed AST from the last compilation (or @c NULL if there was a
+     * fatal error or no compilation yet)
+     */
+    ASTNode* tree;
+
+    /**
+     * @brief Analysis errors from the last compilation (or @c NULL if the
+     * analysis didn't run)
+     */
+    ErrorList* errors;
+
+    /**
+     * @brief True if the front end reported a fatal (lexer or parser) error
+     */
+    bool has_fatal_error;
+
+    /**
+     * @brief Message of the fatal error (only valid if @c has_fatal_error is set)
+     */
+    char fatal_error[MAX_ERROR_LEN];
+
+} DecafContext;
+
+/**
+ * @brief Allocate a new compilation context
+ *
+ * @param mode Which analysis errors to record (see @ref ErrorMode)
+ * @returns Pointer to new context
+ */
+DecafContext* DecafContext_new (ErrorMode mode);
+
+/**
+ * @brief Compile a program (discarding the results of any previous compilation)
+ *
+ * Fatal front end errors are caught and stored in the context (see @ref
+ * DecafContext_get_fatal_error) instead of being propagated to the caller.
+ * The caller's current arena and exception handler are restored before this
+ * function returns.
+ *
+ * @param context Context to compile in
+ * @param text Source code (must be NUL-terminated; not retained)
+ * @returns True if and only if the program compiled with no errors
+ */
+bool DecafContext_compile_string (DecafContext* context, const char* text);
+
+/**
+ * @brief Retrieve the analysis errors from the last compilation
+ *
+ * @returns Error list (or @c NULL if the analysis didn't run because of a
+ * fatal error)
+ */
+ErrorList* DecafContext_get_errors (DecafContext* context);
+
+/**
+ * @brief Retrieve the fatal error message from the last compilation
+ *
+ * @returns Error message (or @c NULL if the front end succeeded)
+ */
+const char* DecafContext_get_fatal_error (DecafContext* context);
+
+/**
+ * @brief Retrieve the analyzed AST from the last compilation
+ *
+ * @returns Root of AST (or @c NULL if there was a fatal error)
+ */
+ASTNode* DecafContext_get_tree (DecafContext* context);
+
+/**
+ * @brief Discard the results of the last compilation, keeping the context's
+ * memory for reuse
+ */
+void DecafContext_reset (DecafContext* context);
+
+/**
+ * @brief Deallocate a context and all of its results
+ */
+void DecafContext_free (DecafContext* context);
+
+#endif
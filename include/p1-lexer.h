@@ -15,6 +15,20 @@
  * @param text String to lex
  * @returns Newly-created queue of tokens
  */
-TokenQueue* lex(char* text);
+TokenQueue* lex(const char* text);
+
+/**
+ * @brief Create a streaming queue that lexes a Decaf program on demand.
+ *
+ * Tokens are produced as they are requested (e.g., by the parser) and the
+ * storage of consumed tokens is recycled, so only a small window of tokens is
+ * in memory at any time. The text must remain valid until the queue is
+ * deallocated. Lexical errors are reported when the offending token is
+ * reached; unlike @ref lex, the queue is not deallocated when that happens.
+ *
+ * @param text String to lex
+ * @returns Newly-created streaming queue of tokens
+ */
+TokenQueue* lex_stream(const char* text);
 
 #endif
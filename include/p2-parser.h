@@ -14,6 +14,11 @@
 /**
  * @brief Convert a queue of tokens into an abstract syntax tree (AST)
  *
+ * Errors are reported using @ref Error_throw_printf. If @p input is a
+ * streaming queue (see @ref lex_stream), a lexical error anywhere in the input
+ * is reported instead of any syntax error, just as if the input had been lexed
+ * in full before parsing.
+ *
  * @param input Tokens to parse
  * @returns Root of abstract syntax tree
  */
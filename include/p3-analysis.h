@@ -21,4 +21,99 @@
  */
 ErrorList* analyze (ASTNode* tree);
 
+/**
+ * @brief Perform static analysis on an AST, recording errors in the given mode
+ *
+ * The whole tree is still analyzed (and annotated) in every mode; the mode
+ * only controls how many errors are kept (see @ref ErrorMode). Use @ref
+ * FIRST_ERROR_ONLY or @ref COUNT_ERRORS_ONLY when only the presence or the
+ * number of errors matters.
+ *
+ * @param tree Root of AST
+ * @param mode Which errors to record
+ * @returns List of static analysis errors found
+ */
+ErrorList* analyze_with_mode (ASTNode* tree, ErrorMode mode);
+
+/**
+ * @brief Cached analysis result for a single function
+ */
+typedef struct CachedFunction
+{
+    char* name;             /**< @brief Function name (or @c NULL for an empty slot) */
+    uint64_t key;           /**< @brief Hash of the declaration and the global signatures it depends on */
+    int message_count;      /**< @brief Number of error messages */
+    char* messages;         /**< @brief Error messages (each NUL-terminated, stored back-to-back) */
+    size_t messages_length; /**< @brief Total length of @c messages (in bytes) */
+    bool in_while_after;    /**< @brief Whether the analysis was "in a while loop" after the
+                                        function (this state carries over to later functions) */
+} CachedFunction;
+
+/**
+ * @brief Per-function analysis results carried from one analysis to the next
+ *
+ * Allocate with @ref AnalysisCache_new and de-allocate with @ref
+ * AnalysisCache_free. The cache is independent of any @ref Arena, so it can
+ * outlive the ASTs it was built from.
+ */
+typedef struct AnalysisCache
+{
+    CachedFunction* entries;    /**< @brief Power-of-two sized hash table (open addressing) */
+    int capacity;               /**< @brief Number of slots in @c entries */
+    int size;                   /**< @brief Number of occupied slots */
+    int hits;                   /**< @brief Functions reused by the last analysis */
+    int misses;                 /**< @brief Functions re-analyzed by the last analysis */
+} AnalysisCache;
+
+/**
+ * @brief Allocate a new, empty analysis cache
+ */
+AnalysisCache* AnalysisCache_new ();
+
+/**
+ * @brief Deallocate an analysis cache
+ */
+void AnalysisCache_free (AnalysisCache* cache);
+
+/**
+ * @brief Perform static analysis on an AST, reusing cached per-function results
+ *
+ * Each function is keyed on a hash of its entire declaration and of the
+ * signatures of the program-level names (global variables and callees) it
+ * refers to, and on the loop state it is analyzed in (whether a loop was seen
+ * earlier in the program, which decides whether @c break and @c continue are
+ * accepted). Functions whose key matches the cache are not re-analyzed; their
+ * cached errors are reported instead. Global variables and the program-level
+ * checks are always re-analyzed. The cache is updated to describe this tree
+ * (entries for functions that no longer exist are dropped).
+ *
+ * The errors reported (and their order) are the same as for @ref analyze, but
+ * nodes inside reused functions are not annotated with inferred types or
+ * resolved symbols. Symbol tables must already have been built.
+ *
+ * @param tree Root of AST
+ * @param cache Results of previous analyses (updated)
+ * @returns List of static analysis errors found
+ */
+ErrorList* analyze_incremental (ASTNode* tree, AnalysisCache* cache);
+
+/**
+ * @brief Perform static analysis on an AST, analyzing functions concurrently
+ *
+ * Once the symbol tables are built, each function can be analyzed
+ * independently, so up to @c num_threads threads (including the calling
+ * thread) claim functions from the program one at a time and analyze them
+ * with their own analysis state and error lists. Global variables and the
+ * program-level checks are analyzed on the calling thread. The errors
+ * reported (and their order) and the annotations on the tree are the same as
+ * for @ref analyze_with_mode.
+ *
+ * @param tree Root of AST
+ * @param num_threads Maximum number of threads (1 analyzes on the calling
+ * thread only)
+ * @param mode Which errors to record
+ * @returns List of static analysis errors found
+ */
+ErrorList* analyze_parallel (ASTNode* tree, int num_threads, ErrorMode mode);
+
 #endif
@@ -0,0 +1,199 @@
+/**
+ * @file serialize.h
+ * @brief Binary AST file format
+ *
+ * An analyzed AST (including its inferred types, symbol tables, and resolved
+ * symbols) can be saved in a compact binary format and reloaded later without
+ * running the front end or the analysis again.
+ *
+ * The file is a fixed-size @ref ASTFileHeader followed by flat arrays of
+ * fixed-size records. Sections are located by byte offsets relative to the
+ * start of the file and records refer to each other by index, so the file can
+ * be mapped into memory and read in place (e.g., by downstream tools that
+ * include this header) with no pointer fixups. All integers are stored in the
+ * byte order of the machine that wrote the file (see @ref
+ * AST_FILE_BYTE_ORDER).
+ *
+ * Nodes are stored in pre-order, so every child has a larger index than its
+ * parent and node 0 is the program root. Fields that refer to another record
+ * hold the index of that record plus one, with @ref AST_FILE_NONE (0) meaning
+ * "no record"; fields that refer to strings hold byte offsets into the string
+ * section, which is a sequence of NUL-terminated strings.
+ *
+ * Only the registered @c type, @c symbolTable, and @c symbol attributes are
+ * saved; @c parent and @c depth are recomputed when the tree is loaded.
+ */
+
+#ifndef __SERIALIZE_H
+#define __SERIALIZE_H
+
+#include "ast.h"
+#include "symbol.h"
+
+/**
+ * @brief Magic bytes at the start of every binary AST file
+ */
+#define AST_FILE_MAGIC "DECAFAST"
+
+/**
+ * @brief Current version of the binary AST file format
+ */
+#define AST_FILE_VERSION 1
+
+/**
+ * @brief Byte order marker (reads back differently on a machine with a
+ * different byte order)
+ */
+#define AST_FILE_BYTE_ORDER 0x01020304u
+
+/**
+ * @brief Reference value meaning "no record"
+ */
+#define AST_FILE_NONE 0
+
+/**
+ * @brief Binary AST file header
+ */
+typedef struct ASTFileHeader
+{
+    char magic[8];              /**< @brief @ref AST_FILE_MAGIC (not NUL-terminated) */
+    uint32_t version;           /**< @brief @ref AST_FILE_VERSION */
+    uint32_t byte_order;        /**< @brief @ref AST_FILE_BYTE_ORDER */
+    uint32_t node_count;        /**< @brief Number of @ref ASTFileNode records */
+    uint32_t node_offset;       /**< @brief Offset of the node section */
+    uint32_t param_count;       /**< @brief Number of @ref ASTFileParameter records */
+    uint32_t param_offset;      /**< @brief Offset of the parameter section */
+    uint32_t table_count;       /**< @brief Number of @ref ASTFileSymbolTable records */
+    uint32_t table_offset;      /**< @brief Offset of the symbol table section */
+    uint32_t symbol_count;      /**< @brief Number of @ref ASTFileSymbol records */
+    uint32_t symbol_offset;     /**< @brief Offset of the symbol section */
+    uint32_t string_size;       /**< @brief Size (in bytes) of the string section */
+    uint32_t string_offset;     /**< @brief Offset of the string section */
+} ASTFileHeader;
+
+/**
+ * @brief Flags in @ref ASTFileNode::attributes (which attributes are present)
+ */
+#define AST_FILE_HAS_TYPE           0x1
+#define AST_FILE_HAS_SYMBOL_TABLE   0x2
+#define AST_FILE_HAS_SYMBOL         0x4
+
+/**
+ * @brief Number of type-specific fields in an @ref ASTFileNode
+ */
+#define AST_FILE_NODE_FIELDS 5
+
+/**
+ * @brief Binary AST node record
+ *
+ * The meaning of @c fields depends on the node type ("node" and "list" are
+ * node references, "param" is a parameter index, and "string" is a string
+ * offset):
+ *
+ * <table border="1">
+ * <tr><th>Type</th><th>0</th><th>1</th><th>2</th><th>3</th><th>4</th></tr>
+ * <tr><td>@c PROGRAM</td><td>variables (list)</td><td>functions (list)</td><td></td><td></td><td></td></tr>
+ * <tr><td>@c VARDECL</td><td>name (string)</td><td>type</td><td>is_array</td><td>array_length</td><td></td></tr>
+ * <tr><td>@c FUNCDECL</td><td>name (string)</td><td>return_type</td><td>first param</td><td>param count</td><td>body (node)</td></tr>
+ * <tr><td>@c BLOCK</td><td>variables (list)</td><td>statements (list)</td><td></td><td></td><td></td></tr>
+ * <tr><td>@c ASSIGNMENT</td><td>location (node)</td><td>value (node)</td><td></td><td></td><td></td></tr>
+ * <tr><td>@c CONDITIONAL</td><td>condition (node)</td><td>if_block (node)</td><td>else_block (node)</td><td></td><td></td></tr>
+ * <tr><td>@c WHILELOOP</td><td>condition (node)</td><td>body (node)</td><td></td><td></td><td></td></tr>
+ * <tr><td>@c RETURNSTMT</td><td>value (node)</td><td></td><td></td><td></td><td></td></tr>
+ * <tr><td>@c BINARYOP</td><td>operator</td><td>left (node)</td><td>right (node)</td><td></td><td></td></tr>
+ * <tr><td>@c UNARYOP</td><td>operator</td><td>child (node)</td><td></td><td></td><td></td></tr>
+ * <tr><td>@c LOCATION</td><td>name (string)</td><td>index (node)</td><td></td><td></td><td></td></tr>
+ * <tr><td>@c FUNCCALL</td><td>name (string)</td><td>arguments (list)</td><td></td><td></td><td></td></tr>
+ * <tr><td>@c LITERAL</td><td>type</td><td>value (integer, boolean, or string)</td><td></td><td></td><td></td></tr>
+ * </table>
+ *
+ * A list is a reference to its first node; the rest of the list follows the
+ * @c next references.
+ *
+ * A node with the @ref AST_FILE_HAS_SYMBOL flag but no @c symbol reference
+ * has a @c symbol attribute of @c NULL (i.e., an undefined name).
+ */
+typedef struct ASTFileNode
+{
+    uint32_t type;              /**< @brief @ref NodeType */
+    int32_t source_line;        /**< @brief Source code line number */
+    uint32_t next;              /**< @brief Next node in the enclosing list (node reference) */
+    uint32_t fields[AST_FILE_NODE_FIELDS];  /**< @brief Type-specific data (see above) */
+    uint32_t attributes;        /**< @brief Attributes present (@c AST_FILE_HAS_* flags) */
+    int32_t inferred_type;      /**< @brief @c type attribute (@ref DecafType) */
+    uint32_t symbol_table;      /**< @brief @c symbolTable attribute (symbol table reference) */
+    uint32_t symbol;            /**< @brief @c symbol attribute (symbol reference) */
+} ASTFileNode;
+
+/**
+ * @brief Binary AST parameter record (for function declarations and symbols)
+ */
+typedef struct ASTFileParameter
+{
+    uint32_t name;              /**< @brief Parameter name (string) */
+    int32_t type;               /**< @brief Parameter type (@ref DecafType) */
+} ASTFileParameter;
+
+/**
+ * @brief Binary AST symbol table record
+ *
+ * Tables are stored in the order their nodes appear, so a table's parent
+ * always has a smaller index.
+ */
+typedef struct ASTFileSymbolTable
+{
+    uint32_t parent;            /**< @brief Parent table (symbol table reference) */
+    uint32_t first_symbol;      /**< @brief Index of the first symbol in the table */
+    uint32_t symbol_count;      /**< @brief Number of symbols in the table (stored contiguously) */
+} ASTFileSymbolTable;
+
+/**
+ * @brief Binary AST symbol record
+ */
+typedef struct ASTFileSymbol
+{
+    uint32_t name;              /**< @brief Symbol name (string) */
+    uint32_t symbol_type;       /**< @brief Kind of symbol (scalar, array, or function) */
+    int32_t type;               /**< @brief Variable or function return type (@ref DecafType) */
+    int32_t length;             /**< @brief Array length */
+    uint32_t first_param;       /**< @brief Index of the first parameter (function symbols only) */
+    uint32_t param_count;       /**< @brief Number of parameters */
+    int32_t location;           /**< @brief Memory access location */
+    int32_t offset;             /**< @brief Memory offset */
+} ASTFileSymbol;
+
+/**
+ * @brief Write an AST in binary format
+ *
+ * @param tree Root of AST (must be a program node)
+ * @param output File stream to write to
+ * @returns True if and only if the whole tree was written successfully
+ */
+bool ASTNode_write_binary (ASTNode* tree, FILE* output);
+
+/**
+ * @brief Rebuild an AST from binary data in memory
+ *
+ * The data is fully validated before any nodes are allocated, so malformed
+ * input is rejected without leaking memory. Nodes, symbol tables, and symbols
+ * are allocated with @ref decaf_calloc (so they come from the current arena,
+ * if any) and are independent of the data once this function returns.
+ *
+ * @param data Start of binary AST data (must be at least 4-byte aligned)
+ * @param length Length of the data (in bytes)
+ * @returns Root of the reloaded AST, or @c NULL if the data is invalid
+ */
+ASTNode* ASTNode_decode_binary (const void* data, size_t length);
+
+/**
+ * @brief Load an AST from a binary AST file
+ *
+ * The file is mapped into memory and decoded with @ref ASTNode_decode_binary.
+ *
+ * @param filename Name of file to read
+ * @returns Root of the reloaded AST, or @c NULL if the file couldn't be read
+ * or is invalid
+ */
+ASTNode* ASTNode_read_binary (const char* filename);
+
+#endif
@@ -42,6 +42,11 @@ typedef struct Symbol
      * @brief Name of symbol in code
      */
     char name[MAX_ID_LEN];
+
+    /**
+     * @brief Precomputed hash of @c name (see @ref hash_string)
+     */
+    uint32_t hash;
     
     /**
      * @brief Variable or function return type
@@ -118,12 +123,38 @@ void Symbol_free (Symbol* symbol);
 
 DECL_LIST_TYPE(Symbol, struct Symbol*)
 
+/**
+ * @brief Single slot in a symbol table's hash index.
+ *
+ * Each occupied slot corresponds to one distinct name in the scope; if the name
+ * was declared more than once, @c symbol is the first declaration and @c count
+ * records the total number of declarations.
+ */
+typedef struct SymbolTableEntry
+{
+    /**
+     * @brief First symbol inserted with this name (or @c NULL if the slot is empty)
+     */
+    Symbol* symbol;
+
+    /**
+     * @brief Number of symbols in the scope with this name
+     */
+    int count;
+
+} SymbolTableEntry;
+
 /**
  * @brief Stores symbol info for a single lexical scope.
  * 
  * Symbol tables are generated using a simple AST traversal algorithm, and are
  * used during code generation to look up type and location information for
  * individual symbols.
+ *
+ * Symbols are kept in declaration order in @c local_symbols (for printing) and
+ * are also indexed by an open-addressing hash table (linear probing, keyed on
+ * @ref Symbol::hash) so that insertion, lookup, and duplicate detection take
+ * expected constant time. The index is allocated lazily on the first insert.
  */
 typedef struct SymbolTable
 {
@@ -132,6 +163,21 @@ typedef struct SymbolTable
      */
     SymbolList* local_symbols;
 
+    /**
+     * @brief Hash index over @c local_symbols (power-of-two sized array)
+     */
+    SymbolTableEntry* entries;
+
+    /**
+     * @brief Number of slots in @c entries
+     */
+    int capacity;
+
+    /**
+     * @brief Number of occupied slots in @c entries (distinct names)
+     */
+    int num_names;
+
     /**
      * @brief Link to parent table
      */
@@ -170,6 +216,26 @@ void SymbolTable_insert (SymbolTable* table, Symbol* symbol);
  */
 Symbol* SymbolTable_lookup (SymbolTable* table, const char* name);
 
+/**
+ * @brief Retrieve a symbol from a table without searching parent tables
+ *
+ * @param table Symbol table to search
+ * @param name Name of symbol to find
+ * @returns The first @ref Symbol inserted with that name, otherwise @c NULL
+ */
+Symbol* SymbolTable_lookup_local (SymbolTable* table, const char* name);
+
+/**
+ * @brief Count the symbols with a given name in a table (not including parents)
+ *
+ * A count greater than one indicates a duplicate declaration in the scope.
+ *
+ * @param table Symbol table to search
+ * @param name Name of symbol to count
+ * @returns Number of symbols with the given name
+ */
+int SymbolTable_count_local (SymbolTable* table, const char* name);
+
 /**
  * @brief Deallocate a symbol table
  */
@@ -197,6 +263,40 @@ Symbol* lookup_symbol(ASTNode* node, const char* name);
  */
 NodeVisitor* BuildSymbolTablesVisitor_new ();
 
+/**
+ * @brief Create a new visitor that binds name references to their symbols
+ *
+ * Each location and function call node is resolved exactly once (with the
+ * same result as @ref lookup_symbol) and the result is stored in its "symbol"
+ * attribute (@ref SYMBOL_SLOT); return statements are bound to the symbol of
+ * their enclosing function. Unresolved names are bound to @c NULL. Requires
+ * the parent links and symbol tables to already be in place.
+ *
+ * The visitor keeps an index of the names visible in the current scope, so
+ * each lookup takes expected constant time regardless of how deeply the scope
+ * is nested. The traversal may start at any node (e.g., a single function).
+ *
+ * @returns Pointer to visitor structure
+ */
+NodeVisitor* ResolveSymbolsVisitor_new ();
+
+/**
+ * @brief Retrieve the symbol bound to a node by a @ref ResolveSymbolsVisitor_new
+ *
+ * @param node Location, function call, or return node
+ * @returns The bound @ref Symbol, or @c NULL if the name was not defined
+ */
+Symbol* ASTNode_get_symbol (ASTNode* node);
+
+/**
+ * @brief Output format of a @ref PrintSymbolsVisitor_new_with_format
+ */
+typedef enum SymbolFormat {
+    TEXT_SYMBOLS,       /**< @brief Indented tables interleaved with their declarations */
+    TSV_SYMBOLS,        /**< @brief One tab-separated line per symbol (after a header line) */
+    JSON_SYMBOLS        /**< @brief One JSON object per symbol (one per line) */
+} SymbolFormat;
+
 /**
  * @brief Create a new visitor that prints symbol tables
  * 
@@ -206,19 +306,153 @@ NodeVisitor* BuildSymbolTablesVisitor_new ();
 NodeVisitor* PrintSymbolsVisitor_new (FILE* output);
 
 /**
- * @brief Static analysis error structure
+ * @brief Create a new visitor that prints symbol tables in the given format
+ *
+ * Output is collected in an @ref OutputBuffer and written to the stream in
+ * large blocks (the last block is written when the visitor is freed).
+ *
+ * In the TSV and JSON formats, each symbol is described by the depth, kind
+ * ("program", "function", or "block"), and source line of the node that owns
+ * its table, followed by its name, kind ("scalar", "array", or "function"),
+ * type (the return type for functions), array length, parameter types, and
+ * memory location ("static", "stack", or "none") and offset. In TSV, the
+ * parameter types are separated by commas ("-" if there are none).
+ *
+ * @param output File stream for the print output
+ * @param format Output format
+ * @returns Pointer to visitor structure
+ */
+NodeVisitor* PrintSymbolsVisitor_new_with_format (FILE* output, SymbolFormat format);
+
+/**
+ * @brief Maximum number of arguments recorded for a single error
+ */
+#define MAX_ERROR_ARGS 6
+
+/**
+ * @brief Argument of a deferred error message (a @c %d or @c %s conversion)
+ */
+typedef union ErrorArg
+{
+    int integer;            /**< @brief Value for a @c %d conversion */
+    const char* string;     /**< @brief Value for a @c %s conversion */
+} ErrorArg;
+
+/**
+ * @brief Static analysis error record
+ *
+ * The message text isn't formatted until it is needed (see @ref
+ * ErrorList_format); the record only stores the format string, which also
+ * identifies the kind of error, and the arguments.
  */
 typedef struct AnalysisError
 {
-    char message[MAX_ERROR_LEN];    /**< @brief Error message */
-    struct AnalysisError* next;     /**< @brief Next message (if stored in a list) */
+    const char* format;             /**< @brief Message format (static storage) */
+    ErrorArg args[MAX_ERROR_ARGS];  /**< @brief Message arguments (in order) */
 } AnalysisError;
 
-DECL_LIST_TYPE(Error, AnalysisError*)
+/**
+ * @brief How much of the error information an @ref ErrorList keeps
+ */
+typedef enum ErrorMode
+{
+    ALL_ERRORS,         /**< @brief Record every error */
+    FIRST_ERROR_ONLY,   /**< @brief Record the first error and ignore the rest */
+    COUNT_ERRORS_ONLY   /**< @brief Count errors without recording them */
+} ErrorMode;
 
 /**
- * @brief Add an error message to a list of errors using @c printf syntax
+ * @brief List of static analysis errors
+ *
+ * Errors are stored by value in a single growable array. Allocate with @ref
+ * ErrorList_new and de-allocate with @ref ErrorList_free.
+ */
+typedef struct ErrorList
+{
+    AnalysisError* errors;  /**< @brief Recorded errors (in the order they were reported) */
+    int size;               /**< @brief Number of errors reported */
+    int capacity;           /**< @brief Allocated length of @c errors */
+    ErrorMode mode;         /**< @brief Which errors are recorded */
+    char* text;             /**< @brief Storage for preformatted messages (see @ref ErrorList_add_message) */
+    size_t text_size;       /**< @brief Bytes of @c text in use */
+    size_t text_capacity;   /**< @brief Allocated length of @c text */
+} ErrorList;
+
+/**
+ * @brief Allocate and initialize a new, empty list that records every error
+ */
+ErrorList* ErrorList_new ();
+
+/**
+ * @brief Allocate and initialize a new, empty list with the given mode
+ */
+ErrorList* ErrorList_new_with_mode (ErrorMode mode);
+
+/**
+ * @brief Add an error to a list using @c printf syntax
+ *
+ * Only the @c %d (@c int) and @c %s conversions are supported, with at most
+ * @ref MAX_ERROR_ARGS of them. The arguments are recorded rather than
+ * formatted, so the format and any string arguments must outlive the list
+ * (e.g., string literals and interned names).
  */
 void ErrorList_printf (ErrorList* list, const char* format, ...);
 
+/**
+ * @brief Add an already-formatted error message to a list (the text is copied)
+ */
+void ErrorList_add_message (ErrorList* list, const char* message);
+
+/**
+ * @brief Add a range of the errors of another list to the end of a list
+ *
+ * The errors are counted and recorded as if they had been reported to @c list
+ * directly (according to its mode), so @c source must have recorded every
+ * error in the range unless @c list is in @ref COUNT_ERRORS_ONLY mode.
+ *
+ * @param list List to add to
+ * @param source List to copy from (unchanged)
+ * @param first Index of the first error to copy
+ * @param end Index just past the last error to copy
+ */
+void ErrorList_append (ErrorList* list, ErrorList* source, int first, int end);
+
+/**
+ * @brief Look up the number of errors reported to a list (including any that
+ * weren't recorded because of the list's mode)
+ */
+int ErrorList_size (ErrorList* list);
+
+/**
+ * @brief Test a list to see if no errors were reported to it
+ */
+bool ErrorList_is_empty (ErrorList* list);
+
+/**
+ * @brief Look up the number of errors recorded in a list (i.e., that can be
+ * formatted)
+ */
+int ErrorList_recorded (ErrorList* list);
+
+/**
+ * @brief Format the message of a recorded error
+ *
+ * @param list List of errors
+ * @param index Index of the error (less than @ref ErrorList_recorded)
+ * @param buffer Output buffer
+ * @param size Size of @c buffer (the message is truncated to fit)
+ * @returns Length of the formatted message
+ */
+size_t ErrorList_format (ErrorList* list, int index, char* buffer, size_t size);
+
+/**
+ * @brief Print every recorded error message (one per line)
+ */
+void ErrorList_print (ErrorList* list, FILE* output);
+
+/**
+ * @brief Deallocate a list and its errors
+ */
+void ErrorList_free (ErrorList* list);
+
 #endif
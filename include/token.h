@@ -72,8 +72,11 @@ typedef enum TokenType {
 
 /**
  * @brief Single token
- * 
- * Allocate with @ref Token_new and de-allocate with @ref Token_free.
+ *
+ * Tokens are stored by value in a @ref TokenQueue; the token text is not
+ * stored inline but is a handle to a NUL-terminated string interned using
+ * @ref decaf_intern, so repeated identifiers, keywords, and symbols share a
+ * single copy of their text.
  */
 typedef struct Token
 {
@@ -82,20 +85,16 @@ typedef struct Token
      */
     TokenType type;
 
-    /**
-     * @brief Raw text of the token
-     */
-    char text[MAX_TOKEN_LEN];
-
     /**
      * @brief Source line number
      */
     int line;
 
     /**
-     * @brief Pointer to next token (used to store in a list)
+     * @brief Raw text of the token (interned; at most @c MAX_TOKEN_LEN-1
+     * characters)
      */
-    struct Token* next;
+    const char* text;
 
 } Token;
 
@@ -117,30 +116,42 @@ const char* TokenType_to_string(TokenType type);
  */
 bool token_str_eq(const char* str1, const char* str2);
 
+struct TokenQueue;
+
 /**
- * @brief Allocate and initialize a new token
- *
- * Make sure Token_free() is called to deallocate the token, otherwise there
- * will be a memory leak.
+ * @brief Callback used by a streaming @ref TokenQueue to produce more tokens
  *
- * @param type Type of new token
- * @param text Raw text for new token
- * @param line Line number of new token
- * @returns Newly-created token
+ * The callback should add at least one token to the queue (using @ref
+ * TokenQueue_add) and return true, or return false if there are no more
+ * tokens. It may also report a fatal error using @ref Error_throw_printf.
  */
-Token* Token_new (TokenType type, const char* text, int line);
+typedef bool (*TokenRefillFunc) (struct TokenQueue* queue);
 
 /**
- * @brief Deallocate a token
+ * @brief Number of token slots in a streaming @ref TokenQueue
  *
- * @param token Token to deallocate
+ * A token removed from a streaming queue remains valid until at least this
+ * many more tokens have been added.
  */
-void Token_free (Token* token);
+#define TOKEN_STREAM_WINDOW 64
 
 /**
- * @brief Linked list of tokens
- * 
- * Allocate with @ref TokenQueue_new and de-allocate with @ref TokenQueue_free.
+ * @brief Queue of tokens
+ *
+ * Tokens are stored contiguously in a growable ring buffer; removing a token
+ * from the queue just advances a cursor. Positions (e.g., @c size and @c
+ * cursor) are absolute token indices; a token's slot in the buffer is its
+ * index modulo the capacity.
+ *
+ * A queue is either fully materialized (e.g., by @ref lex), in which case
+ * every token is kept and pointers returned by @ref TokenQueue_peek and @ref
+ * TokenQueue_remove remain valid until the queue is deallocated, or streaming
+ * (see @ref TokenQueue_new_stream), in which case tokens are produced on
+ * demand when the queue runs dry and the slots of removed tokens are recycled
+ * (see @ref TOKEN_STREAM_WINDOW).
+ *
+ * Allocate with @ref TokenQueue_new or @ref TokenQueue_new_stream and
+ * de-allocate with @ref TokenQueue_free.
  * 
  * Methods:
  * - @ref TokenQueue_peek
@@ -152,14 +163,42 @@ void Token_free (Token* token);
 typedef struct TokenQueue
 {
     /**
-     * @brief Front of list (or <tt>NULL</tt> if list is empty)
+     * @brief Ring buffer of tokens (capacity is zero or a power of two)
+     */
+    Token* tokens;
+
+    /**
+     * @brief Total number of tokens ever added
      */
-    Token* head;
+    size_t size;
 
     /**
-     * @brief Back of list (or <tt>NULL</tt> if list is empty)
+     * @brief Allocated capacity of the ring buffer
      */
-    Token* tail;
+    size_t capacity;
+
+    /**
+     * @brief Index of the front of the queue (equal to @c size if the queue
+     * is empty)
+     */
+    size_t cursor;
+
+    /**
+     * @brief Index of the oldest token still stored in the buffer
+     */
+    size_t oldest;
+
+    /**
+     * @brief Callback that produces more tokens (@c NULL if the queue is not
+     * streaming or the stream is exhausted)
+     */
+    TokenRefillFunc refill;
+
+    /**
+     * @brief State for the refill callback (released with @c free() when the
+     * queue is deallocated)
+     */
+    void* refill_state;
 
 } TokenQueue;
 
@@ -171,27 +210,45 @@ typedef struct TokenQueue
 TokenQueue* TokenQueue_new ();
 
 /**
- * @brief Add a token to a queue
+ * @brief Allocate and initialize a new streaming queue of tokens
+ *
+ * @param refill Callback that produces tokens on demand
+ * @param state Heap-allocated state for the callback (owned by the queue)
+ * @returns Newly-created queue of tokens
+ */
+TokenQueue* TokenQueue_new_stream (TokenRefillFunc refill, void* state);
+
+/**
+ * @brief Add a new token to the back of a queue
+ *
+ * The text is interned (see @ref decaf_intern) after being truncated to @c
+ * MAX_TOKEN_LEN-1 characters.
  *
  * @param queue Queue to add to
- * @param token Token to add
+ * @param type Type of new token
+ * @param text Raw text for new token (not necessarily NUL-terminated)
+ * @param length Length of the raw text
+ * @param line Line number of new token
  */
-void TokenQueue_add (TokenQueue* queue, Token* token);
+void TokenQueue_add (TokenQueue* queue, TokenType type, const char* text, size_t length, int line);
 
 /**
  * @brief Return the next token from a queue without removing it
  * (first-in-first-out)
  *
  * @param queue Queue to look at
- * @returns Token extracted
+ * @returns Token at the front of the queue (or @c NULL if the queue is empty)
  */
 Token* TokenQueue_peek (TokenQueue* queue);
 
 /**
  * @brief Remove a token from a queue (first-in-first-out)
  *
+ * The removed token is still owned by the queue; it remains valid until the
+ * queue is deallocated or (for a streaming queue) until its slot is recycled.
+ *
  * @param queue Queue to remove from
- * @returns Token removed
+ * @returns Token removed (or @c NULL if the queue was empty)
  */
 Token* TokenQueue_remove (TokenQueue* queue);
 
@@ -206,6 +263,8 @@ bool TokenQueue_is_empty (TokenQueue* queue);
 /**
  * @brief Calculate size of the queue
  *
+ * For a streaming queue, this produces all remaining tokens.
+ *
  * @param queue Queue to check
  * @returns Number of tokens in the queue
  */
@@ -214,6 +273,8 @@ size_t TokenQueue_size (TokenQueue* queue);
 /**
  * @brief Print a queue to the given file descriptor (debug output)
  *
+ * For a streaming queue, this produces all remaining tokens.
+ *
  * @param queue Queue to print
  * @param out File stream to print to
  */
@@ -222,7 +283,7 @@ void TokenQueue_print (TokenQueue* queue, FILE* out);
 /**
  * @brief Deallocate a token queue
  *
- * Also deallocates any remaining tokens
+ * Also deallocates all stored tokens (including those already removed)
  *
  * @param queue Queue to deallocate
  */
@@ -117,6 +117,204 @@ void NodeVisitor_traverse_and_free (NodeVisitor* visitor, ASTNode* node);
 void NodeVisitor_free (NodeVisitor* visitor);
 
 
+/**
+ * @brief Create a new visitor that runs several visitors in lockstep
+ *
+ * During a single traversal, each node is pre-visited by every child visitor
+ * in the order they were added, then its children are traversed, and then it
+ * is post-visited by every child visitor in reverse order (so that the
+ * visitors nest properly). Thus, a child visitor sees every node exactly as it
+ * would in its own traversal as long as it only depends on work done by
+ * earlier visitors on the same node or its ancestors. This allows several
+ * passes to share a single walk over the tree. For example:
+ *
+ *     NodeVisitor* v = CompositeVisitor_new();
+ *     CompositeVisitor_add(v, SetParentVisitor_new());
+ *     CompositeVisitor_add(v, CalcDepthVisitor_new());
+ *     NodeVisitor_traverse_and_free(v, tree);
+ *
+ * The composite visitor takes ownership of its child visitors; they are
+ * deallocated along with it.
+ *
+ * @returns Pointer to visitor structure
+ */
+NodeVisitor* CompositeVisitor_new ();
+
+/**
+ * @brief Add a child visitor to a composite visitor
+ *
+ * @param composite Visitor allocated by @ref CompositeVisitor_new
+ * @param child Visitor to add (ownership is transferred to @p composite)
+ */
+void CompositeVisitor_add (NodeVisitor* composite, NodeVisitor* child);
+
+
+/*
+ * SPECIALIZED (STATIC) TRAVERSALS
+ */
+
+/**
+ * @brief Pending work for a single node during an iterative traversal
+ */
+typedef struct TraversalFrame
+{
+    ASTNode* node;      /**< @brief Node being traversed (already pre-visited) */
+    int step;           /**< @brief Index of the next child (or child list) to visit */
+    int index;          /**< @brief Position of the next child in the current child list */
+} TraversalFrame;
+
+/**
+ * @brief Explicit stack of pending nodes for an iterative traversal
+ */
+typedef struct TraversalStack
+{
+    TraversalFrame* frames;     /**< @brief Frames (the innermost node is on top) */
+    int top;                    /**< @brief Number of frames in use */
+    int capacity;               /**< @brief Allocated length of @c frames */
+#ifdef DECAF_PROFILE
+    unsigned long pushes;       /**< @brief Number of nodes pushed so far */
+    int max_top;                /**< @brief Largest number of frames in use so far */
+#endif
+} TraversalStack;
+
+/**
+ * @brief Initialize an empty traversal stack
+ *
+ * @param stack Stack to initialize
+ */
+void TraversalStack_init (TraversalStack* stack);
+
+/**
+ * @brief Push a node that is about to be pre-visited
+ *
+ * Throws an error (see @ref Error_throw_printf) after releasing the stack if
+ * the node has an invalid type.
+ *
+ * @param stack Stack to push onto (grows as needed)
+ * @param node Node to push
+ */
+void TraversalStack_push (TraversalStack* stack, ASTNode* node);
+
+/**
+ * @brief Release the memory of a traversal stack
+ *
+ * @param stack Stack to release
+ */
+void TraversalStack_free (TraversalStack* stack);
+
+/**
+ * @brief Retrieve the next child of the node in a traversal frame
+ *
+ * Children are returned in the order of a recursive depth-first traversal. For
+ * a binary operator, the in-visit belongs between the children, i.e., right
+ * before this is called on a frame whose @c step is 1.
+ *
+ * @param frame Frame of the node (advanced past the returned child)
+ * @returns Next child, or @c NULL if all of them have been traversed
+ */
+ASTNode* TraversalFrame_next_child (TraversalFrame* frame);
+
+/**
+ * @brief Define an iterative traversal function with the given dispatch
+ *
+ * Defines <tt>void NAME (NodeVisitor* visitor, ASTNode* node)</tt>, which calls
+ * <tt>PREVISIT(visitor, node)</tt>, <tt>INVISIT(visitor, node)</tt> (for binary
+ * operators only), and <tt>POSTVISIT(visitor, node)</tt> in exactly the order
+ * of @ref NodeVisitor_traverse. Each of the three may be a function or a
+ * function-like macro.
+ */
+#define DEF_TRAVERSAL(NAME, PREVISIT, INVISIT, POSTVISIT) \
+void NAME (NodeVisitor* visitor, ASTNode* node) \
+{ \
+    TraversalStack stack; \
+    TraversalStack_init(&stack); \
+    while (node != NULL) { \
+        TraversalStack_push(&stack, node); \
+        PREVISIT(visitor, node); \
+        /* finish nodes until we find one with a child left to visit */ \
+        node = NULL; \
+        while (stack.top > 0) { \
+            TraversalFrame* frame = &stack.frames[stack.top-1]; \
+            if (frame->node->type == BINARYOP && frame->step == 1) { \
+                INVISIT(visitor, frame->node); \
+            } \
+            if ((node = TraversalFrame_next_child(frame)) != NULL) { \
+                break; \
+            } \
+            stack.top--; \
+            POSTVISIT(visitor, frame->node); \
+        } \
+    } \
+    TraversalStack_free(&stack); \
+}
+
+/*
+ * direct-call dispatch cases for DEF_STATIC_VISITOR (hooks not in the list
+ * generate no code at all)
+ */
+#ifndef SKIP_IN_DOXYGEN
+#define STATIC_VISIT_CASE(TYPE, NAME, FUNC)     case TYPE: FUNC(visitor, node); break;
+#define STATIC_VISIT_SKIP(TYPE, NAME, FUNC)
+#define STATIC_SET_PREVISIT(TYPE, NAME, FUNC)   visitor->previsit_  ## NAME = &FUNC;
+#define STATIC_SET_INVISIT(TYPE, NAME, FUNC)    visitor->invisit_   ## NAME = &FUNC;
+#define STATIC_SET_POSTVISIT(TYPE, NAME, FUNC)  visitor->postvisit_ ## NAME = &FUNC;
+#endif
+
+/**
+ * @brief Define a traversal specialized for a fixed set of visitor hooks
+ *
+ * @c HOOKS is an X-macro that takes three macros (for previsits, in-visits, and
+ * postvisits) and applies the matching one to every hook of the visitor as
+ * <tt>(NODE_TYPE, name, function)</tt>. For example:
+ *
+ *     #define MY_HOOKS(PRE, IN, POST) \
+ *         PRE (VARDECL,  vardecl,  MyVisitor_previsit_vardecl) \
+ *         POST(BINARYOP, binaryop, MyVisitor_postvisit_binaryop)
+ *
+ *     DEF_STATIC_VISITOR(MyVisitor, MY_HOOKS)
+ *
+ * This defines two static functions: <tt>MyVisitor_set_hooks(NodeVisitor*)</tt>,
+ * which installs the hooks in a regular visitor (so it still works with @ref
+ * NodeVisitor_traverse and @ref CompositeVisitor_add), and
+ * <tt>MyVisitor_traverse(NodeVisitor*, ASTNode*)</tt>, which is equivalent to
+ * @ref NodeVisitor_traverse for that visitor but dispatches with a switch of
+ * direct calls instead of the function pointers. Nodes without a hook cost
+ * nothing, and the compiler can inline the hooks into the traversal. Because
+ * the hooks are fixed when the code is compiled, the specialized traversal
+ * ignores the visitor's function pointers (including the defaults, which must
+ * be left as no-ops); only its @c data is used.
+ */
+#define DEF_STATIC_VISITOR(NAME, HOOKS) \
+static void NAME ## _set_hooks (NodeVisitor* visitor) \
+{ \
+    HOOKS(STATIC_SET_PREVISIT, STATIC_SET_INVISIT, STATIC_SET_POSTVISIT) \
+} \
+static inline void NAME ## _static_previsit (NodeVisitor* visitor, ASTNode* node) \
+{ \
+    switch (node->type) { \
+        HOOKS(STATIC_VISIT_CASE, STATIC_VISIT_SKIP, STATIC_VISIT_SKIP) \
+        default: break; \
+    } \
+} \
+static inline void NAME ## _static_invisit (NodeVisitor* visitor, ASTNode* node) \
+{ \
+    switch (node->type) { \
+        HOOKS(STATIC_VISIT_SKIP, STATIC_VISIT_CASE, STATIC_VISIT_SKIP) \
+        default: break; \
+    } \
+} \
+static inline void NAME ## _static_postvisit (NodeVisitor* visitor, ASTNode* node) \
+{ \
+    switch (node->type) { \
+        HOOKS(STATIC_VISIT_SKIP, STATIC_VISIT_SKIP, STATIC_VISIT_CASE) \
+        default: break; \
+    } \
+} \
+static void NAME ## _traverse (NodeVisitor* visitor, ASTNode* node); \
+DEF_TRAVERSAL(NAME ## _traverse, NAME ## _static_previsit, \
+              NAME ## _static_invisit, NAME ## _static_postvisit)
+
+
 /*
  * VISITORS
  */
@@ -161,4 +359,28 @@ NodeVisitor* SetParentVisitor_new();
  */
 NodeVisitor* CalcDepthVisitor_new ();
 
+/**
+ * @brief Create a new visitor that folds constant expressions
+ *
+ * Every well-typed expression built only from @c int and @c bool literals
+ * and operators is evaluated, and the result is stored in its "constant"
+ * attribute (@ref CONSTANT_SLOT; @c bool values are 0 or 1). Arithmetic wraps
+ * around like 32-bit two's complement, and divisions by zero (and
+ * overflowing divisions) are left unfolded. The tree itself isn't changed, so
+ * later passes can treat any node with a constant as a leaf.
+ *
+ * @returns Pointer to visitor structure
+ */
+NodeVisitor* FoldConstantsVisitor_new ();
+
+/**
+ * @brief Look up the folded value of an expression (see @ref
+ * FoldConstantsVisitor_new)
+ *
+ * @param node Expression node
+ * @param value Set to the value of the expression if it is constant
+ * @returns True if and only if the expression is constant
+ */
+bool ASTNode_get_constant (ASTNode* node, int* value);
+
 #endif
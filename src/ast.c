@@ -1,4 +1,17 @@
 #include "ast.h"
+#include "symbol.h"
+
+_Thread_local AttributeStats attribute_stats;
+_Thread_local bool attribute_stats_enabled = false;
+
+/*
+ * count an attribute access if statistics are being collected
+ */
+#define COUNT_LOOKUP(COUNTER) do { \
+        if (attribute_stats_enabled) { \
+            attribute_stats.COUNTER++; \
+        } \
+    } while (0)
 
 void dummy_print(void* data, FILE* output)
 {
@@ -39,34 +52,237 @@ const char* NodeType_to_string(NodeType type)
 }
 
 /*
- * use macros defined in common.h to implement lists for nodes and parameters
+ * array-backed node lists
+ */
+
+/**
+ * @brief Initial capacity of a non-empty node list
+ */
+#define INITIAL_NODE_LIST_CAPACITY 4
+
+NodeList* NodeList_new ()
+{
+    NodeList* list = (NodeList*)decaf_calloc(1, sizeof(NodeList));
+    CHECK_MALLOC_PTR(list)
+    list->head = NULL;
+    list->tail = NULL;
+    list->size = 0;
+    list->capacity = 0;
+    list->items = NULL;
+    return list;
+}
+
+void NodeList_add (NodeList* list, ASTNode* item)
+{
+    /* grow by copying (rather than realloc) so that the array can come from
+     * the current arena */
+    if (list->size == list->capacity) {
+        int capacity = (list->capacity == 0 ? INITIAL_NODE_LIST_CAPACITY : list->capacity * 2);
+        ASTNode** items = (ASTNode**)decaf_calloc(capacity, sizeof(ASTNode*));
+        CHECK_MALLOC_PTR(items)
+        if (list->size > 0) {
+            memcpy(items, list->items, list->size * sizeof(ASTNode*));
+        }
+        decaf_free(list->items);
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->size++] = item;
+
+    /* maintain the linked view */
+    item->next = NULL;
+    if (list->head == NULL) {
+        list->head = item;
+    } else {
+        list->tail->next = item;
+    }
+    list->tail = item;
+}
+
+int NodeList_size (NodeList* list)
+{
+    return list->size;
+}
+
+bool NodeList_is_empty (NodeList* list)
+{
+    return (list->size == 0);
+}
+
+void NodeList_free (NodeList* list)
+{
+    for (int i = 0; i < list->size; i++) {
+        ASTNode_free(list->items[i]);
+    }
+    decaf_free(list->items);
+    decaf_free(list);
+}
+
+/*
+ * use macros defined in common.h to implement lists for parameters
  */
-DEF_LIST_IMPL(Node, struct ASTNode*, ASTNode_free)
-DEF_LIST_IMPL(Parameter, struct Parameter*, free)
+static void Parameter_free (Parameter* param)
+{
+    decaf_free((void*)param->name);
+    decaf_free(param);
+}
+
+DEF_LIST_IMPL(Parameter, struct Parameter*, Parameter_free)
 
 /*
  * this custom add-parameter method handles allocation as well
  */
 void ParameterList_add_new (ParameterList* list, const char* name, DecafType type)
 {
-    Parameter* param = (Parameter*)calloc(1, sizeof(Parameter));
+    Parameter* param = (Parameter*)decaf_calloc(1, sizeof(Parameter));
     CHECK_MALLOC_PTR(param)
-    snprintf(param->name, MAX_ID_LEN, "%s", name);
+    param->name = decaf_intern(name);
     param->type = type;
     ParameterList_add(list, param);
 }
 
+/*
+ * allocated size of a node whose type-specific data is the given union member
+ */
+#define NODE_SIZE(MEMBER) (offsetof(ASTNode, MEMBER) + sizeof(((ASTNode*)NULL)->MEMBER))
+
+/*
+ * allocated size of each node type (only the union member for the type is
+ * allocated; break and continue statements have no type-specific data)
+ */
+static size_t ASTNode_size (NodeType type)
+{
+    switch (type) {
+        case PROGRAM:       return NODE_SIZE(program);
+        case VARDECL:       return NODE_SIZE(vardecl);
+        case FUNCDECL:      return NODE_SIZE(funcdecl);
+        case BLOCK:         return NODE_SIZE(block);
+        case ASSIGNMENT:    return NODE_SIZE(assignment);
+        case CONDITIONAL:   return NODE_SIZE(conditional);
+        case WHILELOOP:     return NODE_SIZE(whileloop);
+        case RETURNSTMT:    return NODE_SIZE(funcreturn);
+        case BINARYOP:      return NODE_SIZE(binaryop);
+        case UNARYOP:       return NODE_SIZE(unaryop);
+        case LOCATION:      return NODE_SIZE(location);
+        case FUNCCALL:      return NODE_SIZE(funccall);
+        case LITERAL:       return NODE_SIZE(literal);
+        default:            break;
+    }
+    return offsetof(ASTNode, program);
+}
+
 ASTNode* ASTNode_new (NodeType type, int source_line)
 {
-    ASTNode* node = (ASTNode*)calloc(1, sizeof(ASTNode));
+    ASTNode* node = (ASTNode*)decaf_calloc(1, ASTNode_size(type));
     CHECK_MALLOC_PTR(node)
     node->type = type;
     node->source_line = source_line;
     node->attributes = NULL;
     node->next = NULL;
+    node->parent = NULL;
+    node->inferred_type = UNKNOWN;
+    node->depth = -1;
     return node;
 }
 
+/*
+ * registered attribute keys, indexed by AttributeSlot
+ */
+static const char* slot_keys[NUM_ATTRIBUTE_SLOTS] = {
+    [TYPE_SLOT]         = "type",
+    [SYMBOL_TABLE_SLOT] = "symbolTable",
+    [PARENT_SLOT]       = "parent",
+    [DEPTH_SLOT]        = "depth",
+    [DOTID_SLOT]        = "dotid",
+    [SYMBOL_SLOT]       = "symbol",
+    [CONSTANT_SLOT]     = "constant"
+};
+
+/*
+ * fixed DOT printers and destructors for registered attributes (NULL if the
+ * value is not owned by the node)
+ */
+static const AttributeValueDOTPrinter slot_printers[NUM_ATTRIBUTE_SLOTS] = {
+    [TYPE_SLOT]         = type_attr_print,
+    [SYMBOL_TABLE_SLOT] = symtable_attr_print,
+    [PARENT_SLOT]       = dummy_print,
+    [DEPTH_SLOT]        = int_attr_print,
+    [DOTID_SLOT]        = int_attr_print,
+    [SYMBOL_SLOT]       = dummy_print,
+    [CONSTANT_SLOT]     = int_attr_print
+};
+static const Destructor slot_dtors[NUM_ATTRIBUTE_SLOTS] = {
+    [SYMBOL_TABLE_SLOT] = (Destructor)SymbolTable_free
+};
+
+#define SLOT_BIT(S) ((AttributeSlotMask)(1u << (S)))
+
+/*
+ * out-of-line value of a registered attribute that isn't stored inline
+ */
+#define STORED_SLOT(N,S) ((N)->attributes->slots[(S) - NUM_INLINE_ATTRIBUTE_SLOTS])
+
+/*
+ * look up a node's out-of-line attributes, allocating them if necessary
+ */
+static AttributeStore* ASTNode_store (ASTNode* node)
+{
+    if (node->attributes == NULL) {
+        node->attributes = (AttributeStore*)decaf_calloc(1, sizeof(AttributeStore));
+        CHECK_MALLOC_PTR(node->attributes)
+    }
+    return node->attributes;
+}
+
+/*
+ * check whether a registered attribute is set (the inline ones are set when
+ * their field doesn't hold its initial value)
+ */
+static inline bool ASTNode_slot_is_set (ASTNode* node, AttributeSlot slot)
+{
+    switch (slot) {
+        case TYPE_SLOT:     return node->inferred_type != UNKNOWN;
+        case PARENT_SLOT:   return node->parent != NULL;
+        case DEPTH_SLOT:    return node->depth >= 0;
+        default:            return node->attributes != NULL &&
+                                   (node->attributes->slot_mask & SLOT_BIT(slot)) != 0;
+    }
+}
+
+/*
+ * read the value of a registered attribute (which must be set)
+ */
+static inline void* ASTNode_slot_value (ASTNode* node, AttributeSlot slot)
+{
+    switch (slot) {
+        case TYPE_SLOT:     return (void*)(intptr_t)node->inferred_type;
+        case PARENT_SLOT:   return node->parent;
+        case DEPTH_SLOT:    return (void*)(long)node->depth;
+        default:            return STORED_SLOT(node, slot);
+    }
+}
+
+const char* AttributeSlot_to_key (AttributeSlot slot)
+{
+    return slot_keys[slot];
+}
+
+int AttributeSlot_from_key (const char* key)
+{
+    /* keys are almost always string literals, so try pointer comparisons first */
+    for (int i = 0; i < NUM_ATTRIBUTE_SLOTS; i++) {
+        if (key == slot_keys[i]) {
+            return i;
+        }
+    }
+    for (int i = 0; i < NUM_ATTRIBUTE_SLOTS; i++) {
+        if (strncmp(key, slot_keys[i], MAX_ID_LEN) == 0) {
+            return i;
+        }
+    }
+    return NO_ATTRIBUTE_SLOT;
+}
+
 void ASTNode_set_attribute (ASTNode* node, const char* key, void* value, Destructor dtor)
 {
     ASTNode_set_printable_attribute(node, key, value, dummy_print, dtor);
@@ -84,8 +300,15 @@ void ASTNode_set_printable_attribute (ASTNode* node, const char* key, void* valu
         Error_throw_printf("ERROR: Tried to set attribute '%s' without a node pointer\n", key);
     }
 
+    /* registered keys are stored in their slot */
+    int slot = AttributeSlot_from_key(key);
+    if (slot != NO_ATTRIBUTE_SLOT) {
+        ASTNode_set_slot_attribute(node, (AttributeSlot)slot, value);
+        return;
+    }
+
     /* allocate new attribute */
-    Attribute* attr = (Attribute*)calloc(1, sizeof(Attribute));
+    Attribute* attr = (Attribute*)decaf_calloc(1, sizeof(Attribute));
     CHECK_MALLOC_PTR(attr)
     attr->key = key;
     attr->value = value;
@@ -93,40 +316,52 @@ void ASTNode_set_printable_attribute (ASTNode* node, const char* key, void* valu
     attr->dtor = dtor;
     attr->next = NULL;
 
-    if (node->attributes == NULL) {
+    AttributeStore* store = ASTNode_store(node);
+    if (store->list == NULL) {
         /* first attribute */
-        node->attributes = attr;
+        store->list = attr;
     } else {
 
         /* search existing keys */
-        for (Attribute* a = node->attributes; a != NULL; a = a->next) {
+        for (Attribute* a = store->list; a != NULL; a = a->next) {
             if (strncmp(key, a->key, MAX_ID_LEN) == 0) {
 
                 /* key present; replace with new value */
                 a->dtor(a->value);
                 a->value = value;
                 a->dtor = dtor;
-                free(attr);
+                decaf_free(attr);
                 return;
             }
         }
 
         /* key not present; insert at beginning */
-        attr->next = node->attributes;
-        node->attributes = attr;
+        attr->next = store->list;
+        store->list = attr;
     }
 }
 
 bool ASTNode_has_attribute (ASTNode* node, const char* key)
 {
+    COUNT_LOOKUP(keyed_lookups);
     if (node == NULL) {
         Error_throw_printf("ERROR: Tried to get attribute '%s' without a node pointer\n", key);
     }
-    for (Attribute* a = node->attributes; a != NULL; a = a->next) {
+    int slot = AttributeSlot_from_key(key);
+    if (slot != NO_ATTRIBUTE_SLOT) {
+        COUNT_LOOKUP(slot_lookups);
+        PROFILE_COUNT("keyed check", key);
+        return ASTNode_slot_is_set(node, (AttributeSlot)slot);
+    }
+    unsigned long position = 0;
+    Attribute* list = (node->attributes != NULL ? node->attributes->list : NULL);
+    for (Attribute* a = list; a != NULL; a = a->next, position++) {
         if (strncmp(key, a->key, MAX_ID_LEN) == 0) {
+            PROFILE_RECORD("keyed check", key, 0, position);
             return true;
         }
     }
+    PROFILE_RECORD("keyed miss", key, 0, position);
     return false;
 }
 
@@ -137,86 +372,213 @@ int ASTNode_get_int_attribute (ASTNode* node, const char* key)
 
 void* ASTNode_get_attribute (ASTNode* node, const char* key)
 {
+    COUNT_LOOKUP(keyed_lookups);
     if (node == NULL) {
         Error_throw_printf("ERROR: Tried to get attribute '%s' without a node pointer\n", key);
     }
-    for (Attribute* a = node->attributes; a != NULL; a = a->next) {
+    int slot = AttributeSlot_from_key(key);
+    if (slot != NO_ATTRIBUTE_SLOT) {
+        PROFILE_COUNT("keyed get", key);
+        return ASTNode_get_slot_attribute(node, (AttributeSlot)slot);
+    }
+    unsigned long position = 0;
+    Attribute* list = (node->attributes != NULL ? node->attributes->list : NULL);
+    for (Attribute* a = list; a != NULL; a = a->next, position++) {
         if (strncmp(key, a->key, MAX_ID_LEN) == 0) {
+            PROFILE_RECORD("keyed get", key, 0, position);
             return a->value;
         }
     }
+    PROFILE_RECORD("keyed miss", key, 0, position);
     printf("ERROR: No '%s' attribute\n", key);
     return NULL;
 }
 
+void ASTNode_set_slot_attribute (ASTNode* node, AttributeSlot slot, void* value)
+{
+    if (node == NULL) {
+        Error_throw_printf("ERROR: Tried to set attribute '%s' without a node pointer\n", slot_keys[slot]);
+    }
+    switch (slot) {
+        case TYPE_SLOT:     node->inferred_type = (DecafType)(intptr_t)value;  return;
+        case PARENT_SLOT:   node->parent = (ASTNode*)value;                    return;
+        case DEPTH_SLOT:    node->depth = (int)(long)value;                    return;
+        default:            break;
+    }
+    AttributeStore* store = ASTNode_store(node);
+    if ((store->slot_mask & SLOT_BIT(slot)) && slot_dtors[slot] != NULL) {
+        /* slot in use; clean up old value before replacing it */
+        slot_dtors[slot](STORED_SLOT(node, slot));
+    }
+    STORED_SLOT(node, slot) = value;
+    store->slot_mask |= SLOT_BIT(slot);
+}
+
+void ASTNode_set_inferred_type (ASTNode* node, DecafType type)
+{
+    node->inferred_type = type;
+}
+
+void ASTNode_set_int_slot_attribute (ASTNode* node, AttributeSlot slot, int value)
+{
+    ASTNode_set_slot_attribute(node, slot, (void*)(long)value);
+}
+
+bool ASTNode_has_slot_attribute (ASTNode* node, AttributeSlot slot)
+{
+    COUNT_LOOKUP(slot_lookups);
+    if (node == NULL) {
+        Error_throw_printf("ERROR: Tried to get attribute '%s' without a node pointer\n", slot_keys[slot]);
+    }
+    bool is_set = ASTNode_slot_is_set(node, slot);
+    PROFILE_COUNT(is_set ? "slot check" : "slot miss", slot_keys[slot]);
+    return is_set;
+}
+
+void* ASTNode_get_slot_attribute (ASTNode* node, AttributeSlot slot)
+{
+    COUNT_LOOKUP(slot_lookups);
+    if (node == NULL) {
+        Error_throw_printf("ERROR: Tried to get attribute '%s' without a node pointer\n", slot_keys[slot]);
+    }
+    if (!ASTNode_slot_is_set(node, slot)) {
+        PROFILE_COUNT("slot miss", slot_keys[slot]);
+        printf("ERROR: No '%s' attribute\n", slot_keys[slot]);
+        return NULL;
+    }
+    PROFILE_COUNT("slot get", slot_keys[slot]);
+    return ASTNode_slot_value(node, slot);
+}
+
+int ASTNode_get_int_slot_attribute (ASTNode* node, AttributeSlot slot)
+{
+    return (int)(long)ASTNode_get_slot_attribute(node, slot);
+}
+
+void ASTNode_print_slot_attribute (ASTNode* node, AttributeSlot slot, FILE* output)
+{
+    slot_printers[slot](ASTNode_slot_value(node, slot), output);
+}
+
+/*
+ * push a node onto the pending-free stack, which is threaded through the
+ * nodes' own "next" pointers (a node's siblings have already been pushed or
+ * recorded by the time it is pushed, so the link is no longer needed)
+ */
+#define PUSH_PENDING(N) do { ASTNode* n_ = (N); n_->next = pending; pending = n_; } while (0)
+
+/*
+ * push every node in a list and then release the list structure itself
+ */
+#define PUSH_PENDING_LIST(L) do { \
+        for (int i_ = 0; i_ < (L)->size; i_++) { \
+            PUSH_PENDING((L)->items[i_]); \
+        } \
+        decaf_free((L)->items); \
+        decaf_free(L); \
+    } while (0)
+
 void ASTNode_free (ASTNode* node)
 {
-    /* clean up attributes */
-    Attribute* next = node->attributes;
-    while (next != NULL) {
-        Attribute* cur = next;
-        next = cur->next;
-        if (cur->dtor != NULL) {
-            cur->dtor(cur->value);
-        }
-        free(cur);
+    /* arena-allocated trees are released in bulk along with the arena */
+    if (Arena_current() != NULL) {
+        return;
     }
 
-    /* clean up node-specific data */
-    switch (node->type) {
-        case PROGRAM:
-            NodeList_free(node->program.variables);
-            NodeList_free(node->program.functions);
-            break;
-        case FUNCDECL:
-            ParameterList_free(node->funcdecl.parameters);
-            ASTNode_free(node->funcdecl.body);
-            break;
-        case BLOCK:
-            NodeList_free(node->block.variables);
-            NodeList_free(node->block.statements);
-            break;
-        case ASSIGNMENT:
-            ASTNode_free(node->assignment.location);
-            ASTNode_free(node->assignment.value);
-            break;
-        case CONDITIONAL:
-            ASTNode_free(node->conditional.condition);
-            ASTNode_free(node->conditional.if_block);
-            if (node->conditional.else_block != NULL) {
-                ASTNode_free(node->conditional.else_block);
-            }
-            break;
-        case WHILELOOP:
-            ASTNode_free(node->whileloop.condition);
-            ASTNode_free(node->whileloop.body);
-            break;
-        case RETURNSTMT:
-            if (node->funcreturn.value != NULL) {
-                ASTNode_free(node->funcreturn.value);
+    /* free iteratively so that deeply-nested trees can't overflow the stack */
+    ASTNode* pending = NULL;
+    PUSH_PENDING(node);
+    while (pending != NULL) {
+        node = pending;
+        pending = node->next;
+
+        /* clean up attributes */
+        AttributeStore* store = node->attributes;
+        if (store != NULL) {
+            Attribute* next = store->list;
+            while (next != NULL) {
+                Attribute* cur = next;
+                next = cur->next;
+                if (cur->dtor != NULL) {
+                    cur->dtor(cur->value);
+                }
+                decaf_free(cur);
             }
-            break;
-        case BINARYOP:
-            ASTNode_free(node->binaryop.left);
-            ASTNode_free(node->binaryop.right);
-            break;
-        case UNARYOP:
-            ASTNode_free(node->unaryop.child);
-            break;
-        case LOCATION:
-            if (node->location.index != NULL) {
-                ASTNode_free(node->location.index);
+            for (int i = NUM_INLINE_ATTRIBUTE_SLOTS; i < NUM_ATTRIBUTE_SLOTS; i++) {
+                if ((store->slot_mask & SLOT_BIT(i)) && slot_dtors[i] != NULL) {
+                    slot_dtors[i](STORED_SLOT(node, i));
+                }
             }
-            break;
-        case FUNCCALL:
-            NodeList_free(node->funccall.arguments);
-            break;
-        default:
-            break;
-    }
+            decaf_free(store);
+        }
 
-    /* clean up node itself */
-    free(node);
+        /* clean up node-specific data (children are queued for later) */
+        switch (node->type) {
+            case PROGRAM:
+                PUSH_PENDING_LIST(node->program.variables);
+                PUSH_PENDING_LIST(node->program.functions);
+                break;
+            case VARDECL:
+                decaf_free((void*)node->vardecl.name);
+                break;
+            case FUNCDECL:
+                decaf_free((void*)node->funcdecl.name);
+                ParameterList_free(node->funcdecl.parameters);
+                PUSH_PENDING(node->funcdecl.body);
+                break;
+            case BLOCK:
+                PUSH_PENDING_LIST(node->block.variables);
+                PUSH_PENDING_LIST(node->block.statements);
+                break;
+            case ASSIGNMENT:
+                PUSH_PENDING(node->assignment.location);
+                PUSH_PENDING(node->assignment.value);
+                break;
+            case CONDITIONAL:
+                PUSH_PENDING(node->conditional.condition);
+                PUSH_PENDING(node->conditional.if_block);
+                if (node->conditional.else_block != NULL) {
+                    PUSH_PENDING(node->conditional.else_block);
+                }
+                break;
+            case WHILELOOP:
+                PUSH_PENDING(node->whileloop.condition);
+                PUSH_PENDING(node->whileloop.body);
+                break;
+            case RETURNSTMT:
+                if (node->funcreturn.value != NULL) {
+                    PUSH_PENDING(node->funcreturn.value);
+                }
+                break;
+            case BINARYOP:
+                PUSH_PENDING(node->binaryop.left);
+                PUSH_PENDING(node->binaryop.right);
+                break;
+            case UNARYOP:
+                PUSH_PENDING(node->unaryop.child);
+                break;
+            case LOCATION:
+                decaf_free((void*)node->location.name);
+                if (node->location.index != NULL) {
+                    PUSH_PENDING(node->location.index);
+                }
+                break;
+            case FUNCCALL:
+                decaf_free((void*)node->funccall.name);
+                PUSH_PENDING_LIST(node->funccall.arguments);
+                break;
+            case LITERAL:
+                if (node->literal.type == STR) {
+                    decaf_free((void*)node->literal.string);
+                }
+                break;
+            default:
+                break;
+        }
+
+        /* clean up node itself */
+        decaf_free(node);
+    }
 }
 
 ASTNode* ProgramNode_new ()
@@ -230,7 +592,7 @@ ASTNode* ProgramNode_new ()
 ASTNode* VarDeclNode_new (const char* name, DecafType type, bool is_array, int array_length, int source_line)
 {
     ASTNode* node = ASTNode_new(VARDECL, source_line);
-    snprintf(node->vardecl.name, MAX_ID_LEN, "%s", name);
+    node->vardecl.name = decaf_intern(name);
     node->vardecl.type = type;
     node->vardecl.is_array = is_array;
     node->vardecl.array_length = array_length;
@@ -240,7 +602,7 @@ ASTNode* VarDeclNode_new (const char* name, DecafType type, bool is_array, int a
 ASTNode* FuncDeclNode_new (const char* name, DecafType return_type, ParameterList* parameters, ASTNode* body, int source_line)
 {
     ASTNode* node = ASTNode_new(FUNCDECL, source_line);
-    snprintf(node->funcdecl.name, MAX_ID_LEN, "%s", name);
+    node->funcdecl.name = decaf_intern(name);
     node->funcdecl.return_type = return_type;
     node->funcdecl.parameters = parameters;
     node->funcdecl.body = body;
@@ -346,7 +708,7 @@ ASTNode* UnaryOpNode_new (UnaryOpType operator, struct ASTNode* child, int sourc
 ASTNode* LocationNode_new (const char* name, struct ASTNode* index, int source_line)
 {
     ASTNode* node = ASTNode_new(LOCATION, source_line);
-    snprintf(node->location.name, MAX_ID_LEN, "%s", name);
+    node->location.name = decaf_intern(name);
     node->location.index = index;
     return node;
 }
@@ -354,7 +716,7 @@ ASTNode* LocationNode_new (const char* name, struct ASTNode* index, int source_l
 ASTNode* FuncCallNode_new (const char* name, int source_line)
 {
     ASTNode* node = ASTNode_new(FUNCCALL, source_line);
-    snprintf(node->funccall.name, MAX_ID_LEN, "%s", name);
+    node->funccall.name = decaf_intern(name);
     node->funccall.arguments = NodeList_new();
     return node;
 }
@@ -379,6 +741,6 @@ ASTNode* LiteralNode_new_string (const char* value, int source_line)
 {
     ASTNode* node = ASTNode_new(LITERAL, source_line);
     node->literal.type = STR;
-    snprintf(node->literal.string, MAX_LINE_LEN, "%s", value);
+    node->literal.string = decaf_intern(value);
     return node;
 }
@@ -1,5 +1,33 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "common.h"
 
+#ifdef DECAF_PROFILE
+#include <pthread.h>
+#undef decaf_calloc
+#endif
+
+_Thread_local jmp_buf decaf_error;
+
+_Thread_local char decaf_error_msg[MAX_ERROR_LEN];
+
+void Error_throw_printf (const char* format, ...)
+{
+    /* delegate to vsnprintf for error message formatting */
+    va_list args;
+    va_start(args, format);
+    vsnprintf(decaf_error_msg, MAX_ERROR_LEN, format, args);
+    va_end(args);
+
+    /* jump to location saved by setjmp */
+    longjmp(decaf_error, 1);
+}
+
 const char* DecafType_to_string(DecafType type)
 {
     switch (type) {
@@ -25,3 +53,520 @@ void print_escaped_string(const char* string, FILE* output)
         }
     }
 }
+
+uint32_t hash_string(const char* string)
+{
+    uint32_t hash = 2166136261u;
+    for (const char* c = string; *c != '\0'; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint64_t hash_bytes(uint64_t hash, const void* bytes, size_t len)
+{
+    const uint8_t* b = (const uint8_t*)bytes;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= b[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/*
+ * chunk payloads start at a fixed offset that keeps them maximally aligned
+ */
+#define ARENA_ALIGN         16
+#define ARENA_ROUND_UP(N)   (((N) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define ARENA_HEADER_SIZE   ARENA_ROUND_UP(sizeof(ArenaChunk))
+
+static _Thread_local Arena* current_arena = NULL;
+
+Arena* Arena_new ()
+{
+    Arena* arena = (Arena*)calloc(1, sizeof(Arena));
+    CHECK_MALLOC_PTR(arena)
+    arena->head = NULL;
+    arena->spare = NULL;
+    arena->total_bytes = 0;
+    arena->strings.entries = NULL;
+    arena->strings.capacity = 0;
+    arena->strings.size = 0;
+    return arena;
+}
+
+void* Arena_alloc (Arena* arena, size_t size)
+{
+    size = ARENA_ROUND_UP(size == 0 ? 1 : size);
+    ArenaChunk* chunk = arena->head;
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+
+        /* oversized requests get a dedicated chunk; regular ones reuse a
+         * spare chunk if there is one */
+        size_t chunk_size = (size > ARENA_CHUNK_SIZE / 2 ? size : ARENA_CHUNK_SIZE);
+        if (chunk_size == ARENA_CHUNK_SIZE && arena->spare != NULL) {
+            chunk = arena->spare;
+            arena->spare = chunk->next;
+        } else {
+            chunk = (ArenaChunk*)calloc(1, ARENA_HEADER_SIZE + chunk_size);
+            CHECK_MALLOC_PTR(chunk)
+            chunk->size = chunk_size;
+        }
+        chunk->used = 0;
+
+        if (arena->head != NULL && chunk_size != ARENA_CHUNK_SIZE) {
+            /* keep filling the current chunk; file the dedicated one behind it */
+            chunk->used = chunk_size;
+            chunk->next = arena->head->next;
+            arena->head->next = chunk;
+            arena->total_bytes += size;
+            return (char*)chunk + ARENA_HEADER_SIZE;
+        }
+        chunk->next = arena->head;
+        arena->head = chunk;
+    }
+    void* ptr = (char*)chunk + ARENA_HEADER_SIZE + chunk->used;
+    chunk->used += size;
+    arena->total_bytes += size;
+    return ptr;
+}
+
+const char* Arena_intern (Arena* arena, const char* string)
+{
+    StringPool* pool = &arena->strings;
+
+    /* grow when more than half full (old entries are abandoned in the arena) */
+    if ((pool->size + 1) * 2 > pool->capacity) {
+        const char** old_entries = pool->entries;
+        int old_capacity = pool->capacity;
+        pool->capacity = (old_capacity == 0 ? 256 : old_capacity * 2);
+        pool->entries = (const char**)Arena_alloc(arena, pool->capacity * sizeof(const char*));
+        uint32_t mask = (uint32_t)pool->capacity - 1;
+        for (int i = 0; i < old_capacity; i++) {
+            if (old_entries[i] != NULL) {
+                uint32_t j = hash_string(old_entries[i]) & mask;
+                while (pool->entries[j] != NULL) {
+                    j = (j + 1) & mask;
+                }
+                pool->entries[j] = old_entries[i];
+            }
+        }
+    }
+
+    uint32_t mask = (uint32_t)pool->capacity - 1;
+    uint32_t i = hash_string(string) & mask;
+    while (pool->entries[i] != NULL) {
+        if (strcmp(pool->entries[i], string) == 0) {
+            return pool->entries[i];
+        }
+        i = (i + 1) & mask;
+    }
+    size_t len = strlen(string);
+    char* copy = (char*)Arena_alloc(arena, len + 1);
+    memcpy(copy, string, len + 1);
+    pool->entries[i] = copy;
+    pool->size++;
+    return copy;
+}
+
+void Arena_reset (Arena* arena)
+{
+    ArenaChunk* next = arena->head;
+    while (next != NULL) {
+        ArenaChunk* cur = next;
+        next = cur->next;
+        if (cur->size == ARENA_CHUNK_SIZE) {
+            /* allocations must be zero-initialized */
+            memset((char*)cur + ARENA_HEADER_SIZE, 0, cur->used);
+            cur->used = 0;
+            cur->next = arena->spare;
+            arena->spare = cur;
+        } else {
+            free(cur);
+        }
+    }
+    arena->head = NULL;
+    arena->total_bytes = 0;
+    arena->strings.entries = NULL;
+    arena->strings.capacity = 0;
+    arena->strings.size = 0;
+}
+
+void Arena_free (Arena* arena)
+{
+    Arena_reset(arena);
+    ArenaChunk* next = arena->spare;
+    while (next != NULL) {
+        ArenaChunk* cur = next;
+        next = cur->next;
+        free(cur);
+    }
+    if (current_arena == arena) {
+        current_arena = NULL;
+    }
+    free(arena);
+}
+
+void Arena_adopt (Arena* arena, Arena* other)
+{
+    /* file the other arena's chunks behind the chunk currently being filled */
+    ArenaChunk* next = other->head;
+    while (next != NULL) {
+        ArenaChunk* cur = next;
+        next = cur->next;
+        if (arena->head == NULL) {
+            cur->next = NULL;
+            arena->head = cur;
+        } else {
+            cur->next = arena->head->next;
+            arena->head->next = cur;
+        }
+    }
+    arena->total_bytes += other->total_bytes;
+    other->head = NULL;
+    other->strings.entries = NULL;
+    Arena_free(other);
+}
+
+void Arena_set_current (Arena* arena)
+{
+    current_arena = arena;
+}
+
+Arena* Arena_current ()
+{
+    return current_arena;
+}
+
+void* decaf_calloc (size_t count, size_t size)
+{
+    if (current_arena != NULL) {
+        return Arena_alloc(current_arena, count * size);
+    }
+    return calloc(count, size);
+}
+
+#ifdef DECAF_PROFILE
+void* decaf_calloc_at (size_t count, size_t size, const char* file, int line)
+{
+    profile_record("allocation", file, line, (unsigned long)(count * size));
+    return decaf_calloc(count, size);
+}
+#endif
+
+const char* decaf_intern (const char* string)
+{
+    if (current_arena != NULL) {
+        return Arena_intern(current_arena, string);
+    }
+    size_t len = strlen(string);
+    char* copy = (char*)malloc(len + 1);
+    CHECK_MALLOC_PTR(copy)
+    memcpy(copy, string, len + 1);
+    return copy;
+}
+
+void decaf_free (void* ptr)
+{
+    if (current_arena == NULL) {
+        free(ptr);
+    }
+}
+
+/*
+ * read everything from a file descriptor into a NUL-terminated heap buffer
+ * (size_hint is the expected size if known, or 0)
+ */
+static bool read_all (int fd, size_t size_hint, SourceText* source)
+{
+    size_t capacity = (size_hint > 0 ? size_hint + 1 : 65536);
+    size_t length = 0;
+    char* text = (char*)malloc(capacity);
+    CHECK_MALLOC_PTR(text)
+    while (true) {
+        if (length + 1 >= capacity) {
+            capacity *= 2;
+            text = (char*)realloc(text, capacity);
+            CHECK_MALLOC_PTR(text)
+        }
+        ssize_t nread = read(fd, text + length, capacity - length - 1);
+        if (nread < 0) {
+            free(text);
+            return false;
+        }
+        if (nread == 0) {
+            break;
+        }
+        length += (size_t)nread;
+    }
+    text[length] = '\0';
+    source->text = text;
+    source->length = length;
+    source->mapped_length = 0;
+    return true;
+}
+
+bool SourceText_read (const char* filename, SourceText* source)
+{
+    if (strcmp(filename, "-") == 0) {
+        return read_all(STDIN_FILENO, 0, source);
+    }
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    /*
+     * map regular files directly; the bytes between the end of the file and
+     * the end of its last page are guaranteed to be zero, so the mapping is
+     * NUL-terminated for free as long as the file doesn't end exactly on a
+     * page boundary
+     */
+    size_t length = (size_t)info.st_size;
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (S_ISREG(info.st_mode) && length > 0 && page_size > 0 && length % (size_t)page_size != 0) {
+        /* copy-on-write: the text may be modified without touching the file */
+        void* map = mmap(NULL, length + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            close(fd);
+            source->text = (char*)map;
+            source->length = length;
+            source->mapped_length = length + 1;
+            return true;
+        }
+    }
+
+    /* otherwise, fall back to a bulk read */
+    bool success = read_all(fd, (S_ISREG(info.st_mode) ? length : 0), source);
+    close(fd);
+    return success;
+}
+
+void SourceText_free (SourceText* source)
+{
+    if (source->mapped_length > 0) {
+        munmap(source->text, source->mapped_length);
+    } else {
+        free(source->text);
+    }
+    source->text = NULL;
+    source->length = 0;
+    source->mapped_length = 0;
+}
+
+OutputBuffer* OutputBuffer_new (FILE* output)
+{
+    OutputBuffer* buffer = (OutputBuffer*)malloc(sizeof(OutputBuffer));
+    CHECK_MALLOC_PTR(buffer)
+    buffer->output = output;
+    buffer->capacity = OUTPUT_BUFFER_FLUSH_SIZE;
+    buffer->data = (char*)malloc(buffer->capacity);
+    CHECK_MALLOC_PTR(buffer->data)
+    buffer->size = 0;
+    return buffer;
+}
+
+/**
+ * @brief Make room for at least the given number of additional characters
+ */
+static void OutputBuffer_reserve (OutputBuffer* buffer, size_t len)
+{
+    if (buffer->size + len > buffer->capacity) {
+        while (buffer->size + len > buffer->capacity) {
+            buffer->capacity *= 2;
+        }
+        buffer->data = (char*)realloc(buffer->data, buffer->capacity);
+        CHECK_MALLOC_PTR(buffer->data)
+    }
+}
+
+void OutputBuffer_write (OutputBuffer* buffer, const char* text, size_t len)
+{
+    OutputBuffer_reserve(buffer, len);
+    memcpy(buffer->data + buffer->size, text, len);
+    buffer->size += len;
+    if (buffer->size >= OUTPUT_BUFFER_FLUSH_SIZE) {
+        OutputBuffer_flush(buffer);
+    }
+}
+
+void OutputBuffer_puts (OutputBuffer* buffer, const char* text)
+{
+    OutputBuffer_write(buffer, text, strlen(text));
+}
+
+void OutputBuffer_put_int (OutputBuffer* buffer, long value)
+{
+    /* write digits backwards from the end of a scratch buffer */
+    char digits[24];
+    char* p = digits + sizeof(digits);
+    unsigned long magnitude = (value < 0 ? 0UL - (unsigned long)value : (unsigned long)value);
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        *--p = '-';
+    }
+    OutputBuffer_write(buffer, p, (size_t)(digits + sizeof(digits) - p));
+}
+
+void OutputBuffer_printf (OutputBuffer* buffer, const char* format, ...)
+{
+    /* format directly into the buffer, growing it if the text doesn't fit */
+    va_list args;
+    va_start(args, format);
+    va_list retry;
+    va_copy(retry, args);
+    size_t available = buffer->capacity - buffer->size;
+    int len = vsnprintf(buffer->data + buffer->size, available, format, args);
+    va_end(args);
+    if (len > 0 && (size_t)len >= available) {
+        OutputBuffer_reserve(buffer, (size_t)len + 1);
+        vsnprintf(buffer->data + buffer->size, (size_t)len + 1, format, retry);
+    }
+    va_end(retry);
+
+    if (len > 0) {
+        buffer->size += (size_t)len;
+        if (buffer->size >= OUTPUT_BUFFER_FLUSH_SIZE) {
+            OutputBuffer_flush(buffer);
+        }
+    }
+}
+
+void OutputBuffer_flush (OutputBuffer* buffer)
+{
+    if (buffer->size > 0) {
+        fwrite(buffer->data, 1, buffer->size, buffer->output);
+        buffer->size = 0;
+    }
+}
+
+void OutputBuffer_free (OutputBuffer* buffer)
+{
+    OutputBuffer_flush(buffer);
+    free(buffer->data);
+    free(buffer);
+}
+
+#ifdef DECAF_PROFILE
+
+/**
+ * @brief Maximum number of distinct sites in a profile (must be a power of two)
+ */
+#define PROFILE_CAPACITY 4096
+
+/**
+ * @brief Maximum length of a site name in a profile (longer names are truncated)
+ */
+#define PROFILE_SITE_LEN 64
+
+/**
+ * @brief Aggregated events of one site
+ */
+typedef struct ProfileEntry
+{
+    const char* category;           /**< @brief Kind of event (or @c NULL for an empty slot) */
+    char site[PROFILE_SITE_LEN];    /**< @brief Site name */
+    int line;                       /**< @brief Source line (or 0) */
+    unsigned long count;            /**< @brief Number of events */
+    unsigned long total;            /**< @brief Sum of the events' amounts */
+} ProfileEntry;
+
+static ProfileEntry profile_entries[PROFILE_CAPACITY];
+static int profile_size = 0;
+static bool profile_overflow = false;
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int ProfileEntry_compare (const void* a, const void* b)
+{
+    const ProfileEntry* x = (const ProfileEntry*)a;
+    const ProfileEntry* y = (const ProfileEntry*)b;
+    int order = strcmp(x->category, y->category);
+    if (order != 0) {
+        return order;
+    }
+    return (x->count < y->count) - (x->count > y->count);
+}
+
+/**
+ * @brief Print the profile, grouped by category and most frequent site first
+ * (registered with @c atexit)
+ */
+static void profile_report ()
+{
+    /* sort a copy so that the table stays valid for any later events */
+    ProfileEntry* entries = (ProfileEntry*)calloc(PROFILE_CAPACITY, sizeof(ProfileEntry));
+    if (entries == NULL) {
+        return;
+    }
+    int n = 0;
+    pthread_mutex_lock(&profile_lock);
+    for (int i = 0; i < PROFILE_CAPACITY; i++) {
+        if (profile_entries[i].category != NULL) {
+            entries[n++] = profile_entries[i];
+        }
+    }
+    pthread_mutex_unlock(&profile_lock);
+    qsort(entries, n, sizeof(ProfileEntry), ProfileEntry_compare);
+
+    fprintf(stderr, "Profile (%d sites%s):\n", n, (profile_overflow ? ", some dropped" : ""));
+    fprintf(stderr, "  %-12s %-44s %14s %14s %10s\n", "category", "site", "events", "total", "average");
+    const char* category = "";
+    for (int i = 0; i < n; i++) {
+        ProfileEntry* e = &entries[i];
+        char site[PROFILE_SITE_LEN + 16];
+        if (e->line > 0) {
+            snprintf(site, sizeof(site), "%s:%d", e->site, e->line);
+        } else {
+            snprintf(site, sizeof(site), "%s", e->site);
+        }
+        fprintf(stderr, "  %-12s %-44s %14lu %14lu %10.2f\n",
+                (strcmp(category, e->category) != 0 ? e->category : ""), site,
+                e->count, e->total, (double)e->total / (double)e->count);
+        category = e->category;
+    }
+    free(entries);
+}
+
+void profile_record (const char* category, const char* site, int line, unsigned long amount)
+{
+    uint32_t hash = hash_string(site) ^ ((uint32_t)line * 2654435761u) ^ hash_string(category);
+    uint32_t mask = PROFILE_CAPACITY - 1;
+
+    pthread_mutex_lock(&profile_lock);
+    if (profile_size == 0) {
+        atexit(profile_report);
+    }
+    for (uint32_t i = hash & mask; ; i = (i + 1) & mask) {
+        ProfileEntry* e = &profile_entries[i];
+        if (e->category == NULL) {
+            /* new site (keep the table at most half full) */
+            if ((profile_size + 1) * 2 > PROFILE_CAPACITY) {
+                profile_overflow = true;
+                break;
+            }
+            e->category = category;
+            snprintf(e->site, PROFILE_SITE_LEN, "%s", site);
+            e->line = line;
+            profile_size++;
+        } else if (e->line != line || strcmp(e->category, category) != 0 ||
+                   strncmp(e->site, site, PROFILE_SITE_LEN - 1) != 0) {
+            continue;
+        }
+        e->count++;
+        e->total += amount;
+        break;
+    }
+    pthread_mutex_unlock(&profile_lock);
+}
+
+#endif
@@ -0,0 +1,114 @@
+/**
+ * @file decaf.c
+ * @brief Library interface for embedding the compiler
+ */
+
+#include "decaf.h"
+#include "p1-lexer.h"
+#include "p2-parser.h"
+#include "p3-analysis.h"
+
+DecafContext* DecafContext_new (ErrorMode mode)
+{
+    DecafContext* context = (DecafContext*)calloc(1, sizeof(DecafContext));
+    CHECK_MALLOC_PTR(context)
+    context->arena = Arena_new();
+    context->error_mode = mode;
+    context->tree = NULL;
+    context->errors = NULL;
+    context->has_fatal_error = false;
+    context->fatal_error[0] = '\0';
+    return context;
+}
+
+/**
+ * @brief Run the front end, catching fatal errors
+ *
+ * Must be called with the context's arena installed as the current arena.
+ *
+ * @returns Root of AST (or @c NULL if there was a fatal error)
+ */
+static ASTNode* DecafContext_parse (DecafContext* context, const char* text)
+{
+    /* save the caller's handler (if any) so that nested use is safe */
+    jmp_buf saved_handler;
+    memcpy(saved_handler, decaf_error, sizeof(jmp_buf));
+
+    /* volatile so that their values survive a longjmp from a fatal error */
+    TokenQueue* volatile tokens = NULL;
+    ASTNode* volatile tree = NULL;
+
+    if (setjmp(decaf_error) == 0) {
+        tokens = lex_stream(text);
+        tree = parse(tokens);
+    } else {
+        snprintf(context->fatal_error, MAX_ERROR_LEN, "%s", decaf_error_msg);
+        context->has_fatal_error = true;
+        tree = NULL;
+    }
+    if (tokens != NULL) {
+        TokenQueue_free(tokens);
+    }
+
+    memcpy(decaf_error, saved_handler, sizeof(jmp_buf));
+    return tree;
+}
+
+bool DecafContext_compile_string (DecafContext* context, const char* text)
+{
+    DecafContext_reset(context);
+
+    Arena* saved_arena = Arena_current();
+    Arena_set_current(context->arena);
+
+    context->tree = DecafContext_parse(context, text);
+    if (context->tree != NULL) {
+        NodeVisitor* setup = CompositeVisitor_new();
+        CompositeVisitor_add(setup, SetParentVisitor_new());
+        CompositeVisitor_add(setup, CalcDepthVisitor_new());
+        CompositeVisitor_add(setup, BuildSymbolTablesVisitor_new());
+        NodeVisitor_traverse_and_free(setup, context->tree);
+        context->errors = analyze_with_mode(context->tree, context->error_mode);
+    }
+
+    Arena_set_current(saved_arena);
+    return context->tree != NULL && ErrorList_size(context->errors) == 0;
+}
+
+ErrorList* DecafContext_get_errors (DecafContext* context)
+{
+    return context->errors;
+}
+
+const char* DecafContext_get_fatal_error (DecafContext* context)
+{
+    return (context->has_fatal_error ? context->fatal_error : NULL);
+}
+
+ASTNode* DecafContext_get_tree (DecafContext* context)
+{
+    return context->tree;
+}
+
+void DecafContext_reset (DecafContext* context)
+{
+    /* the error list itself lives in the arena, but its buffers don't */
+    if (context->errors != NULL) {
+        Arena* saved_arena = Arena_current();
+        Arena_set_current(context->arena);
+        ErrorList_free(context->errors);
+        Arena_set_current(saved_arena);
+    }
+    Arena_reset(context->arena);
+    context->tree = NULL;
+    context->errors = NULL;
+    context->has_fatal_error = false;
+    context->fatal_error[0] = '\0';
+}
+
+void DecafContext_free (DecafContext* context)
+{
+    DecafContext_reset(context);
+    Arena_free(context->arena);
+    free(context);
+}
@@ -3,97 +3,382 @@
  * @brief Compiler driver
  */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
 #include "p1-lexer.h"
 #include "p2-parser.h"
 #include "p3-analysis.h"
+#include "serialize.h"
 
 /**
- * @brief Error message buffer
+ * @brief Process environment (passed along to Graphviz)
  */
-char decaf_error_msg[MAX_ERROR_LEN];
+extern char** environ;
 
 /**
- * @brief Data structure used by @c setjmp / @c longjmp for exception handling
+ * @brief Size (in bytes) of the output buffer used when writing DOT files
  */
-jmp_buf decaf_error;
+#define GRAPH_BUFFER_SIZE 65536
 
 /**
- * @brief Throw an exception with an error message using printf syntax
- *
- * This function is declared in common.h but must be defined here in main.c
- * because that's where the @c jmp_buf declaration is.
+ * @brief Format of compilation statistics (--stats)
+ */
+typedef enum StatsFormat {
+    NO_STATS, TEXT_STATS, JSON_STATS
+} StatsFormat;
+
+/**
+ * @brief Command-line options that apply to every compilation
  */
-void Error_throw_printf (const char* format, ...)
+typedef struct DriverOptions
 {
-    /* delegate to vsnprintf for error message formatting */
-    va_list args;
-    va_start(args, format);
-    vsnprintf(decaf_error_msg, MAX_ERROR_LEN, format, args);
-    va_end(args);
+    bool emit_dot;          /**< @brief Write the AST in DOT format (--emit-dot) */
+    const char* dot_path;   /**< @brief DOT output path (@c NULL to derive it from the source filename) */
+    bool emit_png;          /**< @brief Also render the DOT output to PNG with Graphviz (--emit-png) */
+    const char* png_path;   /**< @brief PNG output path (@c NULL to derive it from the source filename) */
+    bool emit_ast;          /**< @brief Save the analyzed AST in binary format (--emit-ast) */
+    const char* ast_path;   /**< @brief Binary AST output path (@c NULL to derive it from the source filename) */
+    int num_threads;        /**< @brief Number of worker threads for batch mode (-j) */
+    AnalysisCache* analysis_cache;  /**< @brief Per-function results shared by successive
+                                         compilations (--incremental; otherwise @c NULL) */
+    const char* cache_dir;  /**< @brief Directory of cached results (--cache-dir; otherwise @c NULL) */
+    StatsFormat stats;      /**< @brief Report per-phase statistics for each compilation (--stats) */
+    ErrorMode error_mode;   /**< @brief Which analysis errors to report (--errors) */
+    int analysis_threads;   /**< @brief Number of threads for analyzing the functions of each file
+                                 (--analysis-threads) */
+    SymbolFormat symbol_format;     /**< @brief Format of the symbol table output (--symbols) */
+} DriverOptions;
 
-    /* jump to location saved by setjmp */
-    longjmp(decaf_error, 1);
+/**
+ * @brief Build an output filename by replacing a source file's extension
+ *
+ * @param filename Source filename (a ".decaf" extension will be replaced)
+ * @param extension New extension (including the dot)
+ * @returns Newly-allocated output filename
+ */
+char* derive_output_path (const char* filename, const char* extension)
+{
+    size_t len = strlen(filename);
+    const char* suffix = ".decaf";
+    if (len > strlen(suffix) && strcmp(filename + len - strlen(suffix), suffix) == 0) {
+        len -= strlen(suffix);
+    }
+    char* path = (char*)malloc(len + strlen(extension) + 1);
+    CHECK_MALLOC_PTR(path)
+    memcpy(path, filename, len);
+    strcpy(path + len, extension);
+    return path;
 }
 
 /**
- * @brief Read all text data from a file
+ * @brief Render a DOT file to PNG by running Graphviz directly (no shell)
  *
- * @param filename Name of file to read
- * @param text String buffer destination (must be #MAX_FILE_SIZE characters long)
- * @returns True if and only if the file read was successful.
+ * @returns True if and only if Graphviz ran successfully
  */
-bool read_file (const char* filename, char* text)
+bool render_png (const char* dot_path, const char* png_path)
 {
-    FILE* input = fopen(filename, "r");
-    if (input == NULL) {
+    char* args[] = { "dot", "-Tpng", "-o", (char*)png_path, (char*)dot_path, NULL };
+    pid_t pid;
+    if (posix_spawnp(&pid, "dot", NULL, NULL, args, environ) != 0) {
         return false;
     }
-    size_t nchars = 0;
-    char* p = text;
-    int c;
-    while (nchars < MAX_FILE_SIZE && (c = fgetc(input)) != EOF) {
-        *p++ = (char)c;
-        nchars++;
+    int status;
+    if (waitpid(pid, &status, 0) < 0) {
+        return false;
     }
-    *p = '\0';
-    fclose(input);
-    return true;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
 }
 
 /**
- * @brief Compiler entry point
+ * @brief Write the requested graphical AST outputs for a compiled file
  *
- * @param argc Number of command-line arguments
- * @param argv Array of command-line argument strings
- * @returns @c EXIT_SUCCESS if the compilation succeeds and @c EXIT_FAILURE
+ * @param tree Fully-annotated AST
+ * @param filename Source filename (used to derive output paths)
+ * @param options Graph output options
+ * @param error_output Stream for error messages
+ */
+void emit_graph (ASTNode* tree, const char* filename, const DriverOptions* options, FILE* error_output)
+{
+    char* dot_path = (options->dot_path != NULL ? (char*)options->dot_path
+                                                : derive_output_path(filename, ".dot"));
+    FILE* graph_file = fopen(dot_path, "w");
+    if (graph_file != NULL) {
+        setvbuf(graph_file, NULL, _IOFBF, GRAPH_BUFFER_SIZE);
+        NodeVisitor_traverse_and_free(GenerateASTGraph_new(graph_file), tree);
+        fclose(graph_file);
+
+        if (options->emit_png) {
+            char* png_path = (options->png_path != NULL ? (char*)options->png_path
+                                                        : derive_output_path(filename, ".png"));
+            if (!render_png(dot_path, png_path)) {
+                fprintf(error_output, "Could not run dot to generate %s\n", png_path);
+            }
+            if (png_path != options->png_path) {
+                free(png_path);
+            }
+        }
+    } else {
+        fprintf(error_output, "Could not write file: %s\n", dot_path);
+    }
+    if (dot_path != options->dot_path) {
+        free(dot_path);
+    }
+}
+
+/**
+ * @brief Save an analyzed AST in binary format (see serialize.h)
+ *
+ * @param tree Fully-annotated AST
+ * @param filename Source filename (used to derive the output path)
+ * @param options Output options
+ * @param error_output Stream for error messages
+ */
+void emit_ast (ASTNode* tree, const char* filename, const DriverOptions* options, FILE* error_output)
+{
+    char* ast_path = (options->ast_path != NULL ? (char*)options->ast_path
+                                                : derive_output_path(filename, ".ast"));
+    FILE* ast_file = fopen(ast_path, "wb");
+    bool success = false;
+    if (ast_file != NULL) {
+        setvbuf(ast_file, NULL, _IOFBF, GRAPH_BUFFER_SIZE);
+        success = ASTNode_write_binary(tree, ast_file);
+        success = (fclose(ast_file) == 0) && success;
+    }
+    if (!success) {
+        fprintf(error_output, "Could not write file: %s\n", ast_path);
+    }
+    if (ast_path != options->ast_path) {
+        free(ast_path);
+    }
+}
+
+/**
+ * @brief Reload an AST saved with <tt>--emit-ast</tt> and print its symbol tables
+ *
+ * This skips the whole front end and the analysis, so the output is the same
+ * as that of the successful compilation that saved the file.
+ *
+ * @param filename Name of binary AST file
+ * @param options Output options
+ * @param output Stream for regular output (symbol tables)
+ * @param error_output Stream for fatal error messages
+ * @returns @c EXIT_SUCCESS if the file was loaded and @c EXIT_FAILURE
  * otherwise
  */
-int main(int argc, char** argv)
+int load_ast_file (const char* filename, const DriverOptions* options, FILE* output, FILE* error_output)
 {
-    /* check for filename */
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <decaf-filename>\n", argv[0]);
+    Arena* arena = Arena_new();
+    Arena_set_current(arena);
+
+    ASTNode* tree = ASTNode_read_binary(filename);
+    if (tree == NULL) {
+        fprintf(error_output, "Invalid AST file: %s\n", filename);
+        Arena_free(arena);
         return EXIT_FAILURE;
     }
-    char* filename = argv[argc-1];
+    NodeVisitor_traverse_and_free(PrintSymbolsVisitor_new_with_format(output, options->symbol_format), tree);
+    if (options->emit_dot) {
+        emit_graph(tree, filename, options, error_output);
+    }
 
-    /* read file */
-    char text[MAX_FILE_SIZE];
-    if (!read_file(filename, text)) {
-        fprintf(stderr, "Could not read file: %s", filename);
-        exit(EXIT_FAILURE);
+    ASTNode_free(tree);
+    Arena_free(arena);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Compiler phases measured by --stats
+ */
+typedef enum Phase {
+    FRONT_END_PHASE,    /**< @brief Lexing and parsing (interleaved, so measured together) */
+    SETUP_PHASE,        /**< @brief Parent links, depths, and symbol tables (one fused traversal) */
+    ANALYSIS_PHASE,     /**< @brief Static analysis */
+    OUTPUT_PHASE,       /**< @brief Printing errors and symbol tables */
+    GRAPH_PHASE,        /**< @brief DOT/PNG generation */
+    AST_PHASE,          /**< @brief Binary AST output */
+    NUM_PHASES
+} Phase;
+
+static const char* const phase_names[NUM_PHASES] = {
+    "front_end", "setup", "analysis", "output", "graph", "ast"
+};
+
+/**
+ * @brief Resources used by a single phase
+ */
+typedef struct PhaseStats
+{
+    bool ran;                   /**< @brief True if the phase ran at all */
+    double seconds;             /**< @brief Wall time */
+    size_t bytes;               /**< @brief Bytes allocated from the compilation's arena */
+    AttributeStats lookups;     /**< @brief AST attribute accesses */
+} PhaseStats;
+
+/**
+ * @brief Statistics for a single compilation (see --stats)
+ */
+typedef struct CompileStats
+{
+    PhaseStats phases[NUM_PHASES];  /**< @brief Per-phase measurements */
+    PhaseStats start;               /**< @brief Counters at the start of the current phase */
+    size_t tokens;                  /**< @brief Number of tokens lexed */
+    size_t nodes;                   /**< @brief Number of AST nodes */
+    size_t symbols;                 /**< @brief Number of symbols in all symbol tables */
+} CompileStats;
+
+/**
+ * @brief Peak resident set size of the process so far (in KiB, or 0 if unknown)
+ */
+static long peak_rss_kb ()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
     }
+    return usage.ru_maxrss;
+}
+
+static double wall_time ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Record the counters at the start of a phase
+ */
+void CompileStats_begin (CompileStats* stats, Arena* arena)
+{
+    stats->start.seconds = wall_time();
+    stats->start.bytes = arena->total_bytes;
+    stats->start.lookups = attribute_stats;
+}
+
+/**
+ * @brief Charge everything since the last @ref CompileStats_begin to a phase
+ */
+void CompileStats_end (CompileStats* stats, Phase phase, Arena* arena)
+{
+    PhaseStats* p = &stats->phases[phase];
+    p->ran = true;
+    p->seconds += wall_time() - stats->start.seconds;
+    p->bytes += arena->total_bytes - stats->start.bytes;
+    p->lookups.slot_lookups += attribute_stats.slot_lookups - stats->start.lookups.slot_lookups;
+    p->lookups.keyed_lookups += attribute_stats.keyed_lookups - stats->start.lookups.keyed_lookups;
+}
+
+/*
+ * count nodes and symbols (the counts are accumulated in the visitor's data,
+ * which belongs to the caller)
+ */
+void CountVisitor_previsit (NodeVisitor* visitor, ASTNode* node)
+{
+    CompileStats* stats = (CompileStats*)visitor->data;
+    stats->nodes++;
+    if (ASTNode_has_slot_attribute(node, SYMBOL_TABLE_SLOT)) {
+        SymbolTable* table = (SymbolTable*)ASTNode_get_slot_attribute(node, SYMBOL_TABLE_SLOT);
+        stats->symbols += (size_t)SymbolList_size(table->local_symbols);
+    }
+}
+
+/**
+ * @brief Print the statistics of a compilation
+ *
+ * The peak resident set size is that of the whole process so far (in batch
+ * mode, it covers every compilation up to this one).
+ *
+ * @param stats Statistics to print
+ * @param filename Source filename
+ * @param format Text (a table) or JSON (a single line)
+ * @param output Output stream
+ */
+void CompileStats_print (const CompileStats* stats, const char* filename, StatsFormat format, FILE* output)
+{
+    double total = 0.0;
+    for (int i = 0; i < NUM_PHASES; i++) {
+        total += stats->phases[i].seconds;
+    }
+
+    if (format == JSON_STATS) {
+        fprintf(output, "{\"file\": \"");
+        print_escaped_string(filename, output);
+        fprintf(output, "\", \"tokens\": %zu, \"nodes\": %zu, \"symbols\": %zu, \"total_ms\": %.3f, "
+                        "\"peak_rss_kb\": %ld, \"phases\": {",
+                stats->tokens, stats->nodes, stats->symbols, total * 1000.0, peak_rss_kb());
+        const char* separator = "";
+        for (int i = 0; i < NUM_PHASES; i++) {
+            const PhaseStats* p = &stats->phases[i];
+            if (p->ran) {
+                fprintf(output, "%s\"%s\": {\"ms\": %.3f, \"bytes\": %zu, "
+                                "\"slot_lookups\": %lu, \"keyed_lookups\": %lu}",
+                        separator, phase_names[i], p->seconds * 1000.0, p->bytes,
+                        p->lookups.slot_lookups, p->lookups.keyed_lookups);
+                separator = ", ";
+            }
+        }
+        fprintf(output, "}}\n");
+        return;
+    }
+
+    fprintf(output, "Statistics for %s: %zu tokens, %zu nodes, %zu symbols\n",
+            filename, stats->tokens, stats->nodes, stats->symbols);
+    fprintf(output, "  %-10s %10s %12s %14s %14s\n", "phase", "time (ms)", "bytes", "slot lookups", "keyed lookups");
+    for (int i = 0; i < NUM_PHASES; i++) {
+        const PhaseStats* p = &stats->phases[i];
+        if (p->ran) {
+            fprintf(output, "  %-10s %10.3f %12zu %14lu %14lu\n", phase_names[i], p->seconds * 1000.0,
+                    p->bytes, p->lookups.slot_lookups, p->lookups.keyed_lookups);
+        }
+    }
+    fprintf(output, "  %-10s %10.3f\n", "total", total * 1000.0);
+    fprintf(output, "  peak RSS: %ld KiB\n", peak_rss_kb());
+}
+
+/**
+ * @brief Compile (i.e., lex, parse, and analyze) Decaf source text
+ *
+ * @param filename Name of the source file (used to derive output paths)
+ * @param source Source text (deallocated by this function)
+ * @param options Output options
+ * @param output Stream for regular output (errors and symbol tables)
+ * @param error_output Stream for fatal error messages
+ * @returns @c EXIT_SUCCESS if the compilation succeeds and @c EXIT_FAILURE
+ * otherwise
+ */
+int compile_source (const char* filename, SourceText* source, const DriverOptions* options,
+                    FILE* output, FILE* error_output)
+{
+    /* all AST, symbol, and error data for this compilation comes from one arena */
+    Arena* arena = Arena_new();
+    Arena_set_current(arena);
+
+    CompileStats stats;
+    memset(&stats, 0, sizeof(stats));
+    attribute_stats_enabled = (options->stats != NO_STATS);
 
     /* FRONT END */
 
-    TokenQueue* tokens = NULL;
-    ASTNode* tree = NULL;
+    /* volatile so that their values survive a longjmp from a fatal error */
+    TokenQueue* volatile tokens = NULL;
+    ASTNode* volatile tree = NULL;
 
     /* fatal errors are possible in the front end, so check for them */
+    CompileStats_begin(&stats, arena);
     if (setjmp(decaf_error) == 0) {
 
-        /* PROJECT 1: lexer */
-        tokens = lex(text);
+        /* PROJECT 1: lexer (tokens are produced on demand as the parser
+         * consumes them) */
+        tokens = lex_stream(source->text);
 
         /* PROJECT 2: parser */
         tree = parse(tokens);
@@ -101,52 +386,725 @@ int main(int argc, char** argv)
     } else {
 
         /* handle fatal error: print message and clean up */
-        fprintf(stderr, "%s", decaf_error_msg);
+        fprintf(error_output, "%s", decaf_error_msg);
+        if (options->stats != NO_STATS) {
+            CompileStats_end(&stats, FRONT_END_PHASE, arena);
+            stats.tokens = (tokens != NULL ? tokens->size : 0);
+            CompileStats_print(&stats, filename, options->stats, error_output);
+        }
         if (tokens   != NULL) TokenQueue_free(tokens);
         if (tree     != NULL) ASTNode_free(tree);
-        exit(EXIT_FAILURE);
+        SourceText_free(source);
+        Arena_free(arena);
+        return EXIT_FAILURE;
     }
 
-    /* clean up tokens (no longer needed) */
+    /* clean up tokens and source text (no longer needed) */
+    CompileStats_end(&stats, FRONT_END_PHASE, arena);
+    stats.tokens = tokens->size;
     TokenQueue_free(tokens);
     tokens = NULL;
-
-    /* set up parent links and calculate node depths */
-    NodeVisitor_traverse_and_free(SetParentVisitor_new(), tree);
-    NodeVisitor_traverse_and_free(CalcDepthVisitor_new(), tree);
+    SourceText_free(source);
 
     /* MIDDLE END */
 
-    /* build symbol tables */
-    NodeVisitor_traverse_and_free(BuildSymbolTablesVisitor_new(), tree);
+    /* set up parent links, calculate node depths, and build symbol tables
+     * (fused into a single traversal) */
+    CompileStats_begin(&stats, arena);
+    NodeVisitor* setup = CompositeVisitor_new();
+    CompositeVisitor_add(setup, SetParentVisitor_new());
+    CompositeVisitor_add(setup, CalcDepthVisitor_new());
+    CompositeVisitor_add(setup, BuildSymbolTablesVisitor_new());
+    NodeVisitor_traverse_and_free(setup, tree);
+    CompileStats_end(&stats, SETUP_PHASE, arena);
 
-    /* PROJECT 3: analysis */
-    ErrorList* errors = analyze(tree);
+    /* PROJECT 3: analysis (only re-analyzing changed functions if there are
+     * results from a previous compilation) */
+    CompileStats_begin(&stats, arena);
+    ErrorList* errors = (options->analysis_cache != NULL
+                         ? analyze_incremental(tree, options->analysis_cache)
+                         : analyze_parallel(tree, options->analysis_threads, options->error_mode));
+    CompileStats_end(&stats, ANALYSIS_PHASE, arena);
 
     /* output */
-    FOR_EACH(AnalysisError*, err, errors) {
-        printf("%s\n", err->message);
+    CompileStats_begin(&stats, arena);
+    if (options->error_mode == COUNT_ERRORS_ONLY) {
+        fprintf(output, "%d errors\n", ErrorList_size(errors));
+    } else {
+        ErrorList_print(errors, output);
     }
 
-    /* print symbol tables if there are no errors */
+    /* print symbol tables (and save the AST, if requested) if there are no
+     * errors */
     if (ErrorList_size(errors) == 0) {
-        NodeVisitor_traverse_and_free(PrintSymbolsVisitor_new(stdout), tree);
+        NodeVisitor_traverse_and_free(PrintSymbolsVisitor_new_with_format(output, options->symbol_format), tree);
+        CompileStats_end(&stats, OUTPUT_PHASE, arena);
+        if (options->emit_ast) {
+            CompileStats_begin(&stats, arena);
+            emit_ast(tree, filename, options, error_output);
+            CompileStats_end(&stats, AST_PHASE, arena);
+        }
+    } else {
+        CompileStats_end(&stats, OUTPUT_PHASE, arena);
     }
 
-    /* generate graphical AST */
-    FILE* graph_file = fopen("ast.dot", "w");
-    if (graph_file != NULL) {
-        NodeVisitor_traverse_and_free(GenerateASTGraph_new(graph_file), tree);
-        fclose(graph_file);
+    /* generate graphical AST (if requested) */
+    if (options->emit_dot) {
+        CompileStats_begin(&stats, arena);
+        emit_graph(tree, filename, options, error_output);
+        CompileStats_end(&stats, GRAPH_PHASE, arena);
     }
 
-    /* Added from P# doc to print image */
-    system("dot -Tpng -o ast.png ast.dot");
+    /* report statistics (if requested) */
+    if (options->stats != NO_STATS) {
+        NodeVisitor* counter = NodeVisitor_new();
+        counter->data = &stats;
+        counter->previsit_default = CountVisitor_previsit;
+        NodeVisitor_traverse_and_free(counter, tree);
+        CompileStats_print(&stats, filename, options->stats, error_output);
+    }
 
     /* clean up */
     ASTNode_free(tree);
     ErrorList_free(errors);
     errors = NULL;
+    Arena_free(arena);
 
     return EXIT_SUCCESS;
 }
+
+/**
+ * @brief Version of the compiler's output format
+ *
+ * This is part of every result cache key (see @ref result_cache_path) along
+ * with a hash of the compiler executable (see @ref build_identity).
+ */
+#define DECAF_VERSION "3.1"
+
+/**
+ * @brief First line of each result cache file
+ */
+#define RESULT_CACHE_MAGIC "decaf-result-cache"
+
+/**
+ * @brief Hash of the running executable (computed once; see @ref build_identity)
+ */
+static uint64_t build_hash[2];
+
+/**
+ * @brief True if @ref build_hash could be computed
+ */
+static bool build_hash_known = false;
+
+static pthread_once_t build_hash_once = PTHREAD_ONCE_INIT;
+
+static void compute_build_hash ()
+{
+    SourceText exe;
+    if (SourceText_read("/proc/self/exe", &exe)) {
+        build_hash[0] = hash_bytes(HASH_SEED, exe.text, exe.length);
+        build_hash[1] = hash_bytes(HASH_SEED ^ (uint64_t)exe.length, exe.text, exe.length);
+        build_hash_known = true;
+        SourceText_free(&exe);
+    }
+}
+
+/**
+ * @brief Retrieve the identity of this build of the compiler
+ *
+ * The identity is a 128-bit hash of the executable file, so it changes with
+ * any rebuild that changes the compiler (not just one of the driver). It is
+ * computed on first use and is safe to call from any thread.
+ *
+ * @param id Where to store the identity
+ * @returns True if and only if the executable could be read (otherwise there
+ * is no identity and the result cache must not be used)
+ */
+bool build_identity (uint64_t id[2])
+{
+    pthread_once(&build_hash_once, compute_build_hash);
+    id[0] = build_hash[0];
+    id[1] = build_hash[1];
+    return build_hash_known;
+}
+
+/**
+ * @brief Build the path of the result cache file for some source text
+ *
+ * The file is named after a 128-bit hash of the compiler version, the build
+ * identity, and the source bytes, so cached results are never reused by a
+ * different build of the compiler.
+ *
+ * @param cache_dir Cache directory
+ * @param source Source text
+ * @param build Build identity (see @ref build_identity)
+ * @returns Newly-allocated path
+ */
+char* result_cache_path (const char* cache_dir, const SourceText* source, const uint64_t build[2])
+{
+    const char* version = DECAF_VERSION;
+    uint64_t h1 = hash_bytes(HASH_SEED, version, strlen(version));
+    h1 = hash_bytes(h1, &build[0], sizeof(uint64_t));
+    h1 = hash_bytes(h1, source->text, source->length);
+    uint64_t h2 = hash_bytes(HASH_SEED ^ (uint64_t)source->length, source->text, source->length);
+    h2 = hash_bytes(h2, &build[1], sizeof(uint64_t));
+    h2 = hash_bytes(h2, version, strlen(version));
+
+    size_t len = strlen(cache_dir) + 48;
+    char* path = (char*)malloc(len);
+    CHECK_MALLOC_PTR(path)
+    snprintf(path, len, "%s/%016" PRIx64 "%016" PRIx64 ".out", cache_dir, h1, h2);
+    return path;
+}
+
+/**
+ * @brief Replay a cached compilation result
+ *
+ * A cache file consists of a header line (the magic string, exit status,
+ * and the lengths of the two outputs) followed by the regular output and then
+ * the fatal error output.
+ *
+ * @param path Result cache file
+ * @param output Stream for regular output
+ * @param error_output Stream for fatal error messages
+ * @param status Location to store the cached exit status
+ * @returns True if and only if a valid cached result was found and replayed
+ */
+bool load_cached_result (const char* path, FILE* output, FILE* error_output, int* status)
+{
+    SourceText cached;
+    if (!SourceText_read(path, &cached)) {
+        return false;
+    }
+    size_t output_len = 0, error_len = 0;
+    int header_len = 0;
+    if (sscanf(cached.text, RESULT_CACHE_MAGIC " %d %zu %zu%*1[\n]%n",
+               status, &output_len, &error_len, &header_len) != 3 || header_len == 0 ||
+            (size_t)header_len + output_len + error_len != cached.length) {
+        SourceText_free(&cached);
+        return false;
+    }
+    fwrite(cached.text + header_len, 1, output_len, output);
+    fwrite(cached.text + header_len + output_len, 1, error_len, error_output);
+    SourceText_free(&cached);
+    return true;
+}
+
+/**
+ * @brief Save a compilation result in the cache
+ *
+ * The file is written under a temporary name and then renamed into place, so
+ * concurrent compilers never see a partial result. Failures are ignored (the
+ * result just isn't cached).
+ */
+void store_cached_result (const char* cache_dir, const char* path, int status,
+                          const char* output, size_t output_len,
+                          const char* error_output, size_t error_len)
+{
+    mkdir(cache_dir, 0777);     /* fails harmlessly if it already exists */
+
+    size_t len = strlen(cache_dir) + 16;
+    char* tmp_path = (char*)malloc(len);
+    CHECK_MALLOC_PTR(tmp_path)
+    snprintf(tmp_path, len, "%s/tmp.XXXXXX", cache_dir);
+    int fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        free(tmp_path);
+        return;
+    }
+    FILE* file = fdopen(fd, "w");
+    if (file == NULL) {
+        close(fd);
+        unlink(tmp_path);
+        free(tmp_path);
+        return;
+    }
+    fprintf(file, RESULT_CACHE_MAGIC " %d %zu %zu\n", status, output_len, error_len);
+    fwrite(output, 1, output_len, file);
+    fwrite(error_output, 1, error_len, file);
+    bool ok = !ferror(file);
+    if (fclose(file) != 0 || !ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+}
+
+/**
+ * @brief Compile (i.e., lex, parse, and analyze) a single Decaf source file
+ *
+ * Any errors are reported and all memory used by the compilation is released
+ * before returning, so this may be called repeatedly in a single process.
+ *
+ * If a cache directory is configured, the result is looked up there (keyed on
+ * the source bytes and compiler version) and replayed without lexing or
+ * parsing; otherwise, the result is stored there for next time. Compilations
+ * that write graph or AST output or report statistics always run in full.
+ *
+ * Files with an ".ast" extension are assumed to have been written by
+ * <tt>--emit-ast</tt> and are reloaded (see @ref load_ast_file) instead.
+ *
+ * All state is local to the call (or thread-local), so multiple files may be
+ * compiled concurrently on different threads.
+ *
+ * @param filename Name of file to compile
+ * @param options Output options
+ * @param output Stream for regular output (errors and symbol tables)
+ * @param error_output Stream for fatal error messages
+ * @returns @c EXIT_SUCCESS if the compilation succeeds and @c EXIT_FAILURE
+ * otherwise
+ */
+int compile_file (const char* filename, const DriverOptions* options, FILE* output, FILE* error_output)
+{
+    /* reload saved ASTs */
+    size_t len = strlen(filename);
+    if (len > 4 && strcmp(filename + len - 4, ".ast") == 0) {
+        return load_ast_file(filename, options, output, error_output);
+    }
+
+    /* read file */
+    SourceText source;
+    if (!SourceText_read(filename, &source)) {
+        fprintf(error_output, "Could not read file: %s\n", filename);
+        return EXIT_FAILURE;
+    }
+    uint64_t build[2];
+    if (options->cache_dir == NULL || options->emit_dot || options->emit_ast ||
+            options->stats != NO_STATS || options->error_mode != ALL_ERRORS ||
+            options->symbol_format != TEXT_SYMBOLS || !build_identity(build)) {
+        return compile_source(filename, &source, options, output, error_output);
+    }
+
+    /* cache hit: replay the stored result */
+    int status = EXIT_SUCCESS;
+    char* path = result_cache_path(options->cache_dir, &source, build);
+    if (load_cached_result(path, output, error_output, &status)) {
+        SourceText_free(&source);
+        free(path);
+        return status;
+    }
+
+    /* cache miss: capture the result so that it can be stored */
+    char* captured_output = NULL;
+    char* captured_error = NULL;
+    size_t output_len = 0, error_len = 0;
+    FILE* capture = open_memstream(&captured_output, &output_len);
+    FILE* error_capture = open_memstream(&captured_error, &error_len);
+    CHECK_MALLOC_PTR(capture)
+    CHECK_MALLOC_PTR(error_capture)
+    status = compile_source(filename, &source, options, capture, error_capture);
+    fclose(capture);
+    fclose(error_capture);
+
+    store_cached_result(options->cache_dir, path, status,
+                        captured_output, output_len, captured_error, error_len);
+    fwrite(captured_output, 1, output_len, output);
+    fwrite(captured_error, 1, error_len, error_output);
+    free(captured_output);
+    free(captured_error);
+    free(path);
+    return status;
+}
+
+/**
+ * @brief Print the delimiter that precedes each file's output in batch mode
+ */
+#define PRINT_BATCH_DELIMITER(FILENAME) printf("==> %s <==\n", FILENAME)
+
+/**
+ * @brief Batch of files to compile (see @ref compile_batch)
+ */
+typedef struct Batch
+{
+    char** filenames;       /**< @brief Files to compile, in order */
+    int count;              /**< @brief Number of files */
+    int capacity;           /**< @brief Allocated length of @c filenames */
+    int failures;           /**< @brief Number of files that could not be read (or compiled) */
+} Batch;
+
+/**
+ * @brief Add a file to a batch
+ */
+void Batch_add (Batch* batch, const char* filename)
+{
+    if (batch->count == batch->capacity) {
+        batch->capacity = (batch->capacity == 0 ? 64 : batch->capacity * 2);
+        batch->filenames = (char**)realloc(batch->filenames, batch->capacity * sizeof(char*));
+        CHECK_MALLOC_PTR(batch->filenames)
+    }
+    char* copy = (char*)malloc(strlen(filename) + 1);
+    CHECK_MALLOC_PTR(copy)
+    strcpy(copy, filename);
+    batch->filenames[batch->count++] = copy;
+}
+
+/**
+ * @brief Add every file listed in a manifest (one filename per line) to a batch
+ *
+ * Blank lines and lines beginning with '#' are ignored.
+ *
+ * @param batch Batch to add to
+ * @param manifest Name of manifest file
+ * @returns True if and only if the manifest could be read
+ */
+bool Batch_add_manifest (Batch* batch, const char* manifest)
+{
+    FILE* list = fopen(manifest, "r");
+    if (list == NULL) {
+        return false;
+    }
+    /* the line buffer grows as needed, so paths of any length are kept whole */
+    char* line = NULL;
+    size_t line_capacity = 0;
+    while (getline(&line, &line_capacity, list) != -1) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0' && line[0] != '#') {
+            Batch_add(batch, line);
+        }
+    }
+    free(line);
+    fclose(list);
+    return true;
+}
+
+/**
+ * @brief Deallocate the file list of a batch
+ */
+void Batch_free (Batch* batch)
+{
+    for (int i = 0; i < batch->count; i++) {
+        free(batch->filenames[i]);
+    }
+    free(batch->filenames);
+}
+
+/**
+ * @brief Result of a single compilation in a parallel batch
+ */
+typedef struct BatchResult
+{
+    char* output;           /**< @brief Captured regular output */
+    size_t output_len;      /**< @brief Length of @c output */
+    char* error_output;     /**< @brief Captured fatal error output */
+    size_t error_len;       /**< @brief Length of @c error_output */
+    int status;             /**< @brief Compilation exit status */
+    bool done;              /**< @brief True once the other fields are valid */
+} BatchResult;
+
+/**
+ * @brief State shared by the worker threads of a parallel batch
+ */
+typedef struct WorkQueue
+{
+    Batch* batch;           /**< @brief Files to compile */
+    const DriverOptions* options;   /**< @brief Options for every compilation */
+    BatchResult* results;   /**< @brief Per-file results (same order as the batch) */
+    int next;               /**< @brief Index of the next file to claim */
+    pthread_mutex_t lock;   /**< @brief Protects @c next and the @c done flags */
+    pthread_cond_t  ready;  /**< @brief Signaled whenever a result is done */
+} WorkQueue;
+
+/**
+ * @brief Worker thread: claim and compile files until there are none left
+ *
+ * Output is captured in memory so that the main thread can print it in batch
+ * order regardless of which files finish first.
+ */
+void* compile_worker (void* arg)
+{
+    WorkQueue* queue = (WorkQueue*)arg;
+    while (true) {
+        pthread_mutex_lock(&queue->lock);
+        int i = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+        if (i >= queue->batch->count) {
+            break;
+        }
+
+        BatchResult* result = &queue->results[i];
+        FILE* output = open_memstream(&result->output, &result->output_len);
+        FILE* error_output = open_memstream(&result->error_output, &result->error_len);
+        CHECK_MALLOC_PTR(output)
+        CHECK_MALLOC_PTR(error_output)
+        int status = compile_file(queue->batch->filenames[i], queue->options, output, error_output);
+        fclose(output);
+        fclose(error_output);
+
+        pthread_mutex_lock(&queue->lock);
+        result->status = status;
+        result->done = true;
+        pthread_cond_broadcast(&queue->ready);
+        pthread_mutex_unlock(&queue->lock);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Compile every file in a batch, each preceded by a delimiter line
+ *
+ * @param batch Files to compile
+ * @param options Options for every compilation (including the number of
+ * worker threads; 1 to compile sequentially)
+ * @returns Number of files whose compilation failed
+ */
+int compile_batch (Batch* batch, const DriverOptions* options)
+{
+    int failures = 0;
+    int num_threads = options->num_threads;
+
+    /* sequential: write directly to the standard streams */
+    if (num_threads <= 1 || batch->count <= 1) {
+        for (int i = 0; i < batch->count; i++) {
+            PRINT_BATCH_DELIMITER(batch->filenames[i]);
+            fflush(stdout);
+            if (compile_file(batch->filenames[i], options, stdout, stderr) != EXIT_SUCCESS) {
+                failures++;
+            }
+            fflush(stderr);
+            fflush(stdout);
+        }
+        return failures;
+    }
+
+    /* parallel: start workers, then print results in order as they finish */
+    if (num_threads > batch->count) {
+        num_threads = batch->count;
+    }
+    WorkQueue queue;
+    queue.batch = batch;
+    queue.options = options;
+    queue.results = (BatchResult*)calloc(batch->count, sizeof(BatchResult));
+    CHECK_MALLOC_PTR(queue.results)
+    queue.next = 0;
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.ready, NULL);
+
+    pthread_t* workers = (pthread_t*)calloc(num_threads, sizeof(pthread_t));
+    CHECK_MALLOC_PTR(workers)
+    for (int t = 0; t < num_threads; t++) {
+        if (pthread_create(&workers[t], NULL, compile_worker, &queue) != 0) {
+            fprintf(stderr, "Could not create worker thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (int i = 0; i < batch->count; i++) {
+        BatchResult* result = &queue.results[i];
+        pthread_mutex_lock(&queue.lock);
+        while (!result->done) {
+            pthread_cond_wait(&queue.ready, &queue.lock);
+        }
+        pthread_mutex_unlock(&queue.lock);
+
+        PRINT_BATCH_DELIMITER(batch->filenames[i]);
+        fwrite(result->output, 1, result->output_len, stdout);
+        fflush(stdout);
+        fwrite(result->error_output, 1, result->error_len, stderr);
+        fflush(stderr);
+        if (result->status != EXIT_SUCCESS) {
+            failures++;
+        }
+        free(result->output);
+        free(result->error_output);
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    free(workers);
+    pthread_cond_destroy(&queue.ready);
+    pthread_mutex_destroy(&queue.lock);
+    free(queue.results);
+    return failures;
+}
+
+/**
+ * @brief Parse a thread count option value
+ *
+ * @param text Option value (must consist only of decimal digits)
+ * @param count Where to store the parsed count
+ * @returns True if and only if the value is a positive number
+ */
+bool parse_thread_count (const char* text, int* count)
+{
+    if (*text == '\0' || strspn(text, "0123456789") != strlen(text)) {
+        return false;
+    }
+    *count = atoi(text);
+    return *count >= 1;
+}
+
+/**
+ * @brief Compiler entry point
+ *
+ * With a single filename, the file is compiled in the usual way. With multiple
+ * files (batch mode), each file is compiled in turn in this process and its
+ * output is preceded by a "==> filename <==" delimiter line; an argument of
+ * the form @c \@manifest names a file that lists more files to compile, one
+ * per line. The option <tt>-j N</tt> compiles up to @c N files of a batch
+ * concurrently (output is still printed in order).
+ *
+ * With <tt>--analysis-threads=N</tt>, the functions of each file are
+ * analyzed by up to @c N threads (see @ref analyze_parallel); the output is
+ * the same as with a single thread.
+ *
+ * With <tt>--incremental</tt>, the files of a batch are treated as successive
+ * versions of the same program (e.g., editor snapshots): each compilation
+ * only re-analyzes the functions that changed since the previous one (see
+ * @ref analyze_incremental). It cannot be combined with <tt>-j</tt>.
+ *
+ * With <tt>--cache-dir=DIR</tt>, the result of each compilation is stored in
+ * @c DIR, and files whose contents haven't changed since a previous run
+ * (with the same compiler) are not recompiled; their stored output is printed
+ * instead.
+ *
+ * No AST graph is generated unless it is requested:
+ *
+ * - <tt>--emit-dot=PATH</tt> writes the AST of the (single) input file to
+ *   @c PATH in DOT format; <tt>--emit-dot</tt> writes each input's AST next
+ *   to it (e.g., @c foo.decaf produces @c foo.dot)
+ * - <tt>--emit-png[=PATH]</tt> also renders the DOT output to a PNG by running
+ *   Graphviz (implies <tt>--emit-dot</tt>)
+ *
+ * Similarly, <tt>--emit-ast[=PATH]</tt> saves the analyzed AST of each input
+ * file that has no errors in a binary format (e.g., @c foo.decaf produces @c
+ * foo.ast). Giving an ".ast" file as input reloads it and prints its symbol
+ * tables without recompiling anything.
+ *
+ * With <tt>--stats</tt> (or <tt>--stats=json</tt>), the wall time, arena
+ * allocation, and AST attribute accesses of each compiler phase are reported
+ * on standard error after each compilation, along with the number of tokens,
+ * nodes, and symbols, as a table (or as one JSON object per line).
+ *
+ * With <tt>--errors=first</tt>, only the first analysis error of each file is
+ * reported; with <tt>--errors=count</tt>, only the number of errors is
+ * reported (as "N errors"). In both cases the messages that aren't reported
+ * are never formatted. The default is <tt>--errors=all</tt>.
+ *
+ * With <tt>--symbols=tsv</tt> (or <tt>--symbols=json</tt>), the symbol tables
+ * of a successful compilation are printed as one tab-separated line (or one
+ * JSON object) per symbol instead of the default indented tables (see @ref
+ * PrintSymbolsVisitor_new_with_format).
+ *
+ * @param argc Number of command-line arguments
+ * @param argv Array of command-line argument strings
+ * @returns @c EXIT_SUCCESS if all compilations succeed and @c EXIT_FAILURE
+ * otherwise
+ */
+int main(int argc, char** argv)
+{
+    /* parse options and collect files */
+    Batch batch = { NULL, 0, 0, 0 };
+    DriverOptions options = { false, NULL, false, NULL, false, NULL, 1, NULL, NULL, NO_STATS, ALL_ERRORS, 1, TEXT_SYMBOLS };
+    bool incremental = false;
+    bool use_batch_mode = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 || (strncmp(argv[i], "-j", 2) == 0 && isdigit((unsigned char)argv[i][2]))) {
+            /* either "-j N" or "-jN"; any other "-j..." argument is a filename */
+            const char* count = (argv[i][2] != '\0' ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : ""));
+            if (!parse_thread_count(count, &options.num_threads)) {
+                fprintf(stderr, "Invalid thread count: %s\n", count);
+                return EXIT_FAILURE;
+            }
+            use_batch_mode = true;
+        } else if (strncmp(argv[i], "--analysis-threads=", 19) == 0) {
+            if (!parse_thread_count(argv[i] + 19, &options.analysis_threads)) {
+                fprintf(stderr, "Invalid thread count: %s\n", argv[i] + 19);
+                return EXIT_FAILURE;
+            }
+        } else if (strncmp(argv[i], "--cache-dir=", 12) == 0) {
+            options.cache_dir = argv[i] + 12;
+        } else if (strcmp(argv[i], "--incremental") == 0) {
+            incremental = true;
+        } else if (strcmp(argv[i], "--emit-dot") == 0) {
+            options.emit_dot = true;
+        } else if (strncmp(argv[i], "--emit-dot=", 11) == 0) {
+            options.emit_dot = true;
+            options.dot_path = argv[i] + 11;
+        } else if (strcmp(argv[i], "--emit-png") == 0) {
+            options.emit_dot = options.emit_png = true;
+        } else if (strncmp(argv[i], "--emit-png=", 11) == 0) {
+            options.emit_dot = options.emit_png = true;
+            options.png_path = argv[i] + 11;
+        } else if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=text") == 0) {
+            options.stats = TEXT_STATS;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            options.stats = JSON_STATS;
+        } else if (strcmp(argv[i], "--errors=all") == 0) {
+            options.error_mode = ALL_ERRORS;
+        } else if (strcmp(argv[i], "--errors=first") == 0) {
+            options.error_mode = FIRST_ERROR_ONLY;
+        } else if (strcmp(argv[i], "--errors=count") == 0) {
+            options.error_mode = COUNT_ERRORS_ONLY;
+        } else if (strcmp(argv[i], "--symbols=text") == 0) {
+            options.symbol_format = TEXT_SYMBOLS;
+        } else if (strcmp(argv[i], "--symbols=tsv") == 0) {
+            options.symbol_format = TSV_SYMBOLS;
+        } else if (strcmp(argv[i], "--symbols=json") == 0) {
+            options.symbol_format = JSON_SYMBOLS;
+        } else if (strcmp(argv[i], "--emit-ast") == 0) {
+            options.emit_ast = true;
+        } else if (strncmp(argv[i], "--emit-ast=", 11) == 0) {
+            options.emit_ast = true;
+            options.ast_path = argv[i] + 11;
+        } else if (argv[i][0] == '@') {
+            if (!Batch_add_manifest(&batch, argv[i] + 1)) {
+                fprintf(stderr, "Could not read manifest: %s\n", argv[i] + 1);
+                batch.failures++;
+            }
+            use_batch_mode = true;
+        } else {
+            Batch_add(&batch, argv[i]);
+        }
+    }
+
+    /* check for filename */
+    if (batch.count == 0 && batch.failures == 0) {
+        fprintf(stderr, "Usage: %s [-j N] [--analysis-threads=N] [--incremental] [--cache-dir=DIR] [--emit-dot[=PATH]] [--emit-png[=PATH]] "
+                        "[--emit-ast[=PATH]] [--stats[=text|json]] [--errors=all|first|count] "
+                        "[--symbols=text|tsv|json] "
+                        "<decaf-filename> | <file-or-@manifest>...\n", argv[0]);
+        Batch_free(&batch);
+        return EXIT_FAILURE;
+    }
+
+    /* explicit output paths only make sense for a single file */
+    use_batch_mode = use_batch_mode || batch.count != 1;
+    if (use_batch_mode && (options.dot_path != NULL || options.png_path != NULL || options.ast_path != NULL)) {
+        fprintf(stderr, "Explicit --emit-dot/--emit-png/--emit-ast paths require a single input file\n");
+        Batch_free(&batch);
+        return EXIT_FAILURE;
+    }
+
+    /* successive versions must be compiled in order to reuse results */
+    if (incremental) {
+        if (options.num_threads > 1) {
+            fprintf(stderr, "--incremental cannot be combined with -j\n");
+            Batch_free(&batch);
+            return EXIT_FAILURE;
+        }
+        if (options.error_mode != ALL_ERRORS || options.analysis_threads > 1) {
+            fprintf(stderr, "--incremental cannot be combined with --errors or --analysis-threads\n");
+            Batch_free(&batch);
+            return EXIT_FAILURE;
+        }
+        options.analysis_cache = AnalysisCache_new();
+    }
+
+    int status = EXIT_SUCCESS;
+    if (!use_batch_mode) {
+
+        /* single file */
+        status = compile_file(batch.filenames[0], &options, stdout, stderr);
+
+    } else {
+
+        /* batch mode */
+        int failures = batch.failures + compile_batch(&batch, &options);
+        status = (failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    if (options.analysis_cache != NULL) {
+        AnalysisCache_free(options.analysis_cache);
+    }
+    Batch_free(&batch);
+    return status;
+}
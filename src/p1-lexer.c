@@ -0,0 +1,337 @@
+/**
+ * @file p1-lexer.c
+ * @brief Compiler phase 1: lexer
+ *
+ * Hand-written scanner for Decaf. Each token is recognized by a small
+ * deterministic automaton selected by its first character, so the input is
+ * scanned in a single linear pass with no backtracking. Keywords and reserved
+ * words are recognized after scanning an identifier by looking it up in a
+ * perfect hash table. Lexical errors are fatal and are reported using @ref
+ * Error_throw_printf.
+ *
+ * Token classes (in terms of the regular expressions they implement):
+ *
+ * <table border="1">
+ * <tr><th>Class</th><th>Pattern</th></tr>
+ * <tr><td>whitespace (skipped)</td><td><tt>[ \\t\\r]</tt> and newlines</td></tr>
+ * <tr><td>comment (skipped)</td><td><tt>//[^\\n]*</tt></td></tr>
+ * <tr><td>@c ID / @c KEY</td><td><tt>[a-zA-Z][a-zA-Z0-9_]*</tt></td></tr>
+ * <tr><td>@c HEXLIT</td><td><tt>0x(0|[1-9a-fA-F][0-9a-fA-F]*)</tt></td></tr>
+ * <tr><td>@c DECLIT</td><td><tt>0|[1-9][0-9]*</tt></td></tr>
+ * <tr><td>@c STRLIT</td><td><tt>"([^\\\\"\\r\\n]|\\\\[nt"\\\\])*"</tt></td></tr>
+ * <tr><td>@c SYM</td><td><tt><= >= && || == !=</tt> and <tt>( ) { } [ ] , . ; = + - * / % ! < ></tt></td></tr>
+ * </table>
+ */
+
+#include "p1-lexer.h"
+
+/*
+ * character classes (ASCII only, independent of the current locale)
+ */
+
+static inline bool is_letter (char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static inline bool is_digit (char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline bool is_hex_digit (char c)
+{
+    return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/*
+ * keyword recognition
+ */
+
+/**
+ * @brief Classification of an identifier-shaped token
+ */
+typedef enum WordType {
+    PLAIN_WORD, KEYWORD, RESERVED_WORD
+} WordType;
+
+/**
+ * @brief Entry in the keyword table
+ */
+typedef struct KeywordEntry {
+    const char* word;   /**< @brief Keyword text (or @c NULL for an empty slot) */
+    WordType type;      /**< @brief Keyword or reserved word */
+} KeywordEntry;
+
+/**
+ * @brief Number of slots in the keyword table (must be a power of two)
+ */
+#define KEYWORD_TABLE_SIZE 64
+
+/**
+ * @brief Hash function for the keyword table
+ *
+ * The coefficients were chosen so that every Decaf keyword and reserved word
+ * hashes to a distinct slot (i.e., this is a perfect hash for that set), so a
+ * lookup needs at most one string comparison.
+ */
+#define KEYWORD_HASH(LEN, FIRST, LAST) \
+    (((size_t)(LEN) + 5 * (size_t)(unsigned char)(FIRST) + 4 * (size_t)(unsigned char)(LAST)) \
+     & (KEYWORD_TABLE_SIZE - 1))
+
+#define KEYWORD_SLOT(WORD, FIRST, LAST, TYPE) \
+    [KEYWORD_HASH(sizeof(WORD) - 1, FIRST, LAST)] = { WORD, TYPE }
+
+static const KeywordEntry keyword_table[KEYWORD_TABLE_SIZE] = {
+    KEYWORD_SLOT("def",        'd', 'f', KEYWORD),
+    KEYWORD_SLOT("if",         'i', 'f', KEYWORD),
+    KEYWORD_SLOT("while",      'w', 'e', KEYWORD),
+    KEYWORD_SLOT("return",     'r', 'n', KEYWORD),
+    KEYWORD_SLOT("break",      'b', 'k', KEYWORD),
+    KEYWORD_SLOT("continue",   'c', 'e', KEYWORD),
+    KEYWORD_SLOT("else",       'e', 'e', KEYWORD),
+    KEYWORD_SLOT("int",        'i', 't', KEYWORD),
+    KEYWORD_SLOT("bool",       'b', 'l', KEYWORD),
+    KEYWORD_SLOT("void",       'v', 'd', KEYWORD),
+    KEYWORD_SLOT("true",       't', 'e', KEYWORD),
+    KEYWORD_SLOT("false",      'f', 'e', KEYWORD),
+    KEYWORD_SLOT("for",        'f', 'r', RESERVED_WORD),
+    KEYWORD_SLOT("callout",    'c', 't', RESERVED_WORD),
+    KEYWORD_SLOT("class",      'c', 's', RESERVED_WORD),
+    KEYWORD_SLOT("interface",  'i', 'e', RESERVED_WORD),
+    KEYWORD_SLOT("extends",    'e', 's', RESERVED_WORD),
+    KEYWORD_SLOT("implements", 'i', 's', RESERVED_WORD),
+    KEYWORD_SLOT("new",        'n', 'w', RESERVED_WORD),
+    KEYWORD_SLOT("this",       't', 's', RESERVED_WORD),
+    KEYWORD_SLOT("string",     's', 'g', RESERVED_WORD),
+    KEYWORD_SLOT("float",      'f', 't', RESERVED_WORD),
+    KEYWORD_SLOT("double",     'd', 'e', RESERVED_WORD),
+    KEYWORD_SLOT("null",       'n', 'l', RESERVED_WORD)
+};
+
+/**
+ * @brief Classify an identifier-shaped word
+ *
+ * @param word Start of word (not necessarily NUL-terminated)
+ * @param len Length of word (must be at least 1)
+ * @returns Whether the word is a keyword, a reserved word, or neither
+ */
+static WordType classify_word (const char* word, size_t len)
+{
+    const KeywordEntry* entry = &keyword_table[KEYWORD_HASH(len, word[0], word[len-1])];
+    if (entry->word != NULL && strncmp(entry->word, word, len) == 0 && entry->word[len] == '\0') {
+        return entry->type;
+    }
+    return PLAIN_WORD;
+}
+
+/*
+ * token scanners; each returns the length of the token starting at the given
+ * position (or 0 if there is no valid token of that class there)
+ */
+
+static size_t scan_identifier (const char* p)
+{
+    const char* start = p++;
+    while (is_letter(*p) || is_digit(*p) || *p == '_') {
+        p++;
+    }
+    return p - start;
+}
+
+static size_t scan_hex_literal (const char* p)
+{
+    if (p[0] != '0' || p[1] != 'x') {
+        return 0;
+    } else if (p[2] == '0') {
+        return 3;
+    } else if (!is_hex_digit(p[2])) {
+        return 0;
+    }
+    const char* start = p;
+    p += 3;
+    while (is_hex_digit(*p)) {
+        p++;
+    }
+    return p - start;
+}
+
+static size_t scan_decimal_literal (const char* p)
+{
+    if (*p == '0') {
+        return 1;
+    }
+    const char* start = p;
+    while (is_digit(*p)) {
+        p++;
+    }
+    return p - start;
+}
+
+static size_t scan_string_literal (const char* p)
+{
+    const char* start = p++;
+    while (*p != '"') {
+        if (*p == '\\') {
+            if (p[1] != 'n' && p[1] != 't' && p[1] != '"' && p[1] != '\\') {
+                return 0;
+            }
+            p += 2;
+        } else if (*p == '\n' || *p == '\r' || *p == '\0') {
+            return 0;
+        } else {
+            p++;
+        }
+    }
+    return (p + 1) - start;
+}
+
+static size_t scan_symbol (const char* p)
+{
+    switch (p[0]) {
+        case '<': case '>': case '=': case '!':
+            return (p[1] == '=' ? 2 : 1);
+        case '&': case '|':
+            return (p[1] == p[0] ? 2 : 0);
+        case '(': case ')': case '{': case '}': case '[': case ']':
+        case ',': case '.': case ';': case '+': case '-': case '*':
+        case '/': case '%':
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Length of the text reported for an invalid token
+ *
+ * The reported text extends up to (but not including) the next space or line
+ * break, limited to @c MAX_TOKEN_LEN-1 characters.
+ */
+static int invalid_token_length (const char* p)
+{
+    int len = 0;
+    while (len < MAX_TOKEN_LEN - 1 && p[len] != '\0' &&
+           p[len] != ' ' && p[len] != '\n' && p[len] != '\r') {
+        len++;
+    }
+    return len;
+}
+
+/**
+ * @brief Position of a lexer in its input
+ */
+typedef struct LexerState {
+    const char* pos;    /**< @brief Next character to scan */
+    int line;           /**< @brief Current source line */
+} LexerState;
+
+/**
+ * @brief Scan the next token and add it to a queue
+ *
+ * @param tokens Queue to add to
+ * @param state Lexer position (updated)
+ * @param free_on_error If true, deallocate the queue before reporting an error
+ * @returns True if a token was added, false if the end of input was reached
+ */
+static bool lex_next_token (TokenQueue* tokens, LexerState* state, bool free_on_error)
+{
+    const char* p = state->pos;
+    while (*p != '\0') {
+
+        /* skip whitespace, line breaks, and comments */
+        if (*p == ' ' || *p == '\t' || *p == '\r') {
+            p++;
+            continue;
+        } else if (*p == '\n') {
+            state->line++;
+            p++;
+            continue;
+        } else if (p[0] == '/' && p[1] == '/') {
+            while (*p != '\n' && *p != '\0') {
+                p++;
+            }
+            continue;
+        }
+
+        /* dispatch on the first character of the token */
+        size_t len = 0;
+        TokenType type = SYM;
+        if (is_letter(*p)) {
+            len = scan_identifier(p);
+            switch (classify_word(p, len)) {
+                case PLAIN_WORD:
+                    type = ID;
+                    break;
+                case KEYWORD:
+                    type = KEY;
+                    break;
+                case RESERVED_WORD:
+                    state->pos = p;     /* so that lexing again reports the same error */
+                    if (free_on_error) {
+                        TokenQueue_free(tokens);
+                    }
+                    Error_throw_printf("Reserved word: \"%.*s\"\n", (int)len, p);
+                    break;
+            }
+        } else if ((len = scan_hex_literal(p)) > 0) {
+            type = HEXLIT;
+        } else if (is_digit(*p)) {
+            len = scan_decimal_literal(p);
+            type = DECLIT;
+        } else if (*p == '"') {
+            len = scan_string_literal(p);
+            type = STRLIT;
+        } else {
+            len = scan_symbol(p);
+            type = SYM;
+        }
+
+        if (len == 0) {
+            state->pos = p;     /* so that lexing again reports the same error */
+            if (free_on_error) {
+                TokenQueue_free(tokens);
+            }
+            Error_throw_printf("Invalid token on line %d: \"%.*s\"\n",
+                    state->line, invalid_token_length(p), p);
+        }
+        TokenQueue_add(tokens, type, p, len, state->line);
+        state->pos = p + len;
+        return true;
+    }
+    state->pos = p;
+    return false;
+}
+
+/**
+ * @brief Refill callback for streaming token queues (see @ref lex_stream)
+ */
+static bool refill_tokens (TokenQueue* queue)
+{
+    return lex_next_token(queue, (LexerState*)queue->refill_state, false);
+}
+
+TokenQueue* lex (const char* text)
+{
+    if (text == NULL) {
+        Error_throw_printf("Abort: NULL text pointer");
+    }
+
+    TokenQueue* tokens = TokenQueue_new();
+    LexerState state = { .pos = text, .line = 1 };
+    while (lex_next_token(tokens, &state, true)) ;
+    return tokens;
+}
+
+TokenQueue* lex_stream (const char* text)
+{
+    if (text == NULL) {
+        Error_throw_printf("Abort: NULL text pointer");
+    }
+
+    LexerState* state = (LexerState*)malloc(sizeof(LexerState));
+    CHECK_MALLOC_PTR(state)
+    state->pos = text;
+    state->line = 1;
+    return TokenQueue_new_stream(refill_tokens, state);
+}
@@ -0,0 +1,595 @@
+/**
+ * @file p2-parser.c
+ * @brief Compiler phase 2: parser
+ *
+ * Recursive-descent parser for Decaf. Each nonterminal in the grammar is
+ * handled by a single @c parse_* function that consumes tokens from the front
+ * of the queue and returns a newly-allocated AST node. Syntax errors are fatal
+ * and are reported using @ref Error_throw_printf.
+ */
+
+#include "p2-parser.h"
+
+/*
+ * helper functions
+ */
+
+/**
+ * @brief Look up the source line of the next token in the queue.
+ *
+ * @param input Token queue to examine
+ * @returns Source line
+ */
+int get_next_token_line (TokenQueue* input)
+{
+    if (TokenQueue_is_empty(input)) {
+        Error_throw_printf("Unexpected end of input\n");
+    }
+    return TokenQueue_peek(input)->line;
+}
+
+/**
+ * @brief Check next token for a particular type and text and discard it
+ *
+ * Throws an error if there are no more tokens or if the next token in the
+ * queue does not match the given type or text.
+ *
+ * @param input Token queue to modify
+ * @param type Expected type of next token
+ * @param text Expected text of next token
+ */
+void match_and_discard_next_token (TokenQueue* input, TokenType type, const char* text)
+{
+    if (TokenQueue_is_empty(input)) {
+        Error_throw_printf("Unexpected end of input (expected \'%s\')\n", text);
+    }
+    Token* token = TokenQueue_remove(input);
+    if (token->type != type || !token_str_eq(token->text, text)) {
+        Error_throw_printf("Expected \'%s\' but found '%s' on line %d\n",
+                text, token->text, get_next_token_line(input));
+    }
+}
+
+/**
+ * @brief Remove next token from the queue
+ *
+ * Throws an error if there are no more tokens.
+ *
+ * @param input Token queue to modify
+ */
+void discard_next_token (TokenQueue* input)
+{
+    if (TokenQueue_is_empty(input)) {
+        Error_throw_printf("Unexpected end of input\n");
+    }
+    TokenQueue_remove(input);
+}
+
+/**
+ * @brief Look ahead at the type of the next token
+ *
+ * @param input Token queue to examine
+ * @param type Expected type of next token
+ * @returns True if the next token is of the expected type, false if not
+ */
+bool check_next_token_type (TokenQueue* input, TokenType type)
+{
+    if (TokenQueue_is_empty(input)) {
+        return false;
+    }
+    Token* token = TokenQueue_peek(input);
+    return (token->type == type);
+}
+
+/**
+ * @brief Look ahead at the type and text of the next token
+ *
+ * @param input Token queue to examine
+ * @param type Expected type of next token
+ * @param text Expected text of next token
+ * @returns True if the next token is of the expected type and text, false if not
+ */
+bool check_next_token (TokenQueue* input, TokenType type, const char* text)
+{
+    if (TokenQueue_is_empty(input)) {
+        return false;
+    }
+    Token* token = TokenQueue_peek(input);
+    return (token->type == type) && (token_str_eq(token->text, text));
+}
+
+/**
+ * @brief Remove the next token from the queue, throwing an error if there is none
+ *
+ * @param input Token queue to modify
+ * @returns Removed token (still owned by the queue)
+ */
+Token* remove_next_token (TokenQueue* input)
+{
+    if (TokenQueue_is_empty(input)) {
+        Error_throw_printf("Unexpected end of input\n");
+    }
+    return TokenQueue_remove(input);
+}
+
+/**
+ * @brief Parse and return a Decaf type
+ *
+ * @param input Token queue to modify
+ * @returns Parsed type (it is also removed from the queue)
+ */
+DecafType parse_type (TokenQueue* input)
+{
+    Token* token = remove_next_token(input);
+    if (token->type != KEY) {
+        Error_throw_printf("Invalid type '%s' on line %d\n", token->text, get_next_token_line(input));
+    }
+    DecafType t = VOID;
+    if (token_str_eq("int", token->text)) {
+        t = INT;
+    } else if (token_str_eq("bool", token->text)) {
+        t = BOOL;
+    } else if (token_str_eq("void", token->text)) {
+        t = VOID;
+    } else {
+        Error_throw_printf("Invalid type '%s' on line %d\n", token->text, get_next_token_line(input));
+    }
+    return t;
+}
+
+/**
+ * @brief Parse and return a Decaf identifier
+ *
+ * @param input Token queue to modify
+ * @param buffer String buffer for parsed identifier (should be at least
+ * @c MAX_TOKEN_LEN characters long)
+ */
+void parse_id (TokenQueue* input, char* buffer)
+{
+    Token* token = remove_next_token(input);
+    if (token->type != ID) {
+        Error_throw_printf("Invalid ID '%s' on line %d\n", token->text, get_next_token_line(input));
+    }
+    snprintf(buffer, MAX_ID_LEN, "%s", token->text);
+}
+
+/*
+ * node-level parsing functions
+ */
+
+ASTNode* parse_vardecl (TokenQueue* input);
+ASTNode* parse_funcdecl (TokenQueue* input);
+ASTNode* parse_block (TokenQueue* input);
+ASTNode* parse_statement (TokenQueue* input);
+ASTNode* parse_expression (TokenQueue* input);
+ASTNode* parse_location (TokenQueue* input, const char* name, int source_line);
+ASTNode* parse_funccall (TokenQueue* input, const char* name, int source_line);
+
+/**
+ * @brief Parse a whole program (a series of variable and function declarations)
+ *
+ * @param input Token queue to parse
+ * @returns Program AST node
+ */
+ASTNode* parse_program (TokenQueue* input)
+{
+    if (input == NULL) {
+        Error_throw_printf("Non-existent token queue");
+    }
+    ASTNode* node = ProgramNode_new();
+    while (!TokenQueue_is_empty(input)) {
+        Token* token = TokenQueue_peek(input);
+        if (token->type == KEY && token_str_eq(token->text, "def")) {
+            NodeList_add(node->program.functions, parse_funcdecl(input));
+        } else {
+            NodeList_add(node->program.variables, parse_vardecl(input));
+        }
+    }
+    return node;
+}
+
+/**
+ * @brief Parse a variable declaration (scalar or array)
+ *
+ * @param input Token queue to parse
+ * @returns Variable declaration AST node
+ */
+ASTNode* parse_vardecl (TokenQueue* input)
+{
+    int source_line = get_next_token_line(input);
+    DecafType type = parse_type(input);
+    char buffer[MAX_ID_LEN];
+    parse_id(input, buffer);
+
+    bool is_array = false;
+    int array_length = 1;
+    if (check_next_token(input, SYM, "[")) {
+        is_array = true;
+        match_and_discard_next_token(input, SYM, "[");
+        Token* token = remove_next_token(input);
+        if (token->type != DECLIT) {
+            Error_throw_printf("Invalid array size '%s' on line %d\n", token->text, token->line);
+        }
+        array_length = strtol(token->text, NULL, 10);
+        match_and_discard_next_token(input, SYM, "]");
+    }
+    match_and_discard_next_token(input, SYM, ";");
+    return VarDeclNode_new(buffer, type, is_array, array_length, source_line);
+}
+
+/**
+ * @brief Parse a function declaration (signature and body)
+ *
+ * @param input Token queue to parse
+ * @returns Function declaration AST node
+ */
+ASTNode* parse_funcdecl (TokenQueue* input)
+{
+    int source_line = get_next_token_line(input);
+    match_and_discard_next_token(input, KEY, "def");
+    DecafType return_type = parse_type(input);
+    char name[MAX_ID_LEN];
+    parse_id(input, name);
+
+    ParameterList* parameters = ParameterList_new();
+    match_and_discard_next_token(input, SYM, "(");
+    bool first = true;
+    while (!check_next_token(input, SYM, ")")) {
+        if (first) {
+            first = false;
+        } else {
+            match_and_discard_next_token(input, SYM, ",");
+        }
+        DecafType param_type = parse_type(input);
+        char param_name[MAX_ID_LEN];
+        parse_id(input, param_name);
+        ParameterList_add_new(parameters, param_name, param_type);
+    }
+    match_and_discard_next_token(input, SYM, ")");
+
+    ASTNode* body = parse_block(input);
+    return FuncDeclNode_new(name, return_type, parameters, body, source_line);
+}
+
+/**
+ * @brief Parse a block (local variable declarations followed by statements)
+ *
+ * @param input Token queue to parse
+ * @returns Block AST node
+ */
+ASTNode* parse_block (TokenQueue* input)
+{
+    ASTNode* node = BlockNode_new(get_next_token_line(input));
+    match_and_discard_next_token(input, SYM, "{");
+    while (check_next_token(input, KEY, "int") ||
+           check_next_token(input, KEY, "bool") ||
+           check_next_token(input, KEY, "void")) {
+        NodeList_add(node->block.variables, parse_vardecl(input));
+    }
+    while (!check_next_token(input, SYM, "}")) {
+        NodeList_add(node->block.statements, parse_statement(input));
+    }
+    match_and_discard_next_token(input, SYM, "}");
+    return node;
+}
+
+/**
+ * @brief Parse a single statement
+ *
+ * @param input Token queue to parse
+ * @returns Statement AST node
+ */
+ASTNode* parse_statement (TokenQueue* input)
+{
+    if (TokenQueue_is_empty(input)) {
+        Error_throw_printf("Unexpected end of input\n");
+    }
+    Token* token = TokenQueue_peek(input);
+    int source_line = token->line;
+    ASTNode* node = NULL;
+
+    switch (token->type) {
+        case ID: {
+            char name[MAX_ID_LEN];
+            parse_id(input, name);
+            if (check_next_token(input, SYM, "(")) {
+                /* function call */
+                node = parse_funccall(input, name, source_line);
+                match_and_discard_next_token(input, SYM, ";");
+            } else {
+                /* assignment */
+                ASTNode* location = parse_location(input, name, source_line);
+                match_and_discard_next_token(input, SYM, "=");
+                ASTNode* value = parse_expression(input);
+                node = AssignmentNode_new(location, value, source_line);
+                match_and_discard_next_token(input, SYM, ";");
+            }
+            break;
+        }
+
+        case KEY:
+            if (token_str_eq(token->text, "if")) {
+                discard_next_token(input);
+                ASTNode* condition = parse_expression(input);
+                ASTNode* if_block = parse_block(input);
+                ASTNode* else_block = NULL;
+                if (check_next_token(input, KEY, "else")) {
+                    discard_next_token(input);
+                    else_block = parse_block(input);
+                }
+                node = ConditionalNode_new(condition, if_block, else_block, source_line);
+            } else if (token_str_eq(token->text, "while")) {
+                discard_next_token(input);
+                ASTNode* condition = parse_expression(input);
+                ASTNode* body = parse_block(input);
+                node = WhileLoopNode_new(condition, body, source_line);
+            } else if (token_str_eq(token->text, "return")) {
+                discard_next_token(input);
+                ASTNode* value = NULL;
+                if (!check_next_token(input, SYM, ";")) {
+                    value = parse_expression(input);
+                }
+                node = ReturnNode_new(value, source_line);
+                match_and_discard_next_token(input, SYM, ";");
+            } else if (token_str_eq(token->text, "break")) {
+                node = BreakNode_new(source_line);
+                discard_next_token(input);
+                match_and_discard_next_token(input, SYM, ";");
+            } else if (token_str_eq(token->text, "continue")) {
+                node = ContinueNode_new(source_line);
+                discard_next_token(input);
+                match_and_discard_next_token(input, SYM, ";");
+            } else {
+                Error_throw_printf("Invalid statement on line %d\n", source_line);
+            }
+            break;
+
+        default:
+            Error_throw_printf("Invalid statement on line %d\n", source_line);
+            break;
+    }
+    return node;
+}
+
+/**
+ * @brief Parse a base expression (literal, location, function call, or
+ * parenthesized expression)
+ *
+ * @param input Token queue to parse
+ * @returns Expression AST node
+ */
+ASTNode* parse_base_expression (TokenQueue* input)
+{
+    if (TokenQueue_is_empty(input)) {
+        Error_throw_printf("Unexpected end of input\n");
+    }
+    Token* token = TokenQueue_peek(input);
+    int source_line = token->line;
+    ASTNode* node = NULL;
+
+    switch (token->type) {
+        case SYM:
+            if (token_str_eq(token->text, "(")) {
+                discard_next_token(input);
+                node = parse_expression(input);
+                match_and_discard_next_token(input, SYM, ")");
+            } else {
+                Error_throw_printf("Invalid base expression '%s' on line %d\n",
+                        token->text, source_line);
+            }
+            break;
+
+        case ID: {
+            char name[MAX_ID_LEN];
+            parse_id(input, name);
+            if (check_next_token(input, SYM, "(")) {
+                node = parse_funccall(input, name, source_line);
+            } else {
+                node = parse_location(input, name, source_line);
+            }
+            break;
+        }
+
+        case DECLIT:
+            node = LiteralNode_new_int(strtol(token->text, NULL, 10), source_line);
+            discard_next_token(input);
+            break;
+
+        case HEXLIT:
+            node = LiteralNode_new_int(strtol(token->text, NULL, 16), source_line);
+            discard_next_token(input);
+            break;
+
+        case KEY:
+            if (token_str_eq(token->text, "true")) {
+                node = LiteralNode_new_bool(true, source_line);
+                discard_next_token(input);
+            } else if (token_str_eq(token->text, "false")) {
+                node = LiteralNode_new_bool(false, source_line);
+                discard_next_token(input);
+            } else {
+                Error_throw_printf("Invalid base expression '%s' on line %d\n",
+                        token->text, source_line);
+            }
+            break;
+
+        case STRLIT: {
+            /* strip quotes and decode escape sequences */
+            char buffer[MAX_LINE_LEN];
+            const char* src = token->text + 1;
+            char* dst = buffer;
+            int remaining = strlen(token->text) - 2;
+            while (remaining > 0) {
+                if (src[0] == '\\' && src[1] == 'n') {
+                    *dst = '\n'; src++; remaining--;
+                } else if (src[0] == '\\' && src[1] == 't') {
+                    *dst = '\t'; src++; remaining--;
+                } else if (src[0] == '\\' && src[1] == '"') {
+                    *dst = '"';  src++; remaining--;
+                } else if (src[0] == '\\' && src[1] == '\\') {
+                    *dst = '\\'; src++; remaining--;
+                } else {
+                    *dst = *src;
+                }
+                dst++; src++; remaining--;
+            }
+            *dst = '\0';
+            node = LiteralNode_new_string(buffer, source_line);
+            discard_next_token(input);
+            break;
+        }
+    }
+    return node;
+}
+
+/**
+ * @brief Parse a unary expression (or a base expression if no operator is present)
+ *
+ * @param input Token queue to parse
+ * @returns Expression AST node
+ */
+ASTNode* parse_unary_expression (TokenQueue* input)
+{
+    int source_line = get_next_token_line(input);
+    if (check_next_token(input, SYM, "-")) {
+        discard_next_token(input);
+        return UnaryOpNode_new(NEGOP, parse_base_expression(input), source_line);
+    } else if (check_next_token(input, SYM, "!")) {
+        discard_next_token(input);
+        return UnaryOpNode_new(NOTOP, parse_base_expression(input), source_line);
+    }
+    return parse_base_expression(input);
+}
+
+/**
+ * @brief Binary operators at each precedence level (lowest precedence first)
+ */
+static const struct {
+    const char* text;
+    BinaryOpType op;
+} binary_ops[][4] = {
+    { { "||", OROP } },
+    { { "&&", ANDOP } },
+    { { "==", EQOP }, { "!=", NEQOP } },
+    { { "<",  LTOP }, { "<=", LEOP }, { ">", GTOP }, { ">=", GEOP } },
+    { { "+",  ADDOP }, { "-", SUBOP } },
+    { { "*",  MULOP }, { "/", DIVOP }, { "%", MODOP } },
+};
+
+/**
+ * @brief Number of binary operator precedence levels
+ */
+#define NUM_PRECEDENCE_LEVELS ((int)(sizeof(binary_ops) / sizeof(binary_ops[0])))
+
+/**
+ * @brief Parse a left-associative chain of binary operations at a given
+ * precedence level
+ *
+ * @param input Token queue to parse
+ * @param level Precedence level (0 is the lowest; levels beyond the last
+ * binary level parse unary expressions)
+ * @returns Expression AST node
+ */
+ASTNode* parse_binary_expression (TokenQueue* input, int level)
+{
+    int source_line = get_next_token_line(input);
+    if (level >= NUM_PRECEDENCE_LEVELS) {
+        return parse_unary_expression(input);
+    }
+    ASTNode* left = parse_binary_expression(input, level + 1);
+    bool found = true;
+    while (found) {
+        found = false;
+        for (int i = 0; i < 4 && binary_ops[level][i].text != NULL; i++) {
+            if (check_next_token(input, SYM, binary_ops[level][i].text)) {
+                discard_next_token(input);
+                ASTNode* right = parse_binary_expression(input, level + 1);
+                left = BinaryOpNode_new(binary_ops[level][i].op, left, right, source_line);
+                found = true;
+            }
+        }
+    }
+    return left;
+}
+
+/**
+ * @brief Parse an expression
+ *
+ * @param input Token queue to parse
+ * @returns Expression AST node
+ */
+ASTNode* parse_expression (TokenQueue* input)
+{
+    return parse_binary_expression(input, 0);
+}
+
+/**
+ * @brief Parse a location (the name has already been consumed)
+ *
+ * @param input Token queue to parse
+ * @param name Location name
+ * @param source_line Source line of the location name
+ * @returns Location AST node
+ */
+ASTNode* parse_location (TokenQueue* input, const char* name, int source_line)
+{
+    ASTNode* index = NULL;
+    if (check_next_token(input, SYM, "[")) {
+        discard_next_token(input);
+        index = parse_expression(input);
+        match_and_discard_next_token(input, SYM, "]");
+    }
+    return LocationNode_new(name, index, source_line);
+}
+
+/**
+ * @brief Parse a function call (the name has already been consumed)
+ *
+ * @param input Token queue to parse
+ * @param name Function name
+ * @param source_line Source line of the function name
+ * @returns Function call AST node
+ */
+ASTNode* parse_funccall (TokenQueue* input, const char* name, int source_line)
+{
+    ASTNode* node = FuncCallNode_new(name, source_line);
+    match_and_discard_next_token(input, SYM, "(");
+    bool first = true;
+    while (!check_next_token(input, SYM, ")")) {
+        if (first) {
+            first = false;
+        } else {
+            match_and_discard_next_token(input, SYM, ",");
+        }
+        NodeList_add(node->funccall.arguments, parse_expression(input));
+    }
+    match_and_discard_next_token(input, SYM, ")");
+    return node;
+}
+
+ASTNode* parse (TokenQueue* input)
+{
+    /*
+     * A streaming queue is only lexed as far as the parser has read, but a
+     * lexical error anywhere in the input takes precedence over a syntax error
+     * (as when the whole input is lexed before parsing). So before a syntax
+     * error is reported, the rest of the input is lexed, which reports the
+     * first lexical error instead if there is one.
+     */
+    jmp_buf saved_handler;
+    memcpy(saved_handler, decaf_error, sizeof(jmp_buf));
+    if (setjmp(decaf_error) == 0) {
+        ASTNode* tree = parse_program(input);
+        memcpy(decaf_error, saved_handler, sizeof(jmp_buf));
+        return tree;
+    }
+    memcpy(decaf_error, saved_handler, sizeof(jmp_buf));
+
+    char message[MAX_ERROR_LEN];
+    snprintf(message, MAX_ERROR_LEN, "%s", decaf_error_msg);
+    if (input != NULL) {
+        TokenQueue_size(input);
+    }
+    Error_throw_printf("%s", message);
+    return NULL;
+}
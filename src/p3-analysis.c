@@ -6,6 +6,8 @@
  */
 #include "p3-analysis.h"
 
+#include <pthread.h>
+
 /**
  * @brief State/data for static analysis visitor
  */
@@ -21,7 +23,7 @@ typedef struct AnalysisData
     /**
      * @brief current function that we are in
      */
-    char *current_func;
+    const char *current_func;
 
     /**
      * @brief true if we are in a while loop, false otherwise
@@ -66,7 +68,6 @@ void AnalysisData_free(AnalysisData *data)
 {
     /* free everything in data that is allocated on the heap except the error
      * list; it needs to be returned after the analysis is complete */
-    free(data->current_func);
 
     /* free "data" itself */
     free(data);
@@ -109,16 +110,16 @@ void AnalysisData_free(AnalysisData *data)
 #define PROGRAM_TABLE (((AnalysisData *)visitor->data)->program_table)
 
 /**
- * @brief Wrapper for @ref lookup_symbol that reports an error if the symbol isn't found
+ * @brief Retrieve the symbol bound to a node and report an error if the name was undefined
  * 
  * @param visitor Visitor with the error list for reporting
- * @param node AST node to begin the search at
- * @param name Name of symbol to find
- * @returns The @ref Symbol if found, otherwise @c NULL
+ * @param node AST node with a resolved "symbol" attribute
+ * @param name Name of symbol (for the error message)
+ * @returns The bound @ref Symbol if found, otherwise @c NULL
  */
-Symbol *lookup_symbol_with_reporting(NodeVisitor *visitor, ASTNode *node, const char *name)
+Symbol *get_symbol_with_reporting(NodeVisitor *visitor, ASTNode *node, const char *name)
 {
-    Symbol *symbol = lookup_symbol(node, name);
+    Symbol *symbol = ASTNode_get_symbol(node);
     if (symbol == NULL)
     {
         ErrorList_printf(ERROR_LIST, "Symbol '%s' undefined on line %d", name, node->source_line);
@@ -129,31 +130,21 @@ Symbol *lookup_symbol_with_reporting(NodeVisitor *visitor, ASTNode *node, const
 /**
  * @brief Macro for shorter storing of the inferred @c type attribute
  */
-#define SET_INFERRED_TYPE(T) ASTNode_set_printable_attribute(node, "type", (void *)(T), \
-                                                             type_attr_print, dummy_free)
+#define SET_INFERRED_TYPE(T) ASTNode_set_inferred_type(node, T)
 
 /**
  * @brief Macro for shorter retrieval of the inferred @c type attribute
  */
-#define GET_INFERRED_TYPE(N) (DecafType) ASTNode_get_attribute(N, "type")
+#define GET_INFERRED_TYPE(N) ((N)->inferred_type)
 
 /****************************** HELPER METHODS ******************************/
 /**
  * @brief use the current symbol table defined in the analysis struct to check for duplicate variables
  */
-void check_for_duplicates(NodeVisitor *visitor, ASTNode *node, char *name)
+void check_for_duplicates(NodeVisitor *visitor, ASTNode *node, const char *name)
 {
     // counts the number of times we see the symbol in the table
-    int dup = 0;
-    // for each symbol in the local symbols of the current tables, compare to the given symbol name
-    FOR_EACH(Symbol *, sym, CURR_TABLE->local_symbols)
-    {
-
-        if (strncmp(name, sym->name, MAX_ID_LEN) == 0)
-        {
-            dup += 1;
-        }
-    }
+    int dup = SymbolTable_count_local(CURR_TABLE, name);
 
     // if we saw the symbol more than once, its a duplicate symbol
     if (dup > 1)
@@ -169,8 +160,8 @@ void check_for_duplicates(NodeVisitor *visitor, ASTNode *node, char *name)
  */
 void AnalysisVisitor_pre_program(NodeVisitor *visitor, ASTNode *node)
 {
-    CURR_TABLE = ASTNode_get_attribute(node, "symbolTable");
-    PROGRAM_TABLE = ASTNode_get_attribute(node, "symbolTable");
+    CURR_TABLE = ASTNode_get_slot_attribute(node, SYMBOL_TABLE_SLOT);
+    PROGRAM_TABLE = ASTNode_get_slot_attribute(node, SYMBOL_TABLE_SLOT);
 }
 
 /**
@@ -178,7 +169,7 @@ void AnalysisVisitor_pre_program(NodeVisitor *visitor, ASTNode *node)
  */
 void AnalysisVisitor_pre_block(NodeVisitor *visitor, ASTNode *node)
 {
-    CURR_TABLE = ASTNode_get_attribute(node, "symbolTable");
+    CURR_TABLE = ASTNode_get_slot_attribute(node, SYMBOL_TABLE_SLOT);
 }
 
 /**
@@ -220,7 +211,7 @@ void AnalysisVisitor_pre_funcdecl(NodeVisitor *visitor, ASTNode *node)
     // Check for duplicate function declarations.
     check_for_duplicates(visitor, node, node->funcdecl.name);
 
-    CURR_TABLE = ASTNode_get_attribute(node, "symbolTable");
+    CURR_TABLE = ASTNode_get_slot_attribute(node, SYMBOL_TABLE_SLOT);
 }
 
 /**
@@ -228,8 +219,8 @@ void AnalysisVisitor_pre_funcdecl(NodeVisitor *visitor, ASTNode *node)
  */
 void AnalysisVisitor_pre_location(NodeVisitor *visitor, ASTNode *node)
 {
-    // look up the location and then set its type
-    Symbol *loc = lookup_symbol(node, node->location.name);
+    // get the resolved location and then set its type
+    Symbol *loc = ASTNode_get_symbol(node);
 
     // error check, and then set inferred type
     if (loc == NULL)
@@ -265,8 +256,8 @@ void AnalysisVisitor_pre_while(NodeVisitor *visitor, ASTNode *node)
  */
 void AnalysisVisitor_pre_return(NodeVisitor *visitor, ASTNode *node)
 {
-    // look up the symbol for the current function to get the expected return value
-    Symbol *func = lookup_symbol(node, CURR_FUNC);
+    // get the resolved symbol for the current function to get the expected return value
+    Symbol *func = ASTNode_get_symbol(node);
     // Set the inferred type
     if (func == NULL)
     {
@@ -341,8 +332,8 @@ void AnalysisVisitor_pre_unop(NodeVisitor *visitor, ASTNode *node)
  */
 void AnalysisVisitor_pre_funcCall(NodeVisitor *visitor, ASTNode *node)
 {
-    // look up the symbol for the function to get the expected return type
-    Symbol *func = lookup_symbol(node, node->funccall.name);
+    // get the resolved symbol for the function to get the expected return type
+    Symbol *func = ASTNode_get_symbol(node);
 
     if (func == NULL)
     {
@@ -380,32 +371,32 @@ void AnalysisVisitor_post_location(NodeVisitor *visitor, ASTNode *node)
     // makes sure that the location is valid (has been declared)
     if (node->location.index == NULL)
     { // if location is not an array
-        Symbol *sym1 = lookup_symbol(node, node->location.name);
+        Symbol *sym1 = get_symbol_with_reporting(visitor, node, node->location.name);
 
-        if (sym1 == NULL)
-        {
-            lookup_symbol_with_reporting(visitor, node, node->location.name);
-        }
-        else if (sym1->length > 1)
+        if (sym1 != NULL && sym1->length > 1)
         {
             ErrorList_printf(ERROR_LIST, "Invalid array access on line %d", node->source_line);
         }
     }
     else if (node->location.index != NULL)
     { // location is an array
-        Symbol *sym = lookup_symbol(node, node->location.name);
+        Symbol *sym = get_symbol_with_reporting(visitor, node, node->location.name);
 
         ASTNode *loc = node->location.index;
-        int index = loc->literal.integer;
 
-        // if the index is negative, print to errorlist
-        if (index < 0) // this currently never runs because index will always be >= 0
+        // only constant indices (literals or folded expressions) can be checked statically
+        int index;
+        if (sym != NULL && GET_INFERRED_TYPE(loc) == INT && ASTNode_get_constant(loc, &index))
         {
-            ErrorList_printf(ERROR_LIST, "Array size '%s[%d]' on line %d is invalid", node->location.name, index, node->source_line);
-        }
-        else if (index >= sym->length) // if the index is greater than the array length
-        {
-            ErrorList_printf(ERROR_LIST, "Array access '%s[%d]' on line %d is invalid.", node->location.name, index, node->source_line);
+            // if the index is negative, print to errorlist
+            if (index < 0)
+            {
+                ErrorList_printf(ERROR_LIST, "Array size '%s[%d]' on line %d is invalid", node->location.name, index, node->source_line);
+            }
+            else if (index >= sym->length) // if the index is greater than the array length
+            {
+                ErrorList_printf(ERROR_LIST, "Array access '%s[%d]' on line %d is invalid.", node->location.name, index, node->source_line);
+            }
         }
     }
 }
@@ -434,10 +425,7 @@ void AnalysisVisitor_check_main(NodeVisitor *visitor, ASTNode *node)
     // Check that there's no parameters in main
     if (sym != NULL)
     {
-        // look up the symbol for the function to get the expected return type
-        Symbol *main = lookup_symbol(node, "main");
-
-        if (main->parameters->head != NULL)
+        if (sym->parameters->head != NULL)
         {
             ErrorList_printf(ERROR_LIST, "Main method on line %d should not have any parameters", node->source_line);
         }
@@ -565,49 +553,113 @@ void AnalysisVisitor_post_while(NodeVisitor *visitor, ASTNode *node)
  */
 void AnalysisVisitor_post_funcCall(NodeVisitor *visitor, ASTNode *node)
 {
-    // look up the symbol for the function to get the expected return type
-    Symbol *func = lookup_symbol(node, node->funccall.name);
+    // get the resolved symbol for the function to get the expected parameter types
+    Symbol *func = get_symbol_with_reporting(visitor, node, node->funccall.name);
+    if (func == NULL)
+    {
+        return;
+    }
+
+    // variables have an (empty) parameter list too, so check the kind first
+    if (func->symbol_type != FUNCTION_SYMBOL)
+    {
+        ErrorList_printf(ERROR_LIST, "Invalid call to non-function '%s' on line %d", node->funccall.name, node->source_line);
+        return;
+    }
 
-    if (func->parameters->head->type != GET_INFERRED_TYPE(node->funccall.arguments->head))
+    // compare each argument with the parameter in the same position
+    NodeList *args = node->funccall.arguments;
+    bool valid = (NodeList_size(args) == ParameterList_size(func->parameters));
+    int i = 0;
+    FOR_EACH(Parameter *, p, func->parameters)
+    {
+        if (!valid)
+        {
+            break;
+        }
+        valid = (p->type == GET_INFERRED_TYPE(NodeList_get(args, i++)));
+    }
+    if (!valid)
     {
         ErrorList_printf(ERROR_LIST, "Invalid argument type on line %d", node->source_line);
     }
 }
 
-ErrorList *analyze(ASTNode *tree)
+// every hook of the analysis visitor as (node type, hook name, function); the
+// same list installs the function pointers and generates the specialized
+// traversal, so the two can't drift apart
+#define ANALYSIS_VISITOR_HOOKS(PRE, IN, POST)                                 \
+    PRE (PROGRAM,      program,     AnalysisVisitor_pre_program)              \
+    PRE (BLOCK,        block,       AnalysisVisitor_pre_block)                \
+    PRE (VARDECL,      vardecl,     AnalysisVisitor_pre_vardecl)              \
+    PRE (FUNCDECL,     funcdecl,    AnalysisVisitor_pre_funcdecl)             \
+    PRE (LOCATION,     location,    AnalysisVisitor_pre_location)             \
+    PRE (CONDITIONAL,  conditional, AnalysisVisitor_pre_conditional)          \
+    PRE (WHILELOOP,    whileloop,   AnalysisVisitor_pre_while)                \
+    PRE (BREAKSTMT,    break,       AnalysisVisitor_check_break)              \
+    PRE (CONTINUESTMT, continue,    AnalysisVisitor_check_continue)           \
+    PRE (BINARYOP,     binaryop,    AnalysisVisitor_pre_binop)                \
+    PRE (UNARYOP,      unaryop,     AnalysisVisitor_pre_unop)                 \
+    PRE (RETURNSTMT,   return,      AnalysisVisitor_pre_return)               \
+    PRE (FUNCCALL,     funccall,    AnalysisVisitor_pre_funcCall)             \
+    PRE (LITERAL,      literal,     AnalysisVisitor_pre_literal)              \
+    POST(PROGRAM,      program,     AnalysisVisitor_check_main)               \
+    POST(VARDECL,      vardecl,     AnalysisVisitor_post_vardecl)             \
+    POST(FUNCDECL,     funcdecl,    AnalysisVisitor_post_funcdecl)            \
+    POST(FUNCCALL,     funccall,    AnalysisVisitor_post_funcCall)            \
+    POST(ASSIGNMENT,   assignment,  AnalysisVisitor_post_assignment)          \
+    POST(CONDITIONAL,  conditional, AnalysisVisitor_post_conditional)         \
+    POST(LOCATION,     location,    AnalysisVisitor_post_location)            \
+    POST(RETURNSTMT,   return,      AnalysisVisitor_post_return)              \
+    POST(BINARYOP,     binaryop,    AnalysisVisitor_post_binop)               \
+    POST(UNARYOP,      unaryop,     AnalysisVisitor_post_unop)
+
+// defines AnalysisVisitor_set_hooks and AnalysisVisitor_traverse (a direct-call
+// version of NodeVisitor_traverse for the analysis visitor)
+DEF_STATIC_VISITOR(AnalysisVisitor, ANALYSIS_VISITOR_HOOKS)
+
+/**
+ * @brief Allocate a visitor that performs static analysis
+ *
+ * It works with @ref NodeVisitor_traverse, but the analysis itself runs it
+ * with the specialized @c AnalysisVisitor_traverse.
+ *
+ * @returns Pointer to visitor structure (with newly-allocated @ref AnalysisData)
+ */
+NodeVisitor *AnalysisVisitor_new()
 {
     /* allocate analysis structures */
     NodeVisitor *v = NodeVisitor_new();
     v->data = (void *)AnalysisData_new();
     v->dtor = (Destructor)AnalysisData_free;
 
-    /* previsit program calls */
-    v->previsit_program = &AnalysisVisitor_pre_program;
-    v->previsit_block = &AnalysisVisitor_pre_block;
-    v->previsit_vardecl = &AnalysisVisitor_pre_vardecl;
-    v->previsit_funcdecl = &AnalysisVisitor_pre_funcdecl;
-    v->previsit_location = &AnalysisVisitor_pre_location;
-    v->previsit_conditional = &AnalysisVisitor_pre_conditional;
-    v->previsit_whileloop = &AnalysisVisitor_pre_while;
-    v->previsit_break = &AnalysisVisitor_check_break;
-    v->previsit_continue = &AnalysisVisitor_check_continue;
-    v->previsit_binaryop = &AnalysisVisitor_pre_binop;
-    v->previsit_unaryop = &AnalysisVisitor_pre_unop;
-    v->previsit_return = &AnalysisVisitor_pre_return;
-    v->previsit_funccall = &AnalysisVisitor_pre_funcCall;
-    v->previsit_literal = &AnalysisVisitor_pre_literal;
-
-    /* postvisit program calls */
-    v->postvisit_program = &AnalysisVisitor_check_main;
-    v->postvisit_vardecl = &AnalysisVisitor_post_vardecl;
-    v->postvisit_funcdecl = &AnalysisVisitor_post_funcdecl;
-    v->postvisit_funccall = &AnalysisVisitor_post_funcCall;
-    v->postvisit_assignment = &AnalysisVisitor_post_assignment;
-    v->postvisit_conditional = &AnalysisVisitor_post_conditional;
-    v->postvisit_location = &AnalysisVisitor_post_location;
-    v->postvisit_return = &AnalysisVisitor_post_return;
-    v->postvisit_binaryop = &AnalysisVisitor_post_binop;
-    v->postvisit_unaryop = &AnalysisVisitor_post_unop;
+    /* previsit and postvisit program calls */
+    AnalysisVisitor_set_hooks(v);
+
+    return v;
+}
+
+/**
+ * @brief Allocate a visitor for the passes that must run before the analysis
+ * (symbol resolution and constant folding, fused into a single traversal)
+ */
+static NodeVisitor *PreAnalysisVisitor_new()
+{
+    NodeVisitor *v = CompositeVisitor_new();
+    CompositeVisitor_add(v, ResolveSymbolsVisitor_new());
+    CompositeVisitor_add(v, FoldConstantsVisitor_new());
+    return v;
+}
+
+ErrorList *analyze(ASTNode *tree)
+{
+    return analyze_with_mode(tree, ALL_ERRORS);
+}
+
+ErrorList *analyze_with_mode(ASTNode *tree, ErrorMode mode)
+{
+    NodeVisitor *v = AnalysisVisitor_new();
+    ((AnalysisData *)v->data)->errors->mode = mode;
 
     /* perform analysis, save error list, clean up, and return errors */
 
@@ -618,10 +670,579 @@ ErrorList *analyze(ASTNode *tree)
     }
     else
     {
-        NodeVisitor_traverse(v, tree);
+        // bind every name reference to its symbol and fold constant
+        // expressions once, up front
+        NodeVisitor_traverse_and_free(PreAnalysisVisitor_new(), tree);
+        AnalysisVisitor_traverse(v, tree);
     }
 
     ErrorList *errors = ((AnalysisData *)v->data)->errors;
     NodeVisitor_free(v);
     return errors;
 }
+
+/****************************** INCREMENTAL ANALYSIS ******************************/
+
+/**
+ * @brief Mix an integer into a running hash (a whole word at a time)
+ */
+static uint64_t hash_int(uint64_t hash, int64_t value)
+{
+    hash = (hash ^ (uint64_t)value) * 1099511628211ull;
+    return hash ^ (hash >> 32);
+}
+
+/**
+ * @brief Mix a string (including its terminator) into a running hash
+ */
+static uint64_t hash_str(uint64_t hash, const char *str)
+{
+    return hash_bytes(hash, str, strlen(str) + 1);
+}
+
+/**
+ * @brief Mix the signature of a program-level name into a running hash
+ *
+ * This captures everything that analysis of a function can observe about a
+ * global name: whether it is defined (and how many times), and the kind,
+ * type, length, and parameter types of the symbol that lookups find.
+ */
+static uint64_t hash_global_signature(uint64_t hash, SymbolTable *globals, const char *name)
+{
+    hash = hash_int(hash, SymbolTable_count_local(globals, name));
+    Symbol *sym = SymbolTable_lookup_local(globals, name);
+    if (sym != NULL)
+    {
+        hash = hash_int(hash, sym->symbol_type);
+        hash = hash_int(hash, sym->type);
+        hash = hash_int(hash, sym->length);
+        if (sym->parameters != NULL)
+        {
+            FOR_EACH(Parameter *, p, sym->parameters)
+            {
+                hash = hash_int(hash, p->type);
+            }
+        }
+    }
+    return hash;
+}
+
+/**
+ * @brief State for the function hashing visitor
+ */
+typedef struct FunctionHashData
+{
+    uint64_t hash;          /**< @brief Running hash */
+    SymbolTable *globals;   /**< @brief Program-level symbol table */
+} FunctionHashData;
+
+#define HASH (((FunctionHashData *)visitor->data)->hash)
+#define GLOBALS (((FunctionHashData *)visitor->data)->globals)
+
+/**
+ * @brief Mix a node's contents (and any global signatures it depends on) into the hash
+ */
+void FunctionHashVisitor_previsit(NodeVisitor *visitor, ASTNode *node)
+{
+    HASH = hash_int(HASH, node->type);
+    HASH = hash_int(HASH, node->source_line);
+    switch (node->type)
+    {
+    case VARDECL:
+        HASH = hash_str(HASH, node->vardecl.name);
+        HASH = hash_int(HASH, node->vardecl.type);
+        HASH = hash_int(HASH, node->vardecl.is_array);
+        HASH = hash_int(HASH, node->vardecl.array_length);
+        break;
+    case FUNCDECL:
+        HASH = hash_str(HASH, node->funcdecl.name);
+        HASH = hash_int(HASH, node->funcdecl.return_type);
+        FOR_EACH(Parameter *, p, node->funcdecl.parameters)
+        {
+            HASH = hash_str(HASH, p->name);
+            HASH = hash_int(HASH, p->type);
+        }
+        HASH = hash_global_signature(HASH, GLOBALS, node->funcdecl.name);
+        break;
+    case BINARYOP:
+        HASH = hash_int(HASH, node->binaryop.operator);
+        break;
+    case UNARYOP:
+        HASH = hash_int(HASH, node->unaryop.operator);
+        break;
+    case LOCATION:
+        HASH = hash_str(HASH, node->location.name);
+        HASH = hash_global_signature(HASH, GLOBALS, node->location.name);
+        break;
+    case FUNCCALL:
+        HASH = hash_str(HASH, node->funccall.name);
+        HASH = hash_global_signature(HASH, GLOBALS, node->funccall.name);
+        break;
+    case LITERAL:
+        HASH = hash_int(HASH, node->literal.type);
+        if (node->literal.type == STR)
+        {
+            HASH = hash_str(HASH, node->literal.string);
+        }
+        else if (node->literal.type == BOOL)
+        {
+            HASH = hash_int(HASH, node->literal.boolean);
+        }
+        else
+        {
+            HASH = hash_int(HASH, node->literal.integer);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Mark the end of a node's children (so that the tree shape is part of the hash)
+ */
+void FunctionHashVisitor_postvisit(NodeVisitor *visitor, ASTNode *node)
+{
+    HASH = hash_int(HASH, -1);
+}
+
+/**
+ * @brief Compute the cache key of a function declaration
+ *
+ * The key covers the entire declaration (including source lines, since they
+ * appear in error messages) and the signatures of all program-level names it
+ * refers to, so a function only needs to be re-analyzed if the key changes.
+ *
+ * @param hasher Visitor with @ref FunctionHashData (reused for every function)
+ * @param funcdecl Function declaration to hash
+ */
+static uint64_t function_key(NodeVisitor *hasher, ASTNode *funcdecl)
+{
+    FunctionHashData *data = (FunctionHashData *)hasher->data;
+    data->hash = HASH_SEED;
+    NodeVisitor_traverse(hasher, funcdecl);
+    return data->hash;
+}
+
+#undef HASH
+#undef GLOBALS
+
+AnalysisCache *AnalysisCache_new()
+{
+    AnalysisCache *cache = (AnalysisCache *)calloc(1, sizeof(AnalysisCache));
+    CHECK_MALLOC_PTR(cache);
+    return cache;
+}
+
+/**
+ * @brief Find the slot for a function name (either its entry or the empty slot where it belongs)
+ */
+static CachedFunction *AnalysisCache_find_slot(AnalysisCache *cache, const char *name)
+{
+    uint32_t mask = (uint32_t)cache->capacity - 1;
+    uint32_t i = hash_string(name) & mask;
+    while (cache->entries[i].name != NULL && strcmp(cache->entries[i].name, name) != 0)
+    {
+        i = (i + 1) & mask;
+    }
+    return &cache->entries[i];
+}
+
+/**
+ * @brief Look up the cached analysis of a function (or @c NULL if there is none)
+ */
+static CachedFunction *AnalysisCache_lookup(AnalysisCache *cache, const char *name)
+{
+    if (cache->capacity == 0)
+    {
+        return NULL;
+    }
+    CachedFunction *entry = AnalysisCache_find_slot(cache, name);
+    return (entry->name != NULL ? entry : NULL);
+}
+
+/**
+ * @brief Insert an entry into a cache (taking ownership of its name and messages)
+ *
+ * If there is already an entry with the same name, the cache is left
+ * unchanged and false is returned.
+ */
+static bool AnalysisCache_insert(AnalysisCache *cache, CachedFunction entry)
+{
+    /* grow when more than half full */
+    if ((cache->size + 1) * 2 > cache->capacity)
+    {
+        CachedFunction *old_entries = cache->entries;
+        int old_capacity = cache->capacity;
+        cache->capacity = (old_capacity == 0 ? 64 : old_capacity * 2);
+        cache->entries = (CachedFunction *)calloc(cache->capacity, sizeof(CachedFunction));
+        CHECK_MALLOC_PTR(cache->entries);
+        for (int i = 0; i < old_capacity; i++)
+        {
+            if (old_entries[i].name != NULL)
+            {
+                *AnalysisCache_find_slot(cache, old_entries[i].name) = old_entries[i];
+            }
+        }
+        free(old_entries);
+    }
+
+    CachedFunction *slot = AnalysisCache_find_slot(cache, entry.name);
+    if (slot->name != NULL)
+    {
+        return false;
+    }
+    *slot = entry;
+    cache->size++;
+    return true;
+}
+
+/**
+ * @brief Deallocate the contents of a cache entry
+ */
+static void CachedFunction_free(CachedFunction *entry)
+{
+    free(entry->name);
+    free(entry->messages);
+}
+
+void AnalysisCache_free(AnalysisCache *cache)
+{
+    for (int i = 0; i < cache->capacity; i++)
+    {
+        if (cache->entries[i].name != NULL)
+        {
+            CachedFunction_free(&cache->entries[i]);
+        }
+    }
+    free(cache->entries);
+    free(cache);
+}
+
+/**
+ * @brief Build a cache entry for a function from the errors its analysis reported
+ *
+ * @param name Function name
+ * @param key Function cache key
+ * @param errors List of errors
+ * @param first Index of the first error reported by the function's analysis
+ */
+static CachedFunction CachedFunction_new(const char *name, uint64_t key, ErrorList *errors, int first)
+{
+    CachedFunction entry = {NULL, key, 0, NULL, 0, false};
+    entry.name = (char *)malloc(strlen(name) + 1);
+    CHECK_MALLOC_PTR(entry.name);
+    strcpy(entry.name, name);
+
+    /* pack all messages (NUL-separated) into a single block */
+    char message[MAX_ERROR_LEN];
+    size_t len = 0;
+    entry.message_count = ErrorList_recorded(errors) - first;
+    for (int i = first; i < first + entry.message_count; i++)
+    {
+        len += ErrorList_format(errors, i, message, sizeof(message)) + 1;
+    }
+    if (len > 0)
+    {
+        entry.messages = (char *)malloc(len);
+        CHECK_MALLOC_PTR(entry.messages);
+        char *pos = entry.messages;
+        for (int i = first; i < first + entry.message_count; i++)
+        {
+            pos += ErrorList_format(errors, i, pos, MAX_ERROR_LEN) + 1;
+        }
+    }
+    entry.messages_length = len;
+    return entry;
+}
+
+ErrorList *analyze_incremental(ASTNode *tree, AnalysisCache *cache)
+{
+    if (tree == NULL || cache == NULL)
+    {
+        return analyze(tree);
+    }
+
+    NodeVisitor *v = AnalysisVisitor_new();
+    AnalysisData *data = (AnalysisData *)v->data;
+    AnalysisVisitor_pre_program(v, tree);
+
+    /* global variables are cheap to check, so they are always re-analyzed */
+    FOR_EACH(ASTNode *, var, tree->program.variables)
+    {
+        AnalysisVisitor_traverse(v, var);
+    }
+
+    FunctionHashData hash_data = {HASH_SEED, data->program_table};
+    NodeVisitor *hasher = NodeVisitor_new();
+    hasher->data = &hash_data;
+    hasher->previsit_default = &FunctionHashVisitor_previsit;
+    hasher->postvisit_default = &FunctionHashVisitor_postvisit;
+    NodeVisitor *resolver = PreAnalysisVisitor_new();
+
+    /* the entries of this run replace the previous ones, which are freed at
+     * the end (so entries for deleted functions don't accumulate) */
+    AnalysisCache previous = *cache;
+    cache->entries = NULL;
+    cache->capacity = 0;
+    cache->size = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+
+    FOR_EACH(ASTNode *, func, tree->program.functions)
+    {
+        // the loop state isn't reset between functions (a break is accepted
+        // anywhere after the first loop), so it is part of the key
+        const char *name = func->funcdecl.name;
+        uint64_t key = hash_int(function_key(hasher, func), data->in_while);
+        CachedFunction *old = AnalysisCache_lookup(&previous, name);
+        if (old != NULL && old->key == key && AnalysisCache_lookup(cache, name) == NULL)
+        {
+            /* unchanged: replay its errors */
+            const char *msg = old->messages;
+            for (int i = 0; i < old->message_count; i++)
+            {
+                ErrorList_add_message(data->errors, msg);
+                msg += strlen(msg) + 1;
+            }
+            data->in_while = old->in_while_after;
+            AnalysisCache_insert(cache, *old);
+            old->name = NULL; /* now owned by the new table */
+            old->messages = NULL;
+            cache->hits++;
+        }
+        else
+        {
+            /* new or changed: analyze it and remember its errors */
+            int first = ErrorList_recorded(data->errors);
+            data->curr_table = data->program_table;
+            NodeVisitor_traverse(resolver, func);
+            AnalysisVisitor_traverse(v, func);
+            CachedFunction entry = CachedFunction_new(name, key, data->errors, first);
+            entry.in_while_after = data->in_while;
+            if (!AnalysisCache_insert(cache, entry))
+            {
+                CachedFunction_free(&entry); /* duplicate name; only the first is cached */
+            }
+            cache->misses++;
+        }
+    }
+
+    /* drop the entries that weren't carried over */
+    for (int i = 0; i < previous.capacity; i++)
+    {
+        if (previous.entries[i].name != NULL)
+        {
+            CachedFunction_free(&previous.entries[i]);
+        }
+    }
+    free(previous.entries);
+    NodeVisitor_free(hasher);
+    NodeVisitor_free(resolver);
+
+    AnalysisVisitor_check_main(v, tree);
+
+    ErrorList *errors = data->errors;
+    NodeVisitor_free(v);
+    return errors;
+}
+
+/****************************** PARALLEL ANALYSIS ******************************/
+
+/**
+ * @brief Where the errors of one function were recorded by a parallel analysis
+ */
+typedef struct FunctionErrors
+{
+    int worker; /**< @brief Index of the worker that analyzed the function */
+    int first;  /**< @brief Index of the function's first error in the worker's list */
+    int end;    /**< @brief Index just past the function's last error in the worker's list */
+} FunctionErrors;
+
+/**
+ * @brief Check whether a subtree contains a while loop (stopping at the first one)
+ */
+static bool contains_while(ASTNode *node)
+{
+    TraversalStack stack;
+    TraversalStack_init(&stack);
+    bool found = false;
+    while (node != NULL && !found)
+    {
+        found = (node->type == WHILELOOP);
+        TraversalStack_push(&stack, node);
+        node = NULL;
+        while (stack.top > 0 && (node = TraversalFrame_next_child(&stack.frames[stack.top - 1])) == NULL)
+        {
+            stack.top--;
+        }
+    }
+    TraversalStack_free(&stack);
+    return found;
+}
+
+/**
+ * @brief State shared by the workers of a parallel analysis
+ */
+typedef struct ParallelAnalysis
+{
+    NodeList *functions;        /**< @brief Functions to analyze */
+    int first_loop;             /**< @brief Index of the first function with a while loop
+                                            (or the number of functions if there is none) */
+    FunctionErrors *results;    /**< @brief Error ranges (indexed like @c functions) */
+    int next;                   /**< @brief Index of the next unclaimed function */
+    pthread_mutex_t lock;       /**< @brief Protects @c next */
+} ParallelAnalysis;
+
+/**
+ * @brief State for a single worker of a parallel analysis
+ */
+typedef struct AnalysisWorker
+{
+    ParallelAnalysis *shared;   /**< @brief Shared state */
+    int index;                  /**< @brief Index of this worker */
+    NodeVisitor *analyzer;      /**< @brief Analysis visitor (with its own @ref AnalysisData) */
+    NodeVisitor *pre_analyzer;  /**< @brief Symbol resolution and folding visitor */
+    Arena *arena;               /**< @brief Arena for attributes set by this worker (@c NULL
+                                            to use the thread's current allocator) */
+} AnalysisWorker;
+
+/**
+ * @brief Worker thread: claim and analyze functions until there are none left
+ */
+static void *analysis_worker(void *arg)
+{
+    AnalysisWorker *worker = (AnalysisWorker *)arg;
+    ParallelAnalysis *shared = worker->shared;
+    AnalysisData *data = (AnalysisData *)worker->analyzer->data;
+    if (worker->arena != NULL)
+    {
+        Arena_set_current(worker->arena);
+    }
+    while (true)
+    {
+        pthread_mutex_lock(&shared->lock);
+        int i = shared->next++;
+        pthread_mutex_unlock(&shared->lock);
+        if (i >= NodeList_size(shared->functions))
+        {
+            break;
+        }
+
+        // each function is analyzed exactly as in a full analysis
+        ASTNode *func = NodeList_get(shared->functions, i);
+        FunctionErrors *result = &shared->results[i];
+        result->worker = worker->index;
+        result->first = ErrorList_size(data->errors);
+        data->curr_table = data->program_table;
+        data->in_while = (i > shared->first_loop);
+        NodeVisitor_traverse(worker->pre_analyzer, func);
+        AnalysisVisitor_traverse(worker->analyzer, func);
+        result->end = ErrorList_size(data->errors);
+    }
+    return NULL;
+}
+
+ErrorList *analyze_parallel(ASTNode *tree, int num_threads, ErrorMode mode)
+{
+    if (tree == NULL || num_threads < 2 || NodeList_size(tree->program.functions) < 2)
+    {
+        return analyze_with_mode(tree, mode);
+    }
+    ParallelAnalysis shared = {tree->program.functions, 0, NULL, 0};
+    int count = NodeList_size(shared.functions);
+
+    // a sequential analysis never resets its loop state, so a break is
+    // accepted anywhere after the first loop; each worker is given the state
+    // that function would be analyzed in
+    while (shared.first_loop < count && !contains_while(NodeList_get(shared.functions, shared.first_loop)))
+    {
+        shared.first_loop++;
+    }
+    if (num_threads > count)
+    {
+        num_threads = count;
+    }
+
+    // program-level checks happen on this thread (as in an incremental analysis)
+    NodeVisitor *v = AnalysisVisitor_new();
+    AnalysisData *data = (AnalysisData *)v->data;
+    data->errors->mode = mode;
+    AnalysisVisitor_pre_program(v, tree);
+    NodeVisitor *pre_analyzer = PreAnalysisVisitor_new();
+    FOR_EACH(ASTNode *, var, tree->program.variables)
+    {
+        NodeVisitor_traverse(pre_analyzer, var);
+        AnalysisVisitor_traverse(v, var);
+    }
+    NodeVisitor_free(pre_analyzer);
+
+    shared.results = (FunctionErrors *)calloc(count, sizeof(FunctionErrors));
+    AnalysisWorker *workers = (AnalysisWorker *)calloc(num_threads, sizeof(AnalysisWorker));
+    pthread_t *threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t));
+    CHECK_MALLOC_PTR(shared.results);
+    CHECK_MALLOC_PTR(workers);
+    CHECK_MALLOC_PTR(threads);
+    pthread_mutex_init(&shared.lock, NULL);
+
+    // the workers' visitors and error lists are created on this thread so that
+    // they come from the current arena (if any); the attribute stores that the
+    // other threads allocate come from their own arenas, which are merged into
+    // the current one once they are done
+    Arena *arena = Arena_current();
+    for (int t = 0; t < num_threads; t++)
+    {
+        workers[t].shared = &shared;
+        workers[t].index = t;
+        workers[t].analyzer = AnalysisVisitor_new();
+        workers[t].pre_analyzer = PreAnalysisVisitor_new();
+        workers[t].arena = (t > 0 && arena != NULL ? Arena_new() : NULL);
+        AnalysisData *worker_data = (AnalysisData *)workers[t].analyzer->data;
+        worker_data->program_table = data->program_table;
+        worker_data->errors->mode = (mode == COUNT_ERRORS_ONLY ? COUNT_ERRORS_ONLY : ALL_ERRORS);
+    }
+
+    // the calling thread is worker 0
+    int started = 1;
+    while (started < num_threads &&
+           pthread_create(&threads[started], NULL, analysis_worker, &workers[started]) == 0)
+    {
+        started++;
+    }
+    analysis_worker(&workers[0]);
+    for (int t = 1; t < started; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    for (int t = 1; t < num_threads; t++)
+    {
+        if (workers[t].arena != NULL)
+        {
+            Arena_adopt(arena, workers[t].arena);
+        }
+    }
+
+    // merge the errors in source order
+    for (int i = 0; i < count; i++)
+    {
+        FunctionErrors *result = &shared.results[i];
+        ErrorList *source = ((AnalysisData *)workers[result->worker].analyzer->data)->errors;
+        ErrorList_append(data->errors, source, result->first, result->end);
+    }
+    for (int t = 0; t < num_threads; t++)
+    {
+        ErrorList_free(((AnalysisData *)workers[t].analyzer->data)->errors);
+        NodeVisitor_free(workers[t].analyzer);
+        NodeVisitor_free(workers[t].pre_analyzer);
+    }
+    pthread_mutex_destroy(&shared.lock);
+    free(threads);
+    free(workers);
+    free(shared.results);
+
+    AnalysisVisitor_check_main(v, tree);
+
+    ErrorList *errors = data->errors;
+    NodeVisitor_free(v);
+    return errors;
+}
@@ -0,0 +1,831 @@
+/**
+ * @file serialize.c
+ * @brief Binary AST file format (see serialize.h for a description of the format)
+ */
+
+#include "serialize.h"
+
+/*
+ * growable arrays
+ */
+
+/**
+ * @brief Make room for one more element at the end of an array
+ *
+ * @param array Array to grow (updated if it is reallocated)
+ * @param capacity Capacity of the array in elements (updated)
+ * @param size Number of elements currently in use
+ * @param elem_size Size of each element (in bytes)
+ */
+static void reserve (void** array, size_t* capacity, size_t size, size_t elem_size)
+{
+    if (size < *capacity) {
+        return;
+    }
+    *capacity = (*capacity == 0 ? 64 : *capacity * 2);
+    *array = realloc(*array, *capacity * elem_size);
+    CHECK_MALLOC_PTR(*array)
+}
+
+#define APPEND(ARRAY, SIZE, CAPACITY) \
+    (reserve((void**)&(ARRAY), &(CAPACITY), (SIZE), sizeof(*(ARRAY))), (SIZE)++)
+
+/*
+ * pointer-to-index maps (open addressing with linear probing)
+ */
+
+/**
+ * @brief Map from symbol tables or symbols to their indices in the file
+ */
+typedef struct PointerMap
+{
+    const void** keys;      /**< @brief Key of each slot (or @c NULL if the slot is empty) */
+    uint32_t* values;       /**< @brief Value of each slot */
+    size_t capacity;        /**< @brief Number of slots (a power of two) */
+    size_t size;            /**< @brief Number of occupied slots */
+} PointerMap;
+
+static size_t PointerMap_find_slot (const PointerMap* map, const void* key)
+{
+    /* Fibonacci hashing of the address (low bits are always zero) */
+    size_t i = (size_t)(((uint64_t)(uintptr_t)key * 11400714819323198485ull) >> 32) & (map->capacity - 1);
+    while (map->keys[i] != NULL && map->keys[i] != key) {
+        i = (i + 1) & (map->capacity - 1);
+    }
+    return i;
+}
+
+static void PointerMap_put (PointerMap* map, const void* key, uint32_t value)
+{
+    /* keep the load factor at or below 1/2 */
+    if (2 * (map->size + 1) > map->capacity) {
+        PointerMap old = *map;
+        map->capacity = (old.capacity == 0 ? 64 : old.capacity * 2);
+        map->keys = (const void**)calloc(map->capacity, sizeof(const void*));
+        map->values = (uint32_t*)calloc(map->capacity, sizeof(uint32_t));
+        CHECK_MALLOC_PTR(map->keys)
+        CHECK_MALLOC_PTR(map->values)
+        for (size_t i = 0; i < old.capacity; i++) {
+            if (old.keys[i] != NULL) {
+                size_t j = PointerMap_find_slot(map, old.keys[i]);
+                map->keys[j] = old.keys[i];
+                map->values[j] = old.values[i];
+            }
+        }
+        free(old.keys);
+        free(old.values);
+    }
+    size_t i = PointerMap_find_slot(map, key);
+    if (map->keys[i] == NULL) {
+        map->keys[i] = key;
+        map->size++;
+    }
+    map->values[i] = value;
+}
+
+static bool PointerMap_get (const PointerMap* map, const void* key, uint32_t* value)
+{
+    if (map->capacity == 0) {
+        return false;
+    }
+    size_t i = PointerMap_find_slot(map, key);
+    if (map->keys[i] == NULL) {
+        return false;
+    }
+    *value = map->values[i];
+    return true;
+}
+
+static void PointerMap_free (PointerMap* map)
+{
+    free(map->keys);
+    free(map->values);
+}
+
+/*
+ * writer
+ */
+
+/**
+ * @brief State of a binary AST writer
+ *
+ * Records are accumulated in memory and written out as whole sections once
+ * the tree has been traversed.
+ */
+typedef struct ASTWriter
+{
+    ASTFileNode* nodes;
+    size_t node_count, node_capacity;
+    ASTFileParameter* params;
+    size_t param_count, param_capacity;
+    ASTFileSymbolTable* tables;
+    size_t table_count, table_capacity;
+    ASTFileSymbol* symbols;
+    size_t symbol_count, symbol_capacity;
+
+    char* strings;                  /**< @brief String section contents */
+    size_t string_size, string_capacity;
+    uint32_t* string_slots;         /**< @brief Hash index over @c strings (offset+1, or 0 if empty) */
+    size_t string_slot_count, string_slot_capacity;
+
+    PointerMap table_ids;           /**< @brief Table references (index+1) by table */
+    PointerMap symbol_ids;          /**< @brief Symbol references (index+1) by symbol */
+    bool failed;                    /**< @brief True if the tree can't be represented */
+} ASTWriter;
+
+/**
+ * @brief Add a string to the string section (if it isn't already there)
+ *
+ * @returns Offset of the string in the section
+ */
+static uint32_t ASTWriter_add_string (ASTWriter* writer, const char* string)
+{
+    /* rebuild the index at a load factor of 1/2 */
+    if (2 * (writer->string_slot_count + 1) > writer->string_slot_capacity) {
+        free(writer->string_slots);
+        writer->string_slot_capacity = (writer->string_slot_capacity == 0 ? 256
+                                        : writer->string_slot_capacity * 2);
+        writer->string_slots = (uint32_t*)calloc(writer->string_slot_capacity, sizeof(uint32_t));
+        CHECK_MALLOC_PTR(writer->string_slots)
+        size_t mask = writer->string_slot_capacity - 1;
+        for (size_t offset = 0; offset < writer->string_size;
+             offset += strlen(writer->strings + offset) + 1) {
+            size_t j = hash_string(writer->strings + offset) & mask;
+            while (writer->string_slots[j] != 0) {
+                j = (j + 1) & mask;
+            }
+            writer->string_slots[j] = (uint32_t)offset + 1;
+        }
+    }
+
+    size_t mask = writer->string_slot_capacity - 1;
+    size_t i = hash_string(string) & mask;
+    while (writer->string_slots[i] != 0) {
+        uint32_t offset = writer->string_slots[i] - 1;
+        if (strcmp(writer->strings + offset, string) == 0) {
+            return offset;
+        }
+        i = (i + 1) & mask;
+    }
+
+    size_t len = strlen(string) + 1;
+    size_t offset = writer->string_size;
+    if (offset + len > writer->string_capacity) {
+        while (offset + len > writer->string_capacity) {
+            writer->string_capacity = (writer->string_capacity == 0 ? 4096 : writer->string_capacity * 2);
+        }
+        writer->strings = (char*)realloc(writer->strings, writer->string_capacity);
+        CHECK_MALLOC_PTR(writer->strings)
+    }
+    memcpy(writer->strings + offset, string, len);
+    writer->string_size += len;
+    writer->string_slots[i] = (uint32_t)offset + 1;
+    writer->string_slot_count++;
+    return (uint32_t)offset;
+}
+
+/**
+ * @brief Add a list of parameters to the parameter section
+ *
+ * @returns Index of the first parameter
+ */
+static uint32_t ASTWriter_add_params (ASTWriter* writer, ParameterList* params)
+{
+    uint32_t first = (uint32_t)writer->param_count;
+    FOR_EACH(Parameter*, p, params) {
+        uint32_t name = ASTWriter_add_string(writer, p->name);
+        size_t i = APPEND(writer->params, writer->param_count, writer->param_capacity);
+        writer->params[i].name = name;
+        writer->params[i].type = (int32_t)p->type;
+    }
+    return first;
+}
+
+/**
+ * @brief Add a symbol table (and all of its symbols) to the file
+ *
+ * @returns Table reference
+ */
+static uint32_t ASTWriter_add_table (ASTWriter* writer, SymbolTable* table)
+{
+    uint32_t ref;
+    if (PointerMap_get(&writer->table_ids, table, &ref)) {
+        return ref;
+    }
+
+    /* parents always come first (normally they're already present) */
+    uint32_t parent = (table->parent != NULL ? ASTWriter_add_table(writer, table->parent)
+                                             : AST_FILE_NONE);
+
+    size_t index = APPEND(writer->tables, writer->table_count, writer->table_capacity);
+    writer->tables[index].parent = parent;
+    writer->tables[index].first_symbol = (uint32_t)writer->symbol_count;
+    writer->tables[index].symbol_count = (uint32_t)SymbolList_size(table->local_symbols);
+    PointerMap_put(&writer->table_ids, table, (uint32_t)index + 1);
+
+    FOR_EACH(Symbol*, sym, table->local_symbols) {
+        ASTFileSymbol record;
+        record.name = ASTWriter_add_string(writer, sym->name);
+        record.symbol_type = (uint32_t)sym->symbol_type;
+        record.type = (int32_t)sym->type;
+        record.length = (int32_t)sym->length;
+        record.first_param = ASTWriter_add_params(writer, sym->parameters);
+        record.param_count = (uint32_t)ParameterList_size(sym->parameters);
+        record.location = (int32_t)sym->location;
+        record.offset = (int32_t)sym->offset;
+        size_t i = APPEND(writer->symbols, writer->symbol_count, writer->symbol_capacity);
+        writer->symbols[i] = record;
+        PointerMap_put(&writer->symbol_ids, sym, (uint32_t)i + 1);
+    }
+    return (uint32_t)index + 1;
+}
+
+static uint32_t ASTWriter_add_node (ASTWriter* writer, ASTNode* node);
+
+/**
+ * @brief Add a list of nodes to the file, linking them with @c next references
+ *
+ * @returns Node reference to the head of the list
+ */
+static uint32_t ASTWriter_add_list (ASTWriter* writer, NodeList* list)
+{
+    uint32_t head = AST_FILE_NONE;
+    uint32_t prev = AST_FILE_NONE;
+    FOR_EACH(ASTNode*, child, list) {
+        uint32_t ref = ASTWriter_add_node(writer, child);
+        if (prev == AST_FILE_NONE) {
+            head = ref;
+        } else {
+            writer->nodes[prev - 1].next = ref;
+        }
+        prev = ref;
+    }
+    return head;
+}
+
+/**
+ * @brief Add a node and its subtree to the file (in pre-order)
+ *
+ * @returns Node reference
+ */
+static uint32_t ASTWriter_add_node (ASTWriter* writer, ASTNode* node)
+{
+    if (node == NULL) {
+        return AST_FILE_NONE;
+    }
+
+    /* reserve this node's record before adding any children */
+    size_t index = APPEND(writer->nodes, writer->node_count, writer->node_capacity);
+    ASTFileNode record;
+    memset(&record, 0, sizeof(record));
+    record.type = (uint32_t)node->type;
+    record.source_line = (int32_t)node->source_line;
+
+    /* attributes (the table first, so that it precedes the symbols in it) */
+    if (ASTNode_has_slot_attribute(node, TYPE_SLOT)) {
+        record.attributes |= AST_FILE_HAS_TYPE;
+        record.inferred_type = (int32_t)node->inferred_type;
+    }
+    if (ASTNode_has_slot_attribute(node, SYMBOL_TABLE_SLOT)) {
+        record.attributes |= AST_FILE_HAS_SYMBOL_TABLE;
+        record.symbol_table = ASTWriter_add_table(writer,
+                (SymbolTable*)ASTNode_get_slot_attribute(node, SYMBOL_TABLE_SLOT));
+    }
+    if (ASTNode_has_slot_attribute(node, SYMBOL_SLOT)) {
+        record.attributes |= AST_FILE_HAS_SYMBOL;
+        Symbol* sym = (Symbol*)ASTNode_get_slot_attribute(node, SYMBOL_SLOT);
+        if (sym != NULL && !PointerMap_get(&writer->symbol_ids, sym, &record.symbol)) {
+            writer->failed = true;      /* symbol isn't in any table in the tree */
+        }
+    }
+
+    switch (node->type) {
+        case PROGRAM:
+            record.fields[0] = ASTWriter_add_list(writer, node->program.variables);
+            record.fields[1] = ASTWriter_add_list(writer, node->program.functions);
+            break;
+        case VARDECL:
+            record.fields[0] = ASTWriter_add_string(writer, node->vardecl.name);
+            record.fields[1] = (uint32_t)node->vardecl.type;
+            record.fields[2] = (uint32_t)node->vardecl.is_array;
+            record.fields[3] = (uint32_t)node->vardecl.array_length;
+            break;
+        case FUNCDECL:
+            record.fields[0] = ASTWriter_add_string(writer, node->funcdecl.name);
+            record.fields[1] = (uint32_t)node->funcdecl.return_type;
+            record.fields[2] = ASTWriter_add_params(writer, node->funcdecl.parameters);
+            record.fields[3] = (uint32_t)ParameterList_size(node->funcdecl.parameters);
+            record.fields[4] = ASTWriter_add_node(writer, node->funcdecl.body);
+            break;
+        case BLOCK:
+            record.fields[0] = ASTWriter_add_list(writer, node->block.variables);
+            record.fields[1] = ASTWriter_add_list(writer, node->block.statements);
+            break;
+        case ASSIGNMENT:
+            record.fields[0] = ASTWriter_add_node(writer, node->assignment.location);
+            record.fields[1] = ASTWriter_add_node(writer, node->assignment.value);
+            break;
+        case CONDITIONAL:
+            record.fields[0] = ASTWriter_add_node(writer, node->conditional.condition);
+            record.fields[1] = ASTWriter_add_node(writer, node->conditional.if_block);
+            record.fields[2] = ASTWriter_add_node(writer, node->conditional.else_block);
+            break;
+        case WHILELOOP:
+            record.fields[0] = ASTWriter_add_node(writer, node->whileloop.condition);
+            record.fields[1] = ASTWriter_add_node(writer, node->whileloop.body);
+            break;
+        case RETURNSTMT:
+            record.fields[0] = ASTWriter_add_node(writer, node->funcreturn.value);
+            break;
+        case BREAKSTMT:
+        case CONTINUESTMT:
+            break;
+        case BINARYOP:
+            record.fields[0] = (uint32_t)node->binaryop.operator;
+            record.fields[1] = ASTWriter_add_node(writer, node->binaryop.left);
+            record.fields[2] = ASTWriter_add_node(writer, node->binaryop.right);
+            break;
+        case UNARYOP:
+            record.fields[0] = (uint32_t)node->unaryop.operator;
+            record.fields[1] = ASTWriter_add_node(writer, node->unaryop.child);
+            break;
+        case LOCATION:
+            record.fields[0] = ASTWriter_add_string(writer, node->location.name);
+            record.fields[1] = ASTWriter_add_node(writer, node->location.index);
+            break;
+        case FUNCCALL:
+            record.fields[0] = ASTWriter_add_string(writer, node->funccall.name);
+            record.fields[1] = ASTWriter_add_list(writer, node->funccall.arguments);
+            break;
+        case LITERAL:
+            record.fields[0] = (uint32_t)node->literal.type;
+            switch (node->literal.type) {
+                case INT:  record.fields[1] = (uint32_t)node->literal.integer;  break;
+                case BOOL: record.fields[1] = (uint32_t)node->literal.boolean;  break;
+                case STR:  record.fields[1] = ASTWriter_add_string(writer, node->literal.string); break;
+                default:   writer->failed = true;   break;
+            }
+            break;
+    }
+
+    /* the array may have moved while adding children */
+    writer->nodes[index] = record;
+    return (uint32_t)index + 1;
+}
+
+static void ASTWriter_free (ASTWriter* writer)
+{
+    free(writer->nodes);
+    free(writer->params);
+    free(writer->tables);
+    free(writer->symbols);
+    free(writer->strings);
+    free(writer->string_slots);
+    PointerMap_free(&writer->table_ids);
+    PointerMap_free(&writer->symbol_ids);
+}
+
+bool ASTNode_write_binary (ASTNode* tree, FILE* output)
+{
+    if (tree == NULL || tree->type != PROGRAM) {
+        return false;
+    }
+    ASTWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    ASTWriter_add_string(&writer, "");      /* the string section is never empty */
+    ASTWriter_add_node(&writer, tree);
+
+    /* lay out the sections (every record size is a multiple of four, so
+     * every section is aligned) */
+    ASTFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, AST_FILE_MAGIC, sizeof(header.magic));
+    header.version = AST_FILE_VERSION;
+    header.byte_order = AST_FILE_BYTE_ORDER;
+    uint64_t offset = sizeof(ASTFileHeader);
+#define LAYOUT_SECTION(NAME, COUNT, SIZE) \
+    header.NAME ## _count = (uint32_t)(COUNT); \
+    header.NAME ## _offset = (uint32_t)offset; \
+    offset += (uint64_t)(COUNT) * (SIZE);
+    LAYOUT_SECTION(node,   writer.node_count,   sizeof(ASTFileNode))
+    LAYOUT_SECTION(param,  writer.param_count,  sizeof(ASTFileParameter))
+    LAYOUT_SECTION(table,  writer.table_count,  sizeof(ASTFileSymbolTable))
+    LAYOUT_SECTION(symbol, writer.symbol_count, sizeof(ASTFileSymbol))
+#undef LAYOUT_SECTION
+    header.string_size = (uint32_t)writer.string_size;
+    header.string_offset = (uint32_t)offset;
+    offset += writer.string_size;
+
+    /* all offsets must fit in 32 bits */
+    bool success = !writer.failed && offset <= UINT32_MAX;
+    success = success && fwrite(&header, sizeof(header), 1, output) == 1;
+    success = success && fwrite(writer.nodes, sizeof(ASTFileNode), writer.node_count, output) == writer.node_count;
+    success = success && fwrite(writer.params, sizeof(ASTFileParameter), writer.param_count, output) == writer.param_count;
+    success = success && fwrite(writer.tables, sizeof(ASTFileSymbolTable), writer.table_count, output) == writer.table_count;
+    success = success && fwrite(writer.symbols, sizeof(ASTFileSymbol), writer.symbol_count, output) == writer.symbol_count;
+    success = success && fwrite(writer.strings, 1, writer.string_size, output) == writer.string_size;
+    ASTWriter_free(&writer);
+    return success;
+}
+
+/*
+ * reader
+ */
+
+/**
+ * @brief State of a binary AST reader
+ */
+typedef struct ASTReader
+{
+    const ASTFileHeader* header;
+    const ASTFileNode* nodes;
+    const ASTFileParameter* params;
+    const ASTFileSymbolTable* tables;
+    const ASTFileSymbol* symbols;
+    const char* strings;
+
+    uint8_t* node_seen;             /**< @brief Nodes reached during validation */
+    uint8_t* table_seen;            /**< @brief Symbol tables referenced during validation */
+    size_t nodes_seen;              /**< @brief Number of nodes reached */
+    size_t tables_seen;             /**< @brief Number of symbol tables referenced */
+
+    SymbolTable** built_tables;     /**< @brief Reloaded symbol tables (by index) */
+    Symbol** built_symbols;         /**< @brief Reloaded symbols (by index) */
+} ASTReader;
+
+/**
+ * @brief Node types allowed in each position
+ */
+#define NODE_TYPES(T)       (1u << (T))
+#define STATEMENT_TYPES     (NODE_TYPES(ASSIGNMENT) | NODE_TYPES(CONDITIONAL) | NODE_TYPES(WHILELOOP) | \
+                             NODE_TYPES(RETURNSTMT) | NODE_TYPES(BREAKSTMT)   | NODE_TYPES(CONTINUESTMT) | \
+                             NODE_TYPES(FUNCCALL))
+#define EXPRESSION_TYPES    (NODE_TYPES(BINARYOP) | NODE_TYPES(UNARYOP) | NODE_TYPES(LOCATION) | \
+                             NODE_TYPES(FUNCCALL) | NODE_TYPES(LITERAL))
+
+static bool valid_section (size_t length, uint32_t offset, uint32_t count, size_t size)
+{
+    return offset >= sizeof(ASTFileHeader) && offset % 4 == 0 &&
+           (uint64_t)offset + (uint64_t)count * size <= length;
+}
+
+static bool valid_type (int32_t type)
+{
+    return type >= UNKNOWN && type <= STR;
+}
+
+static bool valid_string (const ASTReader* reader, uint32_t offset)
+{
+    return offset < reader->header->string_size;
+}
+
+static bool valid_params (const ASTReader* reader, uint32_t first, uint32_t count)
+{
+    return (uint64_t)first + count <= reader->header->param_count;
+}
+
+static bool check_node (ASTReader* reader, uint32_t ref, uint32_t allowed, bool in_list);
+
+static bool check_optional_node (ASTReader* reader, uint32_t ref, uint32_t allowed)
+{
+    return ref == AST_FILE_NONE || check_node(reader, ref, allowed, false);
+}
+
+static bool check_list (ASTReader* reader, uint32_t head, uint32_t allowed)
+{
+    for (uint32_t ref = head; ref != AST_FILE_NONE; ref = reader->nodes[ref - 1].next) {
+        if (!check_node(reader, ref, allowed, true)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Validate a node and its subtree
+ *
+ * Every node may be reached only once, which rules out cycles and sharing.
+ *
+ * @param reader Reader state
+ * @param ref Node reference
+ * @param allowed Set of node types allowed in this position (see @ref NODE_TYPES)
+ * @param in_list True if the node is in a list (and so may have a @c next reference)
+ * @returns True if and only if the subtree is well-formed
+ */
+static bool check_node (ASTReader* reader, uint32_t ref, uint32_t allowed, bool in_list)
+{
+    if (ref == AST_FILE_NONE || ref > reader->header->node_count || reader->node_seen[ref - 1]) {
+        return false;
+    }
+    reader->node_seen[ref - 1] = 1;
+    reader->nodes_seen++;
+    const ASTFileNode* n = &reader->nodes[ref - 1];
+    if (n->type > LITERAL || (allowed & NODE_TYPES(n->type)) == 0 ||
+            (!in_list && n->next != AST_FILE_NONE)) {
+        return false;
+    }
+
+    /* attributes */
+    if ((n->attributes & ~(AST_FILE_HAS_TYPE | AST_FILE_HAS_SYMBOL_TABLE | AST_FILE_HAS_SYMBOL)) != 0) {
+        return false;
+    }
+    if ((n->attributes & AST_FILE_HAS_TYPE) && !valid_type(n->inferred_type)) {
+        return false;
+    }
+    if (n->attributes & AST_FILE_HAS_SYMBOL_TABLE) {
+        if (n->symbol_table == AST_FILE_NONE || n->symbol_table > reader->header->table_count ||
+                reader->table_seen[n->symbol_table - 1]) {
+            return false;
+        }
+        reader->table_seen[n->symbol_table - 1] = 1;
+        reader->tables_seen++;
+    } else if (n->symbol_table != AST_FILE_NONE) {
+        return false;
+    }
+    if (n->symbol > reader->header->symbol_count ||
+            (!(n->attributes & AST_FILE_HAS_SYMBOL) && n->symbol != AST_FILE_NONE)) {
+        return false;
+    }
+
+    /* type-specific data and children */
+    const uint32_t* f = n->fields;
+    switch (n->type) {
+        case PROGRAM:
+            return check_list(reader, f[0], NODE_TYPES(VARDECL)) &&
+                   check_list(reader, f[1], NODE_TYPES(FUNCDECL));
+        case VARDECL:
+            return valid_string(reader, f[0]) && valid_type((int32_t)f[1]) && f[2] <= 1;
+        case FUNCDECL:
+            return valid_string(reader, f[0]) && valid_type((int32_t)f[1]) &&
+                   valid_params(reader, f[2], f[3]) &&
+                   check_node(reader, f[4], NODE_TYPES(BLOCK), false);
+        case BLOCK:
+            return check_list(reader, f[0], NODE_TYPES(VARDECL)) &&
+                   check_list(reader, f[1], STATEMENT_TYPES);
+        case ASSIGNMENT:
+            return check_node(reader, f[0], NODE_TYPES(LOCATION), false) &&
+                   check_node(reader, f[1], EXPRESSION_TYPES, false);
+        case CONDITIONAL:
+            return check_node(reader, f[0], EXPRESSION_TYPES, false) &&
+                   check_node(reader, f[1], NODE_TYPES(BLOCK), false) &&
+                   check_optional_node(reader, f[2], NODE_TYPES(BLOCK));
+        case WHILELOOP:
+            return check_node(reader, f[0], EXPRESSION_TYPES, false) &&
+                   check_node(reader, f[1], NODE_TYPES(BLOCK), false);
+        case RETURNSTMT:
+            return check_optional_node(reader, f[0], EXPRESSION_TYPES);
+        case BREAKSTMT:
+        case CONTINUESTMT:
+            return true;
+        case BINARYOP:
+            return f[0] <= MODOP &&
+                   check_node(reader, f[1], EXPRESSION_TYPES, false) &&
+                   check_node(reader, f[2], EXPRESSION_TYPES, false);
+        case UNARYOP:
+            return f[0] <= NOTOP && check_node(reader, f[1], EXPRESSION_TYPES, false);
+        case LOCATION:
+            return valid_string(reader, f[0]) && check_optional_node(reader, f[1], EXPRESSION_TYPES);
+        case FUNCCALL:
+            return valid_string(reader, f[0]) && check_list(reader, f[1], EXPRESSION_TYPES);
+        case LITERAL:
+            return (f[0] == INT || f[0] == BOOL || f[0] == STR) &&
+                   (f[0] != BOOL || f[1] <= 1) &&
+                   (f[0] != STR || valid_string(reader, f[1]));
+    }
+    return false;
+}
+
+/**
+ * @brief Validate everything except the node tree
+ */
+static bool check_tables (const ASTReader* reader)
+{
+    const ASTFileHeader* h = reader->header;
+    for (uint32_t i = 0; i < h->param_count; i++) {
+        if (!valid_string(reader, reader->params[i].name) || !valid_type(reader->params[i].type)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < h->symbol_count; i++) {
+        const ASTFileSymbol* s = &reader->symbols[i];
+        if (!valid_string(reader, s->name) || s->symbol_type > FUNCTION_SYMBOL ||
+                !valid_type(s->type) || !valid_params(reader, s->first_param, s->param_count) ||
+                s->location < UNKNOWN_LOC || s->location > STACK_LOCAL) {
+            return false;
+        }
+    }
+
+    /* every symbol belongs to exactly one table, and tables are in order */
+    uint64_t next_symbol = 0;
+    for (uint32_t i = 0; i < h->table_count; i++) {
+        const ASTFileSymbolTable* t = &reader->tables[i];
+        if (t->parent > i || t->first_symbol != next_symbol) {
+            return false;
+        }
+        next_symbol += t->symbol_count;
+    }
+    return next_symbol == h->symbol_count;
+}
+
+static const char* string_at (const ASTReader* reader, uint32_t offset)
+{
+    return reader->strings + offset;
+}
+
+static void build_params (const ASTReader* reader, ParameterList* list, uint32_t first, uint32_t count)
+{
+    for (uint32_t i = first; i < first + count; i++) {
+        ParameterList_add_new(list, string_at(reader, reader->params[i].name),
+                              (DecafType)reader->params[i].type);
+    }
+}
+
+static void build_symbol_tables (ASTReader* reader)
+{
+    for (uint32_t i = 0; i < reader->header->table_count; i++) {
+        const ASTFileSymbolTable* t = &reader->tables[i];
+        SymbolTable* table = (t->parent == AST_FILE_NONE ? SymbolTable_new()
+                              : SymbolTable_new_child(reader->built_tables[t->parent - 1]));
+        for (uint32_t j = t->first_symbol; j < t->first_symbol + t->symbol_count; j++) {
+            const ASTFileSymbol* s = &reader->symbols[j];
+            Symbol* sym = Symbol_new(string_at(reader, s->name), (DecafType)s->type);
+            sym->symbol_type = s->symbol_type;
+            sym->length = s->length;
+            build_params(reader, sym->parameters, s->first_param, s->param_count);
+            sym->location = s->location;
+            sym->offset = s->offset;
+            SymbolTable_insert(table, sym);
+            reader->built_symbols[j] = sym;
+        }
+        reader->built_tables[i] = table;
+    }
+}
+
+static ASTNode* build_node (const ASTReader* reader, uint32_t ref);
+
+static void build_list (const ASTReader* reader, NodeList* list, uint32_t head)
+{
+    for (uint32_t ref = head; ref != AST_FILE_NONE; ref = reader->nodes[ref - 1].next) {
+        NodeList_add(list, build_node(reader, ref));
+    }
+}
+
+/**
+ * @brief Rebuild a (previously validated) node and its subtree
+ */
+static ASTNode* build_node (const ASTReader* reader, uint32_t ref)
+{
+    if (ref == AST_FILE_NONE) {
+        return NULL;
+    }
+    const ASTFileNode* n = &reader->nodes[ref - 1];
+    const uint32_t* f = n->fields;
+    int line = n->source_line;
+    ASTNode* node = NULL;
+    switch (n->type) {
+        case PROGRAM:
+            node = ProgramNode_new();
+            node->source_line = line;
+            build_list(reader, node->program.variables, f[0]);
+            build_list(reader, node->program.functions, f[1]);
+            break;
+        case VARDECL:
+            node = VarDeclNode_new(string_at(reader, f[0]), (DecafType)f[1], f[2] != 0, (int)f[3], line);
+            break;
+        case FUNCDECL: {
+            ParameterList* params = ParameterList_new();
+            build_params(reader, params, f[2], f[3]);
+            node = FuncDeclNode_new(string_at(reader, f[0]), (DecafType)f[1], params,
+                                    build_node(reader, f[4]), line);
+            break;
+        }
+        case BLOCK:
+            node = BlockNode_new(line);
+            build_list(reader, node->block.variables, f[0]);
+            build_list(reader, node->block.statements, f[1]);
+            break;
+        case ASSIGNMENT:
+            node = AssignmentNode_new(build_node(reader, f[0]), build_node(reader, f[1]), line);
+            break;
+        case CONDITIONAL:
+            node = ConditionalNode_new(build_node(reader, f[0]), build_node(reader, f[1]),
+                                       build_node(reader, f[2]), line);
+            break;
+        case WHILELOOP:
+            node = WhileLoopNode_new(build_node(reader, f[0]), build_node(reader, f[1]), line);
+            break;
+        case RETURNSTMT:
+            node = ReturnNode_new(build_node(reader, f[0]), line);
+            break;
+        case BREAKSTMT:
+            node = BreakNode_new(line);
+            break;
+        case CONTINUESTMT:
+            node = ContinueNode_new(line);
+            break;
+        case BINARYOP:
+            node = BinaryOpNode_new((BinaryOpType)f[0], build_node(reader, f[1]),
+                                    build_node(reader, f[2]), line);
+            break;
+        case UNARYOP:
+            node = UnaryOpNode_new((UnaryOpType)f[0], build_node(reader, f[1]), line);
+            break;
+        case LOCATION:
+            node = LocationNode_new(string_at(reader, f[0]), build_node(reader, f[1]), line);
+            break;
+        case FUNCCALL:
+            node = FuncCallNode_new(string_at(reader, f[0]), line);
+            build_list(reader, node->funccall.arguments, f[1]);
+            break;
+        case LITERAL:
+            switch (f[0]) {
+                case INT:  node = LiteralNode_new_int((int)f[1], line);  break;
+                case BOOL: node = LiteralNode_new_bool(f[1] != 0, line); break;
+                default:   node = LiteralNode_new_string(string_at(reader, f[1]), line); break;
+            }
+            break;
+    }
+
+    if (n->attributes & AST_FILE_HAS_TYPE) {
+        ASTNode_set_inferred_type(node, (DecafType)n->inferred_type);
+    }
+    if (n->attributes & AST_FILE_HAS_SYMBOL_TABLE) {
+        ASTNode_set_slot_attribute(node, SYMBOL_TABLE_SLOT, reader->built_tables[n->symbol_table - 1]);
+    }
+    if (n->attributes & AST_FILE_HAS_SYMBOL) {
+        ASTNode_set_slot_attribute(node, SYMBOL_SLOT,
+                n->symbol == AST_FILE_NONE ? NULL : reader->built_symbols[n->symbol - 1]);
+    }
+    return node;
+}
+
+ASTNode* ASTNode_decode_binary (const void* data, size_t length)
+{
+    /* header and section bounds */
+    const ASTFileHeader* h = (const ASTFileHeader*)data;
+    if (data == NULL || (uintptr_t)data % 4 != 0 || length < sizeof(ASTFileHeader) ||
+            memcmp(h->magic, AST_FILE_MAGIC, sizeof(h->magic)) != 0 ||
+            h->version != AST_FILE_VERSION || h->byte_order != AST_FILE_BYTE_ORDER ||
+            h->node_count == 0 ||
+            !valid_section(length, h->node_offset,   h->node_count,   sizeof(ASTFileNode)) ||
+            !valid_section(length, h->param_offset,  h->param_count,  sizeof(ASTFileParameter)) ||
+            !valid_section(length, h->table_offset,  h->table_count,  sizeof(ASTFileSymbolTable)) ||
+            !valid_section(length, h->symbol_offset, h->symbol_count, sizeof(ASTFileSymbol)) ||
+            (uint64_t)h->string_offset + h->string_size > length ||
+            h->string_size == 0 || ((const char*)data)[h->string_offset + h->string_size - 1] != '\0') {
+        return NULL;
+    }
+
+    const char* base = (const char*)data;
+    ASTReader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.header  = h;
+    reader.nodes   = (const ASTFileNode*)(base + h->node_offset);
+    reader.params  = (const ASTFileParameter*)(base + h->param_offset);
+    reader.tables  = (const ASTFileSymbolTable*)(base + h->table_offset);
+    reader.symbols = (const ASTFileSymbol*)(base + h->symbol_offset);
+    reader.strings = base + h->string_offset;
+
+    /* validate everything before allocating any part of the tree */
+    reader.node_seen = (uint8_t*)calloc(h->node_count, 1);
+    reader.table_seen = (uint8_t*)calloc(h->table_count + 1, 1);
+    CHECK_MALLOC_PTR(reader.node_seen)
+    CHECK_MALLOC_PTR(reader.table_seen)
+    bool valid = check_tables(&reader) &&
+                 check_node(&reader, 1, NODE_TYPES(PROGRAM), false) &&
+                 reader.nodes_seen == h->node_count &&
+                 reader.tables_seen == h->table_count;
+    free(reader.node_seen);
+    free(reader.table_seen);
+    if (!valid) {
+        return NULL;
+    }
+
+    /* rebuild the tree */
+    reader.built_tables = (SymbolTable**)calloc(h->table_count + 1, sizeof(SymbolTable*));
+    reader.built_symbols = (Symbol**)calloc(h->symbol_count + 1, sizeof(Symbol*));
+    CHECK_MALLOC_PTR(reader.built_tables)
+    CHECK_MALLOC_PTR(reader.built_symbols)
+    build_symbol_tables(&reader);
+    ASTNode* tree = build_node(&reader, 1);
+    free(reader.built_tables);
+    free(reader.built_symbols);
+
+    /* restore parent links and depths */
+    NodeVisitor* setup = CompositeVisitor_new();
+    CompositeVisitor_add(setup, SetParentVisitor_new());
+    CompositeVisitor_add(setup, CalcDepthVisitor_new());
+    NodeVisitor_traverse_and_free(setup, tree);
+    return tree;
+}
+
+ASTNode* ASTNode_read_binary (const char* filename)
+{
+    SourceText contents;
+    if (!SourceText_read(filename, &contents)) {
+        return NULL;
+    }
+    ASTNode* tree = ASTNode_decode_binary(contents.text, contents.length);
+    SourceText_free(&contents);
+    return tree;
+}
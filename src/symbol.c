@@ -25,10 +25,11 @@ void symtable_attr_print(void* value, FILE* output)
 
 Symbol* Symbol_new (const char* name, DecafType type)
 {
-    Symbol* symbol = (Symbol*)calloc(1, sizeof(Symbol));
+    Symbol* symbol = (Symbol*)decaf_calloc(1, sizeof(Symbol));
     CHECK_MALLOC_PTR(symbol)
     symbol->symbol_type = SCALAR_SYMBOL;
     snprintf(symbol->name, MAX_ID_LEN, "%s", name);
+    symbol->hash = hash_string(symbol->name);
     symbol->type = type;
     symbol->length = 1;
     symbol->parameters = ParameterList_new();
@@ -40,10 +41,11 @@ Symbol* Symbol_new (const char* name, DecafType type)
 
 Symbol* Symbol_new_array (const char* name, DecafType type, int length)
 {
-    Symbol* symbol = (Symbol*)calloc(1, sizeof(Symbol));
+    Symbol* symbol = (Symbol*)decaf_calloc(1, sizeof(Symbol));
     CHECK_MALLOC_PTR(symbol)
     symbol->symbol_type = ARRAY_SYMBOL;
     snprintf(symbol->name, MAX_ID_LEN, "%s", name);
+    symbol->hash = hash_string(symbol->name);
     symbol->type = type;
     symbol->length = length;
     symbol->parameters = ParameterList_new();
@@ -55,10 +57,11 @@ Symbol* Symbol_new_array (const char* name, DecafType type, int length)
 
 Symbol* Symbol_new_function (const char* name, DecafType return_type, ParameterList* parameters)
 {
-    Symbol* symbol = (Symbol*)calloc(1, sizeof(Symbol));
+    Symbol* symbol = (Symbol*)decaf_calloc(1, sizeof(Symbol));
     CHECK_MALLOC_PTR(symbol)
     symbol->symbol_type = FUNCTION_SYMBOL;
     snprintf(symbol->name, MAX_ID_LEN, "%s", name);
+    symbol->hash = hash_string(symbol->name);
     symbol->type = return_type;
     symbol->length = 1;
     symbol->parameters = ParameterList_new();
@@ -107,16 +110,19 @@ void Symbol_print (Symbol* symbol, FILE* output)
 void Symbol_free (Symbol* symbol)
 {
     ParameterList_free(symbol->parameters);
-    free(symbol);
+    decaf_free(symbol);
 }
 
 DEF_LIST_IMPL(Symbol, Symbol*, Symbol_free)
 
 SymbolTable* SymbolTable_new ()
 {
-    SymbolTable* table = (SymbolTable*)calloc(1, sizeof(SymbolTable));
+    SymbolTable* table = (SymbolTable*)decaf_calloc(1, sizeof(SymbolTable));
     CHECK_MALLOC_PTR(table)
     table->local_symbols = SymbolList_new();
+    table->entries = NULL;
+    table->capacity = 0;
+    table->num_names = 0;
     table->parent = NULL;
     return table;
 }
@@ -128,41 +134,116 @@ SymbolTable* SymbolTable_new_child (SymbolTable* parent)
     return table;
 }
 
+/*
+ * find the index slot for a name (either the slot holding it or the empty slot
+ * where it belongs); requires a non-empty index
+ */
+static SymbolTableEntry* SymbolTable_find_entry (SymbolTable* table, const char* name, uint32_t hash)
+{
+    uint32_t mask = (uint32_t)table->capacity - 1;
+    unsigned long probes = 0;
+    for (uint32_t i = hash & mask; ; i = (i + 1) & mask) {
+        SymbolTableEntry* entry = &table->entries[i];
+        if (entry->symbol == NULL ||
+                (entry->symbol->hash == hash &&
+                 strncmp(name, entry->symbol->name, MAX_ID_LEN) == 0)) {
+            PROFILE_RECORD("symbols", "symbols compared per table search", 0,
+                           probes + (entry->symbol != NULL));
+            return entry;
+        }
+        probes++;
+    }
+}
+
+/*
+ * double the size of the index (keeping the load factor at or below 1/2)
+ */
+static void SymbolTable_grow (SymbolTable* table)
+{
+    SymbolTableEntry* old_entries = table->entries;
+    int old_capacity = table->capacity;
+
+    table->capacity = (old_capacity == 0 ? 8 : old_capacity * 2);
+    table->entries = (SymbolTableEntry*)decaf_calloc(table->capacity, sizeof(SymbolTableEntry));
+    CHECK_MALLOC_PTR(table->entries)
+
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_entries[i].symbol != NULL) {
+            Symbol* sym = old_entries[i].symbol;
+            *SymbolTable_find_entry(table, sym->name, sym->hash) = old_entries[i];
+        }
+    }
+    decaf_free(old_entries);
+}
+
 void SymbolTable_insert (SymbolTable* table, Symbol* symbol)
 {
     SymbolList_add(table->local_symbols, symbol);
+
+    if ((table->num_names + 1) * 2 > table->capacity) {
+        SymbolTable_grow(table);
+    }
+    SymbolTableEntry* entry = SymbolTable_find_entry(table, symbol->name, symbol->hash);
+    if (entry->symbol == NULL) {
+        /* new name; later duplicates do not shadow the first declaration */
+        entry->symbol = symbol;
+        table->num_names++;
+    }
+    entry->count++;
+}
+
+Symbol* SymbolTable_lookup_local (SymbolTable* table, const char* name)
+{
+    if (table->num_names == 0) {
+        return NULL;
+    }
+    return SymbolTable_find_entry(table, name, hash_string(name))->symbol;
+}
+
+int SymbolTable_count_local (SymbolTable* table, const char* name)
+{
+    if (table->num_names == 0) {
+        return 0;
+    }
+    return SymbolTable_find_entry(table, name, hash_string(name))->count;
 }
 
 Symbol* SymbolTable_lookup (SymbolTable* table, const char* name)
 {
-    FOR_EACH(Symbol*, sym, table->local_symbols) {
-        if (strncmp(name, sym->name, MAX_ID_LEN) == 0) {
-            return sym;
+    /* hash once and reuse it for every scope in the chain */
+    uint32_t hash = hash_string(name);
+    unsigned long climbed = 0;
+    for (; table != NULL; table = table->parent, climbed++) {
+        if (table->num_names > 0) {
+            Symbol* sym = SymbolTable_find_entry(table, name, hash)->symbol;
+            if (sym != NULL) {
+                PROFILE_RECORD("symbols", "scopes climbed per lookup (found)", 0, climbed);
+                return sym;
+            }
         }
     }
-    if (table->parent != NULL) {
-        return SymbolTable_lookup(table->parent, name);
-    }
+    PROFILE_RECORD("symbols", "scopes climbed per lookup (not found)", 0, climbed);
     return NULL;
 }
 
 void SymbolTable_free (SymbolTable* table)
 {
     SymbolList_free(table->local_symbols);
-    free(table);
+    decaf_free(table->entries);
+    decaf_free(table);
 }
 
 Symbol* lookup_symbol(ASTNode* node, const char* name)
 {
     /* phase 1: traverse up the tree until we find a symbol table or reach the root */
-    while (node != NULL && !ASTNode_has_attribute(node, "symbolTable")) {
-        node = (ASTNode*)ASTNode_get_attribute(node, "parent");
+    while (node != NULL && !ASTNode_has_slot_attribute(node, SYMBOL_TABLE_SLOT)) {
+        node = node->parent;
     }
     /* phase 2: if we found a symbol table, look up the symbol in a recursive
      * search managed by @ref SymbolTable_lookup */
     Symbol* symbol = NULL;
     if (node != NULL) {
-        symbol = SymbolTable_lookup((SymbolTable*)ASTNode_get_attribute(node, "symbolTable"), name);
+        symbol = SymbolTable_lookup((SymbolTable*)ASTNode_get_slot_attribute(node, SYMBOL_TABLE_SLOT), name);
     }
     return symbol;
 }
@@ -186,7 +267,7 @@ void BuildSymbolTablesVisitor_previsit_program (NodeVisitor* visitor, ASTNode* n
     SymbolTable* table = SymbolTable_new();
 
     /* add to AST as an attribute */
-    ASTNode_set_printable_attribute(node, "symbolTable", table, symtable_attr_print, (Destructor)SymbolTable_free);
+    ASTNode_set_slot_attribute(node, SYMBOL_TABLE_SLOT, table);
 
     /* initialize stack */
     visitor->data = table;
@@ -208,7 +289,7 @@ void BuildSymbolTablesVisitor_previsit_funcdecl (NodeVisitor* visitor, ASTNode*
 {
     /* new child table w/ a parent pointer to the table on top of the stack */
     SymbolTable* table = SymbolTable_new_child((SymbolTable*)visitor->data);
-    ASTNode_set_printable_attribute(node, "symbolTable", table, symtable_attr_print, (Destructor)SymbolTable_free);
+    ASTNode_set_slot_attribute(node, SYMBOL_TABLE_SLOT, table);
     visitor->data = table;  /* push onto stack (parent pointer acts as 'next') */
 
     /* add symbols for parameters (local variables will be handled in vardecl visitor) */
@@ -223,7 +304,7 @@ void BuildSymbolTablesVisitor_previsit_block (NodeVisitor* visitor, ASTNode* nod
     SymbolTable* table = SymbolTable_new_child((SymbolTable*)visitor->data);
 
     /* add to AST as an attribute */
-    ASTNode_set_printable_attribute(node, "symbolTable", table, symtable_attr_print, (Destructor)SymbolTable_free);
+    ASTNode_set_slot_attribute(node, SYMBOL_TABLE_SLOT, table);
 
     /* push onto stack (parent pointer acts as 'next') */
     visitor->data = table;
@@ -266,66 +347,525 @@ NodeVisitor* BuildSymbolTablesVisitor_new ()
     return v;
 }
 
+/*
+ * Symbol resolution (AST visitor)
+ */
+
+/**
+ * @brief A symbol that is visible in the current scope, possibly shadowing an
+ * outer symbol with the same name
+ */
+typedef struct NameBinding
+{
+    Symbol* symbol;         /**< @brief Bound symbol */
+    int shadowed;           /**< @brief Index of the outer binding of the same name (or -1) */
+} NameBinding;
+
+/**
+ * @brief Entry in the name index of a resolver (see @ref ResolveSymbolsData)
+ */
+typedef struct NameIndexEntry
+{
+    const char* name;       /**< @brief Name (or @c NULL for an empty slot) */
+    uint32_t hash;          /**< @brief Hash of @c name */
+    int top;                /**< @brief Index of the innermost binding of the name (or -1) */
+} NameIndexEntry;
+
+/**
+ * @brief State of a symbol resolver
+ *
+ * Rather than searching the chain of enclosing symbol tables for every name
+ * (which takes time proportional to the nesting depth), the resolver keeps
+ * the innermost binding of every visible name in a hash index. Entering a
+ * scope pushes a binding for each name its table declares; leaving it pops
+ * them again, restoring any bindings they shadowed. Names declared outside the
+ * subtree being traversed (e.g., globals, when resolving a single function)
+ * are looked up in the enclosing tables instead.
+ */
+typedef struct ResolveSymbolsData
+{
+    const char* function;   /**< @brief Name of the enclosing function (or @c NULL) */
+    NameIndexEntry* index;  /**< @brief Power-of-two sized index of every name bound so far */
+    int index_capacity;     /**< @brief Number of slots in @c index */
+    int index_size;         /**< @brief Number of occupied slots in @c index */
+    NameBinding* bindings;  /**< @brief Stack of visible bindings (innermost last) */
+    int num_bindings;       /**< @brief Number of bindings on the stack */
+    int bindings_capacity;  /**< @brief Allocated length of @c bindings */
+    SymbolTable* enclosing; /**< @brief Parent of the outermost open scope's table (names that
+                                        aren't bound in the index are looked up there) */
+    int* scopes;            /**< @brief Binding stack height when each open scope was entered */
+    int num_scopes;         /**< @brief Number of open scopes */
+    int scopes_capacity;    /**< @brief Allocated length of @c scopes */
+} ResolveSymbolsData;
+
+void ResolveSymbolsData_free (ResolveSymbolsData* data)
+{
+    free(data->index);
+    free(data->bindings);
+    free(data->scopes);
+    free(data);
+}
+
+/*
+ * find the index slot for a name (either the slot holding it or the empty slot
+ * where it belongs)
+ */
+static NameIndexEntry* ResolveSymbolsData_find (ResolveSymbolsData* data, const char* name, uint32_t hash)
+{
+    uint32_t mask = (uint32_t)data->index_capacity - 1;
+    for (uint32_t i = hash & mask; ; i = (i + 1) & mask) {
+        NameIndexEntry* entry = &data->index[i];
+        if (entry->name == NULL || (entry->hash == hash && strcmp(entry->name, name) == 0)) {
+            return entry;
+        }
+    }
+}
+
+static void ResolveSymbolsData_bind (ResolveSymbolsData* data, Symbol* symbol)
+{
+    if ((data->index_size + 1) * 2 > data->index_capacity) {
+        NameIndexEntry* old_index = data->index;
+        int old_capacity = data->index_capacity;
+        data->index_capacity = (old_capacity == 0 ? 64 : old_capacity * 2);
+        data->index = (NameIndexEntry*)calloc(data->index_capacity, sizeof(NameIndexEntry));
+        CHECK_MALLOC_PTR(data->index)
+        for (int i = 0; i < old_capacity; i++) {
+            if (old_index[i].name != NULL) {
+                *ResolveSymbolsData_find(data, old_index[i].name, old_index[i].hash) = old_index[i];
+            }
+        }
+        free(old_index);
+    }
+    if (data->num_bindings == data->bindings_capacity) {
+        data->bindings_capacity = (data->bindings_capacity == 0 ? 64 : data->bindings_capacity * 2);
+        data->bindings = (NameBinding*)realloc(data->bindings,
+                data->bindings_capacity * sizeof(NameBinding));
+        CHECK_MALLOC_PTR(data->bindings)
+    }
+
+    NameIndexEntry* entry = ResolveSymbolsData_find(data, symbol->name, symbol->hash);
+    if (entry->name == NULL) {
+        entry->name = symbol->name;
+        entry->hash = symbol->hash;
+        entry->top = -1;
+        data->index_size++;
+    }
+    data->bindings[data->num_bindings].symbol = symbol;
+    data->bindings[data->num_bindings].shadowed = entry->top;
+    entry->top = data->num_bindings++;
+}
+
+/*
+ * open a scope and bind the names declared in a table (only the first
+ * declaration of each name is visible, as in SymbolTable_lookup)
+ */
+static void ResolveSymbolsData_push_table (ResolveSymbolsData* data, SymbolTable* table)
+{
+    FOR_EACH(Symbol*, sym, table->local_symbols) {
+        if (SymbolTable_lookup_local(table, sym->name) == sym) {
+            ResolveSymbolsData_bind(data, sym);
+        }
+    }
+}
+
+static void ResolveSymbolsData_open_scope (ResolveSymbolsData* data)
+{
+    if (data->num_scopes == data->scopes_capacity) {
+        data->scopes_capacity = (data->scopes_capacity == 0 ? 16 : data->scopes_capacity * 2);
+        data->scopes = (int*)realloc(data->scopes, data->scopes_capacity * sizeof(int));
+        CHECK_MALLOC_PTR(data->scopes)
+    }
+    data->scopes[data->num_scopes++] = data->num_bindings;
+}
+
+static void ResolveSymbolsData_close_scope (ResolveSymbolsData* data)
+{
+    int height = data->scopes[--data->num_scopes];
+    while (data->num_bindings > height) {
+        Symbol* sym = data->bindings[--data->num_bindings].symbol;
+        ResolveSymbolsData_find(data, sym->name, sym->hash)->top =
+            data->bindings[data->num_bindings].shadowed;
+    }
+}
+
+#define RESOLVER ((ResolveSymbolsData*)visitor->data)
+
+/*
+ * enter and leave the scope of a node with a symbol table; the first one
+ * visited also records its enclosing table (the traversal doesn't necessarily
+ * start at the root of the tree)
+ */
+
+void ResolveSymbolsVisitor_enter_scope (NodeVisitor* visitor, ASTNode* node)
+{
+    SymbolTable* table = (SymbolTable*)ASTNode_get_slot_attribute(node, SYMBOL_TABLE_SLOT);
+    if (table == NULL) {
+        return;
+    }
+    if (RESOLVER->num_scopes == 0) {
+        RESOLVER->enclosing = table->parent;
+    }
+    ResolveSymbolsData_open_scope(RESOLVER);
+    ResolveSymbolsData_push_table(RESOLVER, table);
+}
+
+void ResolveSymbolsVisitor_leave_scope (NodeVisitor* visitor, ASTNode* node)
+{
+    if (!ASTNode_has_slot_attribute(node, SYMBOL_TABLE_SLOT)) {
+        return;
+    }
+    ResolveSymbolsData_close_scope(RESOLVER);
+    if (RESOLVER->num_scopes == 0) {
+        /* back at the root of the traversal */
+        RESOLVER->enclosing = NULL;
+    }
+}
+
+/**
+ * @brief Look up a name in the current scope
+ */
+static Symbol* ResolveSymbolsVisitor_lookup (NodeVisitor* visitor, ASTNode* node, const char* name)
+{
+    if (RESOLVER->num_scopes == 0) {
+        /* not inside any scope of the traversal */
+        return lookup_symbol(node, name);
+    }
+    if (RESOLVER->index_size > 0) {
+        NameIndexEntry* entry = ResolveSymbolsData_find(RESOLVER, name, hash_string(name));
+        if (entry->name != NULL && entry->top >= 0) {
+            PROFILE_COUNT("symbols", "resolved from scope index");
+            return RESOLVER->bindings[entry->top].symbol;
+        }
+    }
+    PROFILE_COUNT("symbols", "resolved from enclosing tables");
+    /* not declared inside the traversal, so search the enclosing tables */
+    return (RESOLVER->enclosing != NULL ? SymbolTable_lookup(RESOLVER->enclosing, name) : NULL);
+}
+
+void ResolveSymbolsVisitor_previsit_program (NodeVisitor* visitor, ASTNode* node)
+{
+    ResolveSymbolsVisitor_enter_scope(visitor, node);
+}
+
+void ResolveSymbolsVisitor_postvisit_program (NodeVisitor* visitor, ASTNode* node)
+{
+    ResolveSymbolsVisitor_leave_scope(visitor, node);
+}
+
+void ResolveSymbolsVisitor_previsit_funcdecl (NodeVisitor* visitor, ASTNode* node)
+{
+    /* track the name of the enclosing function */
+    RESOLVER->function = node->funcdecl.name;
+    ResolveSymbolsVisitor_enter_scope(visitor, node);
+}
+
+void ResolveSymbolsVisitor_postvisit_funcdecl (NodeVisitor* visitor, ASTNode* node)
+{
+    RESOLVER->function = NULL;
+    ResolveSymbolsVisitor_leave_scope(visitor, node);
+}
+
+void ResolveSymbolsVisitor_previsit_block (NodeVisitor* visitor, ASTNode* node)
+{
+    ResolveSymbolsVisitor_enter_scope(visitor, node);
+}
+
+void ResolveSymbolsVisitor_postvisit_block (NodeVisitor* visitor, ASTNode* node)
+{
+    ResolveSymbolsVisitor_leave_scope(visitor, node);
+}
+
+void ResolveSymbolsVisitor_previsit_return (NodeVisitor* visitor, ASTNode* node)
+{
+    Symbol* func = NULL;
+    if (RESOLVER->function != NULL) {
+        func = ResolveSymbolsVisitor_lookup(visitor, node, RESOLVER->function);
+    }
+    ASTNode_set_slot_attribute(node, SYMBOL_SLOT, func);
+}
+
+void ResolveSymbolsVisitor_previsit_location (NodeVisitor* visitor, ASTNode* node)
+{
+    ASTNode_set_slot_attribute(node, SYMBOL_SLOT,
+            ResolveSymbolsVisitor_lookup(visitor, node, node->location.name));
+}
+
+void ResolveSymbolsVisitor_previsit_funccall (NodeVisitor* visitor, ASTNode* node)
+{
+    ASTNode_set_slot_attribute(node, SYMBOL_SLOT,
+            ResolveSymbolsVisitor_lookup(visitor, node, node->funccall.name));
+}
+
+#undef RESOLVER
+
+NodeVisitor* ResolveSymbolsVisitor_new ()
+{
+    ResolveSymbolsData* data = (ResolveSymbolsData*)calloc(1, sizeof(ResolveSymbolsData));
+    CHECK_MALLOC_PTR(data)
+    data->function = NULL;
+    data->enclosing = NULL;
+    data->index = NULL;
+    data->bindings = NULL;
+    data->scopes = NULL;
+
+    NodeVisitor* v = NodeVisitor_new();
+    v->data = data;
+    v->dtor = (Destructor)ResolveSymbolsData_free;
+    v->previsit_program   = ResolveSymbolsVisitor_previsit_program;
+    v->postvisit_program  = ResolveSymbolsVisitor_postvisit_program;
+    v->previsit_funcdecl  = ResolveSymbolsVisitor_previsit_funcdecl;
+    v->postvisit_funcdecl = ResolveSymbolsVisitor_postvisit_funcdecl;
+    v->previsit_block     = ResolveSymbolsVisitor_previsit_block;
+    v->postvisit_block    = ResolveSymbolsVisitor_postvisit_block;
+    v->previsit_return    = ResolveSymbolsVisitor_previsit_return;
+    v->previsit_location  = ResolveSymbolsVisitor_previsit_location;
+    v->previsit_funccall  = ResolveSymbolsVisitor_previsit_funccall;
+    return v;
+}
+
+Symbol* ASTNode_get_symbol (ASTNode* node)
+{
+    return (Symbol*)ASTNode_get_slot_attribute(node, SYMBOL_SLOT);
+}
+
 /*
  * SymbolTable debug output (AST visitor)
  */
 
-#define OUTFILE ((FILE*)visitor->data)
-#define PRINT_INDENT    long depth = (long)ASTNode_get_attribute(node, "depth"); \
-                        for (long i = 0; i < depth; i++) { \
-                            fprintf(OUTFILE, "  "); \
-                        }
+/**
+ * @brief State of a symbol table printer
+ */
+typedef struct PrintSymbolsData
+{
+    OutputBuffer* output;   /**< @brief Buffered output stream */
+    SymbolFormat format;    /**< @brief Output format */
+} PrintSymbolsData;
+
+/**
+ * @brief Flush and deallocate a symbol table printer
+ */
+void PrintSymbolsData_free (PrintSymbolsData* data)
+{
+    OutputBuffer_free(data->output);
+    free(data);
+}
+
+#define DATA    ((PrintSymbolsData*)visitor->data)
+#define OUTBUF  (DATA->output)
+
+/**
+ * @brief Append the indentation for a node's depth (text format)
+ */
+static void print_indent (OutputBuffer* output, ASTNode* node)
+{
+    static const char spaces[] = "                                ";
+    long depth = 2 * (long)ASTNode_get_slot_attribute(node, DEPTH_SLOT);
+    while (depth > 0) {
+        long len = (depth < (long)sizeof(spaces) - 1 ? depth : (long)sizeof(spaces) - 1);
+        OutputBuffer_write(output, spaces, (size_t)len);
+        depth -= len;
+    }
+}
 
-void PrintVisitor_visit_program (NodeVisitor* visitor, ASTNode* node);
-void PrintVisitor_visit_funcdecl (NodeVisitor* visitor, ASTNode* node);
-void PrintVisitor_visit_block (NodeVisitor* visitor, ASTNode* node);
+/**
+ * @brief Append a symbol's description in the same format as @ref Symbol_print
+ */
+static void write_symbol (OutputBuffer* output, Symbol* symbol)
+{
+    OutputBuffer_puts(output, symbol->name);
+    switch (symbol->symbol_type)
+    {
+        case SCALAR_SYMBOL:
+            OutputBuffer_puts(output, " : ");
+            OutputBuffer_puts(output, DecafType_to_string(symbol->type));
+            break;
+
+        case ARRAY_SYMBOL:
+            OutputBuffer_puts(output, " : ");
+            OutputBuffer_puts(output, DecafType_to_string(symbol->type));
+            OutputBuffer_puts(output, " [");
+            OutputBuffer_put_int(output, symbol->length);
+            OutputBuffer_puts(output, "]");
+            break;
+
+        case FUNCTION_SYMBOL:
+            OutputBuffer_puts(output, " : (");
+            bool first = true;
+            FOR_EACH (Parameter*, p, symbol->parameters) {
+                if (first) { first = false; } else { OutputBuffer_puts(output, ", "); }
+                OutputBuffer_puts(output, DecafType_to_string(p->type));
+            }
+            OutputBuffer_puts(output, ") -> ");
+            OutputBuffer_puts(output, DecafType_to_string(symbol->type));
+            break;
+    }
+    switch (symbol->location)
+    {
+        case STATIC_VAR:    OutputBuffer_printf(output, " {static offset=%d}", symbol->offset);    break;
+        case STACK_PARAM:
+        case STACK_LOCAL:   OutputBuffer_printf(output, " {stack offset=%d}", symbol->offset);     break;
+        default: break;
+    }
+}
+
+static const char* scope_kind (ASTNode* node)
+{
+    switch (node->type) {
+        case PROGRAM:   return "program";
+        case FUNCDECL:  return "function";
+        default:        return "block";
+    }
+}
+
+static const char* symbol_kind (Symbol* symbol)
+{
+    switch (symbol->symbol_type) {
+        case SCALAR_SYMBOL: return "scalar";
+        case ARRAY_SYMBOL:  return "array";
+        default:            return "function";
+    }
+}
+
+static const char* symbol_location (Symbol* symbol)
+{
+    switch (symbol->location) {
+        case STATIC_VAR:    return "static";
+        case STACK_PARAM:
+        case STACK_LOCAL:   return "stack";
+        default:            return "none";
+    }
+}
+
+/**
+ * @brief Append one line describing a symbol (TSV and JSON formats)
+ */
+static void write_symbol_record (OutputBuffer* output, SymbolFormat format, ASTNode* node, Symbol* symbol)
+{
+    /* each field is preceded by its separator (and key, in JSON) */
+    bool tsv = (format == TSV_SYMBOLS);
+    const char* quote = (tsv ? "" : "\"");
+
+    OutputBuffer_puts(output, tsv ? "" : "{\"depth\": ");
+    OutputBuffer_put_int(output, (long)ASTNode_get_slot_attribute(node, DEPTH_SLOT));
+    OutputBuffer_puts(output, tsv ? "\t" : ", \"scope\": \"");
+    OutputBuffer_puts(output, scope_kind(node));
+    OutputBuffer_puts(output, tsv ? "\t" : "\", \"line\": ");
+    OutputBuffer_put_int(output, node->source_line);
+    OutputBuffer_puts(output, tsv ? "\t" : ", \"name\": \"");
+    OutputBuffer_puts(output, symbol->name);
+    OutputBuffer_puts(output, tsv ? "\t" : "\", \"kind\": \"");
+    OutputBuffer_puts(output, symbol_kind(symbol));
+    OutputBuffer_puts(output, tsv ? "\t" : "\", \"type\": \"");
+    OutputBuffer_puts(output, DecafType_to_string(symbol->type));
+    OutputBuffer_puts(output, tsv ? "\t" : "\", \"length\": ");
+    OutputBuffer_put_int(output, symbol->length);
+    OutputBuffer_puts(output, tsv ? "\t" : ", \"parameters\": [");
+    if (tsv && ParameterList_is_empty(symbol->parameters)) {
+        OutputBuffer_puts(output, "-");
+    }
+    bool first = true;
+    FOR_EACH (Parameter*, p, symbol->parameters) {
+        OutputBuffer_puts(output, first ? "" : (tsv ? "," : ", "));
+        OutputBuffer_puts(output, quote);
+        OutputBuffer_puts(output, DecafType_to_string(p->type));
+        OutputBuffer_puts(output, quote);
+        first = false;
+    }
+    OutputBuffer_puts(output, tsv ? "\t" : "], \"location\": \"");
+    OutputBuffer_puts(output, symbol_location(symbol));
+    OutputBuffer_puts(output, tsv ? "\t" : "\", \"offset\": ");
+    OutputBuffer_put_int(output, symbol->offset);
+    OutputBuffer_puts(output, tsv ? "\n" : "}\n");
+}
 
 void print_symbol_table (NodeVisitor* visitor, ASTNode* node)
 {
+    SymbolTable* table = (SymbolTable*)ASTNode_get_slot_attribute(node, SYMBOL_TABLE_SLOT);
+    if (DATA->format != TEXT_SYMBOLS) {
+        if (table != NULL) {
+            FOR_EACH(Symbol*, sym, table->local_symbols) {
+                write_symbol_record(OUTBUF, DATA->format, node, sym);
+            }
+        }
+        return;
+    }
+
     /* print symbol table if present */
-    if (ASTNode_has_attribute(node, "symbolTable")) {
-        PRINT_INDENT
-        fprintf(OUTFILE, "SYM TABLE:\n");
-        SymbolTable* table = (SymbolTable*)ASTNode_get_attribute(node, "symbolTable");
+    if (table != NULL) {
+        print_indent(OUTBUF, node);
+        OutputBuffer_puts(OUTBUF, "SYM TABLE:\n");
         FOR_EACH(Symbol*, sym, table->local_symbols) {
-            PRINT_INDENT
-            fprintf(OUTFILE, " ");
-            Symbol_print(sym, OUTFILE);
-            fprintf(OUTFILE, "\n");
+            print_indent(OUTBUF, node);
+            OutputBuffer_puts(OUTBUF, " ");
+            write_symbol(OUTBUF, sym);
+            OutputBuffer_puts(OUTBUF, "\n");
         }
     }
-    fprintf(OUTFILE, "\n");
+    OutputBuffer_puts(OUTBUF, "\n");
 }
 
+/*
+ * the text format also prints each node that owns a table (in the same format
+ * as a PrintVisitor)
+ */
+
 void PrintSymbolsVisitor_visit_program (NodeVisitor* visitor, ASTNode* node)
 {
-    /* print regular output */
-    PrintVisitor_visit_program(visitor, node);
-
+    if (DATA->format == TEXT_SYMBOLS) {
+        OutputBuffer_printf(OUTBUF, "Program [line %d]\n", node->source_line);
+    }
     print_symbol_table(visitor, node);
 }
 
 void PrintSymbolsVisitor_visit_funcdecl (NodeVisitor* visitor, ASTNode* node)
 {
-    /* print regular output */
-    PrintVisitor_visit_funcdecl(visitor, node);
-
+    if (DATA->format == TEXT_SYMBOLS) {
+        print_indent(OUTBUF, node);
+        OutputBuffer_printf(OUTBUF, "FuncDecl name=\"%s\" return_type=%s parameters={",
+                node->funcdecl.name,
+                DecafType_to_string(node->funcdecl.return_type));
+        bool first = true;
+        FOR_EACH (Parameter*, param, node->funcdecl.parameters) {
+            OutputBuffer_printf(OUTBUF, "%s%s:%s", (first ? "" : ","), param->name,
+                    DecafType_to_string(param->type));
+            first = false;
+        }
+        OutputBuffer_printf(OUTBUF, "} [line %d]\n", node->source_line);
+    }
     print_symbol_table(visitor, node);
 }
 
 void PrintSymbolsVisitor_visit_block (NodeVisitor* visitor, ASTNode* node)
 {
-    /* print regular output */
-    PrintVisitor_visit_block(visitor, node);
-
+    if (DATA->format == TEXT_SYMBOLS) {
+        print_indent(OUTBUF, node);
+        OutputBuffer_printf(OUTBUF, "Block [line %d]\n", node->source_line);
+    }
     print_symbol_table(visitor, node);
 }
 
+#undef OUTBUF
+#undef DATA
+
 NodeVisitor* PrintSymbolsVisitor_new (FILE* output)
 {
+    return PrintSymbolsVisitor_new_with_format(output, TEXT_SYMBOLS);
+}
+
+NodeVisitor* PrintSymbolsVisitor_new_with_format (FILE* output, SymbolFormat format)
+{
+    PrintSymbolsData* data = (PrintSymbolsData*)malloc(sizeof(PrintSymbolsData));
+    CHECK_MALLOC_PTR(data)
+    data->output = OutputBuffer_new(output);
+    data->format = format;
+    if (format == TSV_SYMBOLS) {
+        OutputBuffer_puts(data->output, "#depth\tscope\tline\tname\tkind\ttype\tlength\t"
+                                        "parameters\tlocation\toffset\n");
+    }
+
     NodeVisitor* v = NodeVisitor_new();
-    /* use "data" field to store FILE* output pointer */
-    v->data = (void*)output;
+    v->data = (void*)data;
+    v->dtor = (Destructor)PrintSymbolsData_free;
     v->previsit_program  = PrintSymbolsVisitor_visit_program;
     v->previsit_funcdecl = PrintSymbolsVisitor_visit_funcdecl;
     v->previsit_block    = PrintSymbolsVisitor_visit_block;
@@ -336,15 +876,200 @@ NodeVisitor* PrintSymbolsVisitor_new (FILE* output)
  * static analysis definitions
  */
 
-DEF_LIST_IMPL(Error, AnalysisError*, free)
+/**
+ * @brief Format of errors added with @ref ErrorList_add_message (identified by
+ * address; the first argument is the offset of the message text)
+ */
+static const char preformatted_message[] = "";
+
+ErrorList* ErrorList_new ()
+{
+    return ErrorList_new_with_mode(ALL_ERRORS);
+}
+
+ErrorList* ErrorList_new_with_mode (ErrorMode mode)
+{
+    ErrorList* list = (ErrorList*)decaf_calloc(1, sizeof(ErrorList));
+    CHECK_MALLOC_PTR(list)
+    list->mode = mode;
+    return list;
+}
+
+/**
+ * @brief Count an error and return the record to fill in (or @c NULL if the
+ * list's mode says it shouldn't be recorded)
+ */
+static AnalysisError* ErrorList_next_record (ErrorList* list)
+{
+    list->size++;
+    if (list->mode == COUNT_ERRORS_ONLY || (list->mode == FIRST_ERROR_ONLY && list->size > 1)) {
+        return NULL;
+    }
+    if (list->size > list->capacity) {
+        list->capacity = (list->capacity == 0 ? 16 : list->capacity * 2);
+        list->errors = (AnalysisError*)realloc(list->errors, list->capacity * sizeof(AnalysisError));
+        CHECK_MALLOC_PTR(list->errors)
+    }
+    return &list->errors[list->size - 1];
+}
 
 void ErrorList_printf (ErrorList* list, const char* format, ...)
 {
-    AnalysisError* err = (AnalysisError*)calloc(1, sizeof(AnalysisError));
-    CHECK_MALLOC_PTR(err)
+    AnalysisError* err = ErrorList_next_record(list);
+    if (err == NULL) {
+        return;
+    }
+    err->format = format;
     va_list args;
     va_start(args, format);
-    vsnprintf(err->message, MAX_ERROR_LEN, format, args);
+    int n = 0;
+    for (const char* p = format; *p != '\0' && n < MAX_ERROR_ARGS; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        p++;
+        if (*p == 'd') {
+            err->args[n++].integer = va_arg(args, int);
+        } else if (*p == 's') {
+            err->args[n++].string = va_arg(args, const char*);
+        } else if (*p == '\0') {
+            break;
+        }
+    }
     va_end(args);
-    ErrorList_add(list, err);
+}
+
+/**
+ * @brief Copy a message into the text storage of a list and return its offset
+ */
+static int ErrorList_store_text (ErrorList* list, const char* message)
+{
+    size_t len = strlen(message) + 1;
+    if (list->text_size + len > list->text_capacity) {
+        list->text_capacity = (list->text_capacity == 0 ? 1024 : list->text_capacity * 2);
+        if (list->text_capacity < list->text_size + len) {
+            list->text_capacity = list->text_size + len;
+        }
+        list->text = (char*)realloc(list->text, list->text_capacity);
+        CHECK_MALLOC_PTR(list->text)
+    }
+    memcpy(list->text + list->text_size, message, len);
+    int offset = (int)list->text_size;
+    list->text_size += len;
+    return offset;
+}
+
+void ErrorList_add_message (ErrorList* list, const char* message)
+{
+    AnalysisError* err = ErrorList_next_record(list);
+    if (err == NULL) {
+        return;
+    }
+    err->format = preformatted_message;
+    err->args[0].integer = ErrorList_store_text(list, message);
+}
+
+void ErrorList_append (ErrorList* list, ErrorList* source, int first, int end)
+{
+    for (int i = first; i < end; i++) {
+        AnalysisError* err = ErrorList_next_record(list);
+        if (err == NULL) {
+            continue;
+        } else if (source->errors[i].format == preformatted_message) {
+            err->format = preformatted_message;
+            err->args[0].integer = ErrorList_store_text(list, source->text + source->errors[i].args[0].integer);
+        } else {
+            *err = source->errors[i];
+        }
+    }
+}
+
+int ErrorList_size (ErrorList* list)
+{
+    return list->size;
+}
+
+bool ErrorList_is_empty (ErrorList* list)
+{
+    return (list->size == 0);
+}
+
+int ErrorList_recorded (ErrorList* list)
+{
+    switch (list->mode) {
+        case COUNT_ERRORS_ONLY: return 0;
+        case FIRST_ERROR_ONLY:  return (list->size > 0 ? 1 : 0);
+        default:                return list->size;
+    }
+}
+
+/**
+ * @brief Append a string to a bounded buffer (see @ref ErrorList_format)
+ */
+static size_t append_text (char* buffer, size_t size, size_t len, const char* text, size_t n)
+{
+    if (len + n >= size) {
+        n = (len + 1 < size ? size - 1 - len : 0);
+    }
+    memcpy(buffer + len, text, n);
+    return len + n;
+}
+
+size_t ErrorList_format (ErrorList* list, int index, char* buffer, size_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    AnalysisError* err = &list->errors[index];
+    const char* format = err->format;
+    if (format == preformatted_message) {
+        const char* text = list->text + err->args[0].integer;
+        size_t len = append_text(buffer, size, 0, text, strlen(text));
+        buffer[len] = '\0';
+        return len;
+    }
+
+    /* expand the conversions recorded by ErrorList_printf */
+    size_t len = 0;
+    int n = 0;
+    for (const char* p = format; *p != '\0'; p++) {
+        if (p[0] != '%' || p[1] == '\0') {
+            len = append_text(buffer, size, len, p, 1);
+            continue;
+        }
+        p++;
+        if (*p == 'd' && n < MAX_ERROR_ARGS) {
+            char digits[16];
+            int d = snprintf(digits, sizeof(digits), "%d", err->args[n++].integer);
+            len = append_text(buffer, size, len, digits, (size_t)d);
+        } else if (*p == 's' && n < MAX_ERROR_ARGS) {
+            const char* text = err->args[n++].string;
+            len = append_text(buffer, size, len, text, strlen(text));
+        } else {
+            len = append_text(buffer, size, len, p, 1);
+        }
+    }
+    buffer[len] = '\0';
+    return len;
+}
+
+void ErrorList_print (ErrorList* list, FILE* output)
+{
+    /* collect all messages and write them at once */
+    OutputBuffer* buffer = OutputBuffer_new(output);
+    char message[MAX_ERROR_LEN];
+    int count = ErrorList_recorded(list);
+    for (int i = 0; i < count; i++) {
+        size_t len = ErrorList_format(list, i, message, sizeof(message));
+        OutputBuffer_write(buffer, message, (len < sizeof(message) ? len : sizeof(message) - 1));
+        OutputBuffer_write(buffer, "\n", 1);
+    }
+    OutputBuffer_free(buffer);
+}
+
+void ErrorList_free (ErrorList* list)
+{
+    free(list->errors);
+    free(list->text);
+    decaf_free(list);
 }
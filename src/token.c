@@ -46,21 +46,15 @@ bool token_str_eq (const char* str1, const char* str2)
     return strncmp(str1, str2, MAX_TOKEN_LEN) == 0;
 }
 
-Token* Token_new (TokenType type, const char* text, int line)
-{
-    Token* token = (Token*)calloc(1, sizeof(Token));
-    CHECK_MALLOC_PTR(token)
-    token->type = type;
-    snprintf(token->text, MAX_TOKEN_LEN, "%s", text);
-    token->line = line;
-    token->next = NULL;
-    return token;
-}
+/**
+ * @brief Initial capacity of a materialized token queue's buffer
+ */
+#define INITIAL_TOKEN_CAPACITY 256
 
-void Token_free (Token* token)
-{
-    free(token);
-}
+/**
+ * @brief Look up the buffer slot for a given token index
+ */
+#define TOKEN_SLOT(QUEUE,INDEX) (&(QUEUE)->tokens[(INDEX) & ((QUEUE)->capacity - 1)])
 
 TokenQueue* TokenQueue_new ()
 {
@@ -69,57 +63,117 @@ TokenQueue* TokenQueue_new ()
     return queue;
 }
 
-void TokenQueue_add (TokenQueue* queue, Token* token)
+TokenQueue* TokenQueue_new_stream (TokenRefillFunc refill, void* state)
+{
+    TokenQueue* queue = TokenQueue_new();
+    queue->refill = refill;
+    queue->refill_state = state;
+    return queue;
+}
+
+/*
+ * make room for one more token, either by recycling the slot of the oldest
+ * removed token (streaming queues only) or by doubling the buffer
+ */
+static void make_room (TokenQueue* queue)
+{
+    if (queue->size - queue->oldest < queue->capacity) {
+        return;
+    }
+
+    /* a queue is only refilled while streaming, so refill is non-NULL here
+     * if and only if this is a streaming queue that is still being lexed */
+    if (queue->refill != NULL && queue->oldest < queue->cursor) {
+        decaf_free((void*)TOKEN_SLOT(queue, queue->oldest)->text);
+        queue->oldest++;
+        return;
+    }
+
+    size_t new_capacity = (queue->capacity > 0 ? queue->capacity * 2 :
+            (queue->refill != NULL ? TOKEN_STREAM_WINDOW : INITIAL_TOKEN_CAPACITY));
+    Token* new_tokens = (Token*)malloc(new_capacity * sizeof(Token));
+    CHECK_MALLOC_PTR(new_tokens)
+    for (size_t i = queue->oldest; i < queue->size; i++) {
+        new_tokens[i & (new_capacity - 1)] = *TOKEN_SLOT(queue, i);
+    }
+    free(queue->tokens);
+    queue->tokens = new_tokens;
+    queue->capacity = new_capacity;
+}
+
+/*
+ * make sure the front of the queue holds a token if there are any left
+ * (returns false if the queue is empty and can't be refilled)
+ */
+static bool fill (TokenQueue* queue)
+{
+    while (queue->cursor == queue->size) {
+        if (queue->refill == NULL) {
+            return false;
+        }
+        if (!queue->refill(queue)) {
+            queue->refill = NULL;   /* stream is exhausted */
+        }
+    }
+    return true;
+}
+
+void TokenQueue_add (TokenQueue* queue, TokenType type, const char* text, size_t length, int line)
 {
-    if (queue->head == NULL) {
-        /* empty list: new token is both head and tail */
-        queue->head = token;
-        queue->tail = token;
-    } else {
-        /* non-empty list: append to tail */
-        queue->tail->next = token;
-        queue->tail = token;
+    make_room(queue);
+
+    /* truncate and NUL-terminate the text so that it can be interned */
+    char buffer[MAX_TOKEN_LEN];
+    if (length >= MAX_TOKEN_LEN) {
+        length = MAX_TOKEN_LEN - 1;
     }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+
+    Token* token = TOKEN_SLOT(queue, queue->size);
+    token->type = type;
+    token->line = line;
+    token->text = decaf_intern(buffer);
+    queue->size++;
 }
 
 Token* TokenQueue_peek (TokenQueue* queue)
 {
-    return queue->head;
+    if (!fill(queue)) {
+        return NULL;
+    }
+    return TOKEN_SLOT(queue, queue->cursor);
 }
 
 Token* TokenQueue_remove (TokenQueue* queue)
 {
-    if (queue->head == NULL) {
+    if (!fill(queue)) {
         /* queue is empty: return NULL */
         return NULL;
-    } else {
-        /* queue is non-empty: remove a token from head and return it */
-        Token* tmp = queue->head;
-        queue->head = queue->head->next;
-        if (queue->head == NULL) {
-            queue->tail = NULL;    /* just removed the last item */
-        }
-        return tmp;
     }
+    return TOKEN_SLOT(queue, queue->cursor++);
 }
 
 bool TokenQueue_is_empty (TokenQueue* queue)
 {
-    return queue->head == NULL;
+    return !fill(queue);
 }
 
 size_t TokenQueue_size (TokenQueue* queue)
 {
-    size_t size = 0;
-    for (Token* cur = queue->head; cur != NULL; cur = cur->next) {
-        size++;
+    while (queue->refill != NULL) {
+        if (!queue->refill(queue)) {
+            queue->refill = NULL;
+        }
     }
-    return size;
+    return queue->size - queue->cursor;
 }
 
 void TokenQueue_print (TokenQueue* queue, FILE* out)
 {
-    for (Token* t = queue->head; t != NULL; t = t->next) {
+    TokenQueue_size(queue);     /* produce any remaining tokens */
+    for (size_t i = queue->cursor; i < queue->size; i++) {
+        Token* t = TOKEN_SLOT(queue, i);
         fprintf(out, "%-8s [line %03d]  %s\n",
                 TokenType_to_string(t->type),
                 t->line, t->text);
@@ -128,9 +182,11 @@ void TokenQueue_print (TokenQueue* queue, FILE* out)
 
 void TokenQueue_free (TokenQueue* queue)
 {
-    /* clean up any remaining tokens */
-    while (!TokenQueue_is_empty(queue)) {
-        Token_free(TokenQueue_remove(queue));
+    /* token text only needs to be released if it wasn't interned in an arena */
+    for (size_t i = queue->oldest; i < queue->size; i++) {
+        decaf_free((void*)TOKEN_SLOT(queue, i)->text);
     }
+    free(queue->tokens);
+    free(queue->refill_state);
     free(queue);
 }
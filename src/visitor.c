@@ -52,133 +52,192 @@ NodeVisitor* NodeVisitor_new()
     return v;
 }
 
-#define PREVISIT(TYPE)  if (visitor->previsit_ ## TYPE != NULL)  { visitor->previsit_ ## TYPE (visitor, node); } \
-                                                           else  { visitor->previsit_default  (visitor, node); }
-#define POSTVISIT(TYPE) if (visitor->postvisit_ ## TYPE != NULL) { visitor->postvisit_ ## TYPE(visitor, node); } \
-                                                           else  { visitor->postvisit_default (visitor, node); }
+#define PREVISIT(TYPE)  if (visitor->previsit_ ## TYPE != NULL)  { PROFILE_COUNT("dispatch", "previsit_" #TYPE); \
+                                                                   visitor->previsit_ ## TYPE (visitor, node); } \
+                                                           else  { PROFILE_COUNT("dispatch", "previsit_default (" #TYPE ")"); \
+                                                                   visitor->previsit_default  (visitor, node); }
+#define POSTVISIT(TYPE) if (visitor->postvisit_ ## TYPE != NULL) { PROFILE_COUNT("dispatch", "postvisit_" #TYPE); \
+                                                                   visitor->postvisit_ ## TYPE(visitor, node); } \
+                                                           else  { PROFILE_COUNT("dispatch", "postvisit_default (" #TYPE ")"); \
+                                                                   visitor->postvisit_default (visitor, node); }
 
-void NodeVisitor_traverse (NodeVisitor* visitor, ASTNode* node)
+/*
+ * type-specific previsit/postvisit dispatch for a single node
+ */
+static void previsit (NodeVisitor* visitor, ASTNode* node)
 {
     switch (node->type)
     {
-        case PROGRAM:
-            PREVISIT(program)
-            FOR_EACH(ASTNode*, var, node->program.variables) {
-                NodeVisitor_traverse(visitor, var);
-            }
-            FOR_EACH(ASTNode*, func, node->program.functions) {
-                NodeVisitor_traverse(visitor, func);
-            }
-            POSTVISIT(program)
-            break;
-
-        case VARDECL:
-            PREVISIT(vardecl)
-            POSTVISIT(vardecl)
-            break;
+        case PROGRAM:       PREVISIT(program)       break;
+        case VARDECL:       PREVISIT(vardecl)       break;
+        case FUNCDECL:      PREVISIT(funcdecl)      break;
+        case BLOCK:         PREVISIT(block)         break;
+        case ASSIGNMENT:    PREVISIT(assignment)    break;
+        case CONDITIONAL:   PREVISIT(conditional)   break;
+        case WHILELOOP:     PREVISIT(whileloop)     break;
+        case RETURNSTMT:    PREVISIT(return)        break;
+        case BREAKSTMT:     PREVISIT(break)         break;
+        case CONTINUESTMT:  PREVISIT(continue)      break;
+        case BINARYOP:      PREVISIT(binaryop)      break;
+        case UNARYOP:       PREVISIT(unaryop)       break;
+        case LOCATION:      PREVISIT(location)      break;
+        case FUNCCALL:      PREVISIT(funccall)      break;
+        case LITERAL:       PREVISIT(literal)       break;
+    }
+}
 
-        case FUNCDECL:
-            PREVISIT(funcdecl)
-            NodeVisitor_traverse(visitor, node->funcdecl.body);
-            POSTVISIT(funcdecl)
-            break;
+static void postvisit (NodeVisitor* visitor, ASTNode* node)
+{
+    switch (node->type)
+    {
+        case PROGRAM:       POSTVISIT(program)      break;
+        case VARDECL:       POSTVISIT(vardecl)      break;
+        case FUNCDECL:      POSTVISIT(funcdecl)     break;
+        case BLOCK:         POSTVISIT(block)        break;
+        case ASSIGNMENT:    POSTVISIT(assignment)   break;
+        case CONDITIONAL:   POSTVISIT(conditional)  break;
+        case WHILELOOP:     POSTVISIT(whileloop)    break;
+        case RETURNSTMT:    POSTVISIT(return)       break;
+        case BREAKSTMT:     POSTVISIT(break)        break;
+        case CONTINUESTMT:  POSTVISIT(continue)     break;
+        case BINARYOP:      POSTVISIT(binaryop)     break;
+        case UNARYOP:       POSTVISIT(unaryop)      break;
+        case LOCATION:      POSTVISIT(location)     break;
+        case FUNCCALL:      POSTVISIT(funccall)     break;
+        case LITERAL:       POSTVISIT(literal)      break;
+    }
+}
 
-        case BLOCK:
-            PREVISIT(block)
-            FOR_EACH (ASTNode*, var, node->block.variables) {
-                NodeVisitor_traverse(visitor, var);
-            }
-            FOR_EACH (ASTNode*, stmt, node->block.statements) {
-                NodeVisitor_traverse(visitor, stmt);
-            }
-            POSTVISIT(block)
-            break;
+/*
+ * in-visit dispatch (the only node type with an in-visit is a binary operator)
+ */
+static void invisit (NodeVisitor* visitor, ASTNode* node)
+{
+    if (visitor->invisit_binaryop != NULL) {
+        visitor->invisit_binaryop(visitor, node);
+    }
+}
 
-        case ASSIGNMENT:
-            PREVISIT(assignment)
-            NodeVisitor_traverse(visitor, node->assignment.location);
-            NodeVisitor_traverse(visitor, node->assignment.value);
-            POSTVISIT(assignment)
-            break;
+/**
+ * @brief Initial number of frames in a traversal stack (grows as needed)
+ */
+#define INITIAL_TRAVERSAL_DEPTH 64
 
-        case CONDITIONAL:
-            PREVISIT(conditional)
-            NodeVisitor_traverse(visitor, node->conditional.condition);
-            NodeVisitor_traverse(visitor, node->conditional.if_block);
-            if (node->conditional.else_block != NULL) {
-                NodeVisitor_traverse(visitor, node->conditional.else_block);
-            }
-            POSTVISIT(conditional)
-            break;
+void TraversalStack_init (TraversalStack* stack)
+{
+    stack->capacity = INITIAL_TRAVERSAL_DEPTH;
+    stack->frames = (TraversalFrame*)malloc(stack->capacity * sizeof(TraversalFrame));
+    CHECK_MALLOC_PTR(stack->frames)
+    stack->top = 0;
+#ifdef DECAF_PROFILE
+    stack->pushes = 0;
+    stack->max_top = 0;
+#endif
+}
 
-        case WHILELOOP:
-            PREVISIT(whileloop)
-            NodeVisitor_traverse(visitor, node->whileloop.condition);
-            NodeVisitor_traverse(visitor, node->whileloop.body);
-            POSTVISIT(whileloop)
-            break;
+void TraversalStack_push (TraversalStack* stack, ASTNode* node)
+{
+    if (node->type < PROGRAM || node->type > LITERAL) {
+        TraversalStack_free(stack);
+        Error_throw_printf("ERROR: Unhandled node traversal\n");
+    }
+    if (stack->top == stack->capacity) {
+        stack->capacity *= 2;
+        stack->frames = (TraversalFrame*)realloc(stack->frames, stack->capacity * sizeof(TraversalFrame));
+        CHECK_MALLOC_PTR(stack->frames)
+    }
+    stack->frames[stack->top].node = node;
+    stack->frames[stack->top].step = 0;
+    stack->frames[stack->top].index = 0;
+    stack->top++;
+#ifdef DECAF_PROFILE
+    stack->pushes++;
+    stack->max_top = (stack->top > stack->max_top ? stack->top : stack->max_top);
+#endif
+}
 
-        case RETURNSTMT:
-            PREVISIT(return)
-            if (node->funcreturn.value != NULL) {
-                NodeVisitor_traverse(visitor, node->funcreturn.value);
-            }
-            POSTVISIT(return)
-            break;
+void TraversalStack_free (TraversalStack* stack)
+{
+    free(stack->frames);
+    stack->frames = NULL;
+    PROFILE_RECORD("traversal", "nodes per traversal", 0, stack->pushes);
+    PROFILE_RECORD("traversal", "maximum depth per traversal", 0, (unsigned long)stack->max_top);
+}
 
-        case BREAKSTMT:
-            PREVISIT(break)
-            POSTVISIT(break)
+/*
+ * return the next element of a node's step-th child list (second may be NULL),
+ * advancing to the following list when the current one is exhausted (lists
+ * are read lazily, exactly when the recursive FOR_EACH loops would read them)
+ */
+static ASTNode* next_list_child (TraversalFrame* frame, NodeList* first, NodeList* second)
+{
+    while (frame->step < 2) {
+        NodeList* list = (frame->step == 0 ? first : second);
+        if (list == NULL) {
             break;
+        }
+        if (frame->index < list->size) {
+            return NodeList_get(list, frame->index++);
+        }
+        frame->step++;
+        frame->index = 0;
+    }
+    return NULL;
+}
 
-        case CONTINUESTMT:
-            PREVISIT(continue)
-            POSTVISIT(continue)
+ASTNode* TraversalFrame_next_child (TraversalFrame* frame)
+{
+    ASTNode* node = frame->node;
+    switch (node->type)
+    {
+        case PROGRAM:
+            return next_list_child(frame, node->program.variables, node->program.functions);
+        case BLOCK:
+            return next_list_child(frame, node->block.variables, node->block.statements);
+        case FUNCCALL:
+            return next_list_child(frame, node->funccall.arguments, NULL);
+        default:
             break;
+    }
 
+    /* fixed children; optional children always come last */
+    int step = frame->step++;
+    switch (node->type)
+    {
+        case FUNCDECL:
+            return (step == 0 ? node->funcdecl.body : NULL);
+        case ASSIGNMENT:
+            return (step == 0 ? node->assignment.location :
+                    step == 1 ? node->assignment.value : NULL);
+        case CONDITIONAL:
+            return (step == 0 ? node->conditional.condition :
+                    step == 1 ? node->conditional.if_block :
+                    step == 2 ? node->conditional.else_block : NULL);
+        case WHILELOOP:
+            return (step == 0 ? node->whileloop.condition :
+                    step == 1 ? node->whileloop.body : NULL);
+        case RETURNSTMT:
+            return (step == 0 ? node->funcreturn.value : NULL);
         case BINARYOP:
-            PREVISIT(binaryop)
-            NodeVisitor_traverse(visitor, node->binaryop.left);
-            if (visitor->invisit_binaryop != NULL) {
-                visitor->invisit_binaryop(visitor, node);
-            }
-            NodeVisitor_traverse(visitor, node->binaryop.right);
-            POSTVISIT(binaryop)
-            break;
-
+            return (step == 0 ? node->binaryop.left :
+                    step == 1 ? node->binaryop.right : NULL);
         case UNARYOP:
-            PREVISIT(unaryop)
-            NodeVisitor_traverse(visitor, node->unaryop.child);
-            POSTVISIT(unaryop)
-            break;
-
+            return (step == 0 ? node->unaryop.child : NULL);
         case LOCATION:
-            PREVISIT(location)
-            if (node->location.index != NULL) {
-                NodeVisitor_traverse(visitor, node->location.index);
-            }
-            POSTVISIT(location)
-            break;
-
-        case FUNCCALL:
-            PREVISIT(funccall)
-            FOR_EACH (ASTNode*, arg, node->funccall.arguments) {
-                NodeVisitor_traverse(visitor, arg);
-            }
-            POSTVISIT(funccall)
-            break;
-
-        case LITERAL:
-            PREVISIT(literal)
-            POSTVISIT(literal)
-            break;
-
+            return (step == 0 ? node->location.index : NULL);
         default:
-            Error_throw_printf("ERROR: Unhandled node traversal\n");
-            break;
+            return NULL;
     }
 }
 
+/*
+ * The traversal uses an explicit heap-allocated stack rather than recursion so
+ * that deeply-nested trees (e.g., long chains of binary operators) can't
+ * overflow the C stack. The order of previsit, invisit, and postvisit calls is
+ * identical to a recursive depth-first traversal.
+ */
+DEF_TRAVERSAL(NodeVisitor_traverse, previsit, invisit, postvisit)
+
 void NodeVisitor_traverse_and_free (NodeVisitor* visitor, ASTNode* node)
 {
     NodeVisitor_traverse(visitor, node);
@@ -195,13 +254,143 @@ void NodeVisitor_free (NodeVisitor* visitor)
 }
 
 
+/*
+ * AST VISITOR: COMPOSITE (LOCKSTEP) TRAVERSAL
+ */
+
+/**
+ * @brief State for a composite visitor
+ */
+typedef struct CompositeVisitorData
+{
+    NodeVisitor** children;     /**< @brief Child visitors (in the order they were added) */
+    int count;                  /**< @brief Number of child visitors */
+    int capacity;               /**< @brief Allocated length of @c children */
+} CompositeVisitorData;
+
+void CompositeVisitorData_free (CompositeVisitorData* data)
+{
+    for (int i = 0; i < data->count; i++) {
+        NodeVisitor_free(data->children[i]);
+    }
+    free(data->children);
+    free(data);
+}
+
+#define CHILDREN ((CompositeVisitorData*)composite->data)
+
+/*
+ * each hook forwards to every child (previsits in order, postvisits in reverse
+ * order); the PREVISIT/POSTVISIT macros handle falling back to the defaults
+ */
+#define DEF_COMPOSITE_VISIT(TYPE) \
+void CompositeVisitor_previsit_ ## TYPE (NodeVisitor* composite, ASTNode* node) \
+{ \
+    for (int i = 0; i < CHILDREN->count; i++) { \
+        NodeVisitor* visitor = CHILDREN->children[i]; \
+        PREVISIT(TYPE) \
+    } \
+} \
+void CompositeVisitor_postvisit_ ## TYPE (NodeVisitor* composite, ASTNode* node) \
+{ \
+    for (int i = CHILDREN->count - 1; i >= 0; i--) { \
+        NodeVisitor* visitor = CHILDREN->children[i]; \
+        POSTVISIT(TYPE) \
+    } \
+}
+
+DEF_COMPOSITE_VISIT(program)
+DEF_COMPOSITE_VISIT(vardecl)
+DEF_COMPOSITE_VISIT(funcdecl)
+DEF_COMPOSITE_VISIT(block)
+DEF_COMPOSITE_VISIT(assignment)
+DEF_COMPOSITE_VISIT(conditional)
+DEF_COMPOSITE_VISIT(whileloop)
+DEF_COMPOSITE_VISIT(return)
+DEF_COMPOSITE_VISIT(break)
+DEF_COMPOSITE_VISIT(continue)
+DEF_COMPOSITE_VISIT(binaryop)
+DEF_COMPOSITE_VISIT(unaryop)
+DEF_COMPOSITE_VISIT(location)
+DEF_COMPOSITE_VISIT(funccall)
+DEF_COMPOSITE_VISIT(literal)
+
+void CompositeVisitor_invisit_binaryop (NodeVisitor* composite, ASTNode* node)
+{
+    for (int i = 0; i < CHILDREN->count; i++) {
+        NodeVisitor* visitor = CHILDREN->children[i];
+        if (visitor->invisit_binaryop != NULL) {
+            visitor->invisit_binaryop(visitor, node);
+        }
+    }
+}
+
+NodeVisitor* CompositeVisitor_new ()
+{
+    CompositeVisitorData* data = (CompositeVisitorData*)calloc(1, sizeof(CompositeVisitorData));
+    CHECK_MALLOC_PTR(data)
+    data->children = NULL;
+    data->count = 0;
+    data->capacity = 0;
+
+    NodeVisitor* v = NodeVisitor_new();
+    v->data = (void*)data;
+    v->dtor = (Destructor)CompositeVisitorData_free;
+    v->previsit_program      = CompositeVisitor_previsit_program;
+    v->postvisit_program     = CompositeVisitor_postvisit_program;
+    v->previsit_vardecl      = CompositeVisitor_previsit_vardecl;
+    v->postvisit_vardecl     = CompositeVisitor_postvisit_vardecl;
+    v->previsit_funcdecl     = CompositeVisitor_previsit_funcdecl;
+    v->postvisit_funcdecl    = CompositeVisitor_postvisit_funcdecl;
+    v->previsit_block        = CompositeVisitor_previsit_block;
+    v->postvisit_block       = CompositeVisitor_postvisit_block;
+    v->previsit_assignment   = CompositeVisitor_previsit_assignment;
+    v->postvisit_assignment  = CompositeVisitor_postvisit_assignment;
+    v->previsit_conditional  = CompositeVisitor_previsit_conditional;
+    v->postvisit_conditional = CompositeVisitor_postvisit_conditional;
+    v->previsit_whileloop    = CompositeVisitor_previsit_whileloop;
+    v->postvisit_whileloop   = CompositeVisitor_postvisit_whileloop;
+    v->previsit_return       = CompositeVisitor_previsit_return;
+    v->postvisit_return      = CompositeVisitor_postvisit_return;
+    v->previsit_break        = CompositeVisitor_previsit_break;
+    v->postvisit_break       = CompositeVisitor_postvisit_break;
+    v->previsit_continue     = CompositeVisitor_previsit_continue;
+    v->postvisit_continue    = CompositeVisitor_postvisit_continue;
+    v->previsit_binaryop     = CompositeVisitor_previsit_binaryop;
+    v->invisit_binaryop      = CompositeVisitor_invisit_binaryop;
+    v->postvisit_binaryop    = CompositeVisitor_postvisit_binaryop;
+    v->previsit_unaryop      = CompositeVisitor_previsit_unaryop;
+    v->postvisit_unaryop     = CompositeVisitor_postvisit_unaryop;
+    v->previsit_location     = CompositeVisitor_previsit_location;
+    v->postvisit_location    = CompositeVisitor_postvisit_location;
+    v->previsit_funccall     = CompositeVisitor_previsit_funccall;
+    v->postvisit_funccall    = CompositeVisitor_postvisit_funccall;
+    v->previsit_literal      = CompositeVisitor_previsit_literal;
+    v->postvisit_literal     = CompositeVisitor_postvisit_literal;
+    return v;
+}
+
+void CompositeVisitor_add (NodeVisitor* composite, NodeVisitor* child)
+{
+    CompositeVisitorData* data = CHILDREN;
+    if (data->count == data->capacity) {
+        data->capacity = (data->capacity == 0 ? 4 : data->capacity * 2);
+        data->children = (NodeVisitor**)realloc(data->children, data->capacity * sizeof(NodeVisitor*));
+        CHECK_MALLOC_PTR(data->children)
+    }
+    data->children[data->count++] = child;
+}
+
+#undef CHILDREN
+
+
 /*
  * AST VISITOR: PRETTY PRINTING
  */
 
 #define OUTFILE ((FILE*)visitor->data)
 
-#define PRINT_INDENT    long depth = (long)ASTNode_get_attribute(node, "depth"); \
+#define PRINT_INDENT    long depth = (long)ASTNode_get_slot_attribute(node, DEPTH_SLOT); \
                         for (long i = 0; i < depth; i++) { \
                             fprintf(OUTFILE, "  "); \
                         }
@@ -354,14 +543,26 @@ NodeVisitor* PrintVisitor_new (FILE* output)
  * AST VISITOR: GRAPH OUTPUT (requires 'dot' utility in GraphViz)
  */
 
+/**
+ * @brief State of an AST graph generator
+ */
+typedef struct GenerateASTGraphData
+{
+    FILE* output;           /**< @brief Output stream */
+    int next_id;            /**< @brief Next "dotid" to assign (restarts at 0 for each tree) */
+} GenerateASTGraphData;
+
+#undef OUTFILE
+#define OUTFILE (((GenerateASTGraphData*)visitor->data)->output)
+
 void GenerateASTGraph_assign_dotid (NodeVisitor* visitor, ASTNode* node)
 {
-    static int next_id = 0;
-    ASTNode_set_attribute(node, "dotid", (void*)(long)next_id, dummy_free);
-    next_id++;
+    GenerateASTGraphData* data = (GenerateASTGraphData*)visitor->data;
+    ASTNode_set_int_slot_attribute(node, DOTID_SLOT, data->next_id);
+    data->next_id++;
 }
 
-#define GET_ID(NODE) ((int)(long)ASTNode_get_attribute(NODE, "dotid"))
+#define GET_ID(NODE) ((int)(long)ASTNode_get_slot_attribute(NODE, DOTID_SLOT))
 #define GEN_LINK(PARENT,CHILD) fprintf(OUTFILE, "%d -> %d;\n", GET_ID(PARENT), GET_ID(CHILD))
 
 void GenerateASTGraph_generate_dot (NodeVisitor* visitor, ASTNode* node)
@@ -393,14 +594,19 @@ void GenerateASTGraph_generate_dot (NodeVisitor* visitor, ASTNode* node)
         }
         default: break;
     }
-    for (Attribute* attr = node->attributes; attr != NULL; attr = attr->next) {
-        if (strncmp(attr->key, "dotid", 10) != 0 &&
-            strncmp(attr->key, "depth", 10) != 0 &&
-            strncmp(attr->key, "parent", 10) != 0) {
-            fprintf(OUTFILE, "\\n%s: ", attr->key);
-            attr->dot_printer(attr->value, OUTFILE);
+    /* dotid, depth, and parent slots are bookkeeping and are not printed */
+    const AttributeSlot printed_slots[] = { TYPE_SLOT, SYMBOL_TABLE_SLOT };
+    for (int i = 0; i < sizeof(printed_slots) / sizeof(AttributeSlot); i++) {
+        if (ASTNode_has_slot_attribute(node, printed_slots[i])) {
+            fprintf(OUTFILE, "\\n%s: ", AttributeSlot_to_key(printed_slots[i]));
+            ASTNode_print_slot_attribute(node, printed_slots[i], OUTFILE);
         }
     }
+    Attribute* list = (node->attributes != NULL ? node->attributes->list : NULL);
+    for (Attribute* attr = list; attr != NULL; attr = attr->next) {
+        fprintf(OUTFILE, "\\n%s: ", attr->key);
+        attr->dot_printer(attr->value, OUTFILE);
+    }
     fprintf(OUTFILE, "\"];\n");
 
     /* create any edges */
@@ -443,6 +649,7 @@ void GenerateASTGraph_generate_dot (NodeVisitor* visitor, ASTNode* node)
 void GenerateASTGraph_initialize (NodeVisitor* visitor, ASTNode* node)
 {
     fprintf(OUTFILE, "digraph AST {\n");
+    ((GenerateASTGraphData*)visitor->data)->next_id = 0;
     GenerateASTGraph_assign_dotid(visitor, node);
 }
 
@@ -455,8 +662,12 @@ void GenerateASTGraph_finalize (NodeVisitor* visitor, ASTNode* node)
 NodeVisitor* GenerateASTGraph_new (FILE* output)
 {
     NodeVisitor* v = NodeVisitor_new();
-    /* use "data" field to store FILE* output pointer */
-    v->data = (void*)output;
+    GenerateASTGraphData* data = (GenerateASTGraphData*)calloc(1, sizeof(GenerateASTGraphData));
+    CHECK_MALLOC_PTR(data)
+    data->output = output;
+    data->next_id = 0;
+    v->data = data;
+    v->dtor = free;
     v->previsit_default      = GenerateASTGraph_assign_dotid;
     v->postvisit_default     = GenerateASTGraph_generate_dot;
     v->previsit_program      = GenerateASTGraph_initialize;
@@ -472,78 +683,78 @@ NodeVisitor* GenerateASTGraph_new (FILE* output)
 void SetParentVisitor_visit_program (NodeVisitor* visitor, ASTNode* node)
 {
     FOR_EACH(ASTNode*, var, node->program.variables) {
-        ASTNode_set_attribute(var, "parent", (void*)node, NULL);
+        ASTNode_set_slot_attribute(var, PARENT_SLOT, (void*)node);
     }
     FOR_EACH(ASTNode*, func, node->program.functions) {
-        ASTNode_set_attribute(func, "parent", (void*)node, NULL);
+        ASTNode_set_slot_attribute(func, PARENT_SLOT, (void*)node);
     }
 }
 
 void SetParentVisitor_visit_funcdecl (NodeVisitor* visitor, ASTNode* node)
 {
-    ASTNode_set_attribute(node->funcdecl.body, "parent", (void*)node, NULL);
+    ASTNode_set_slot_attribute(node->funcdecl.body, PARENT_SLOT, (void*)node);
 }
 
 void SetParentVisitor_visit_block (NodeVisitor* visitor, ASTNode* node)
 {
     FOR_EACH(ASTNode*, var, node->block.variables) {
-        ASTNode_set_attribute(var, "parent", (void*)node, NULL);
+        ASTNode_set_slot_attribute(var, PARENT_SLOT, (void*)node);
     }
     FOR_EACH(ASTNode*, stmt, node->block.statements) {
-        ASTNode_set_attribute(stmt, "parent", (void*)node, NULL);
+        ASTNode_set_slot_attribute(stmt, PARENT_SLOT, (void*)node);
     }
 }
 
 void SetParentVisitor_visit_assignment (NodeVisitor* visitor, ASTNode* node)
 {
-    ASTNode_set_attribute(node->assignment.location, "parent", (void*)node, NULL);
-    ASTNode_set_attribute(node->assignment.value, "parent", (void*)node, NULL);
+    ASTNode_set_slot_attribute(node->assignment.location, PARENT_SLOT, (void*)node);
+    ASTNode_set_slot_attribute(node->assignment.value, PARENT_SLOT, (void*)node);
 }
 
 void SetParentVisitor_visit_conditional (NodeVisitor* visitor, ASTNode* node)
 {
-    ASTNode_set_attribute(node->conditional.condition, "parent", (void*)node, NULL);
-    ASTNode_set_attribute(node->conditional.if_block, "parent", (void*)node, NULL);
+    ASTNode_set_slot_attribute(node->conditional.condition, PARENT_SLOT, (void*)node);
+    ASTNode_set_slot_attribute(node->conditional.if_block, PARENT_SLOT, (void*)node);
     if (node->conditional.else_block != NULL) {
-        ASTNode_set_attribute(node->conditional.else_block, "parent", (void*)node, NULL);
+        ASTNode_set_slot_attribute(node->conditional.else_block, PARENT_SLOT, (void*)node);
     }
 }
 
 void SetParentVisitor_visit_whileloop (NodeVisitor* visitor, ASTNode* node)
 {
-    ASTNode_set_attribute(node->whileloop.condition, "parent", (void*)node, NULL);
-    ASTNode_set_attribute(node->whileloop.body, "parent", (void*)node, NULL);
+    ASTNode_set_slot_attribute(node->whileloop.condition, PARENT_SLOT, (void*)node);
+    ASTNode_set_slot_attribute(node->whileloop.body, PARENT_SLOT, (void*)node);
 }
 
 void SetParentVisitor_visit_return (NodeVisitor* visitor, ASTNode* node)
 {
     if (node->funcreturn.value != NULL) {
-        ASTNode_set_attribute(node->funcreturn.value, "parent", (void*)node, NULL);
+        ASTNode_set_slot_attribute(node->funcreturn.value, PARENT_SLOT, (void*)node);
     }
 }
 
 void SetParentVisitor_visit_binaryop (NodeVisitor* visitor, ASTNode* node)
 {
-    ASTNode_set_attribute(node->binaryop.left, "parent", (void*)node, NULL);
-    ASTNode_set_attribute(node->binaryop.right, "parent", (void*)node, NULL);
+    ASTNode_set_slot_attribute(node->binaryop.left, PARENT_SLOT, (void*)node);
+    ASTNode_set_slot_attribute(node->binaryop.right, PARENT_SLOT, (void*)node);
 }
 
 void SetParentVisitor_visit_unaryop (NodeVisitor* visitor, ASTNode* node)
 {
-    ASTNode_set_attribute(node->unaryop.child, "parent", (void*)node, NULL);
+    ASTNode_set_slot_attribute(node->unaryop.child, PARENT_SLOT, (void*)node);
 }
 
 void SetParentVisitor_visit_location (NodeVisitor* visitor, ASTNode* node)
 {
     if (node->location.index != NULL) {
-        ASTNode_set_attribute(node->location.index, "parent", (void*)node, NULL);
+        ASTNode_set_slot_attribute(node->location.index, PARENT_SLOT, (void*)node);
     }
 }
 
 void SetParentVisitor_visit_funccall (NodeVisitor* visitor, ASTNode* node)
 {
     FOR_EACH(ASTNode*, arg, node->funccall.arguments) {
-        ASTNode_set_attribute(arg, "parent", (void*)node, NULL);
+        ASTNode_set_slot_attribute(arg, PARENT_SLOT, (void*)node);
     }
 }
 
@@ -571,14 +782,14 @@ NodeVisitor* SetParentVisitor_new()
 
 void CalcDepthVisitor_visit_program (NodeVisitor* visitor, ASTNode* node)
 {
-    ASTNode_set_int_attribute(node, "depth", 0);
+    ASTNode_set_int_slot_attribute(node, DEPTH_SLOT, 0);
 }
 
 void CalcDepthVisitor_visit_nonprogram (NodeVisitor* visitor, ASTNode* node)
 {
-    ASTNode* parent = (ASTNode*)ASTNode_get_attribute(node, "parent");
-    long pdepth = (long)ASTNode_get_int_attribute(parent, "depth");
-    ASTNode_set_int_attribute(node, "depth", pdepth + 1);
+    ASTNode* parent = (ASTNode*)ASTNode_get_slot_attribute(node, PARENT_SLOT);
+    long pdepth = (long)ASTNode_get_int_slot_attribute(parent, DEPTH_SLOT);
+    ASTNode_set_int_slot_attribute(node, DEPTH_SLOT, pdepth + 1);
 }
 
 NodeVisitor* CalcDepthVisitor_new ()
@@ -588,3 +799,112 @@ NodeVisitor* CalcDepthVisitor_new ()
     v->previsit_default  = CalcDepthVisitor_visit_nonprogram;
     return v;
 }
+
+
+/*
+ * AST VISITOR: CONSTANT FOLDING
+ */
+
+bool ASTNode_get_constant (ASTNode* node, int* value)
+{
+    if (node == NULL || !ASTNode_has_slot_attribute(node, CONSTANT_SLOT)) {
+        return false;
+    }
+    *value = ASTNode_get_int_slot_attribute(node, CONSTANT_SLOT);
+    return true;
+}
+
+/*
+ * type of a constant expression (implied by its root, since only well-typed
+ * expressions are folded)
+ */
+static DecafType constant_type (ASTNode* node)
+{
+    switch (node->type) {
+        case LITERAL:   return node->literal.type;
+        case UNARYOP:   return (node->unaryop.operator == NEGOP ? INT : BOOL);
+        case BINARYOP:  return (node->binaryop.operator >= ADDOP ? INT : BOOL);
+        default:        return UNKNOWN;
+    }
+}
+
+/*
+ * wrapping 32-bit arithmetic (computed on unsigned values to avoid undefined
+ * behavior on overflow)
+ */
+#define WRAP(EXPR) ((int)(uint32_t)(EXPR))
+
+void FoldConstantsVisitor_visit_literal (NodeVisitor* visitor, ASTNode* node)
+{
+    if (node->literal.type == INT) {
+        ASTNode_set_int_slot_attribute(node, CONSTANT_SLOT, node->literal.integer);
+    } else if (node->literal.type == BOOL) {
+        ASTNode_set_int_slot_attribute(node, CONSTANT_SLOT, node->literal.boolean ? 1 : 0);
+    }
+}
+
+void FoldConstantsVisitor_visit_unaryop (NodeVisitor* visitor, ASTNode* node)
+{
+    ASTNode* child = node->unaryop.child;
+    int value;
+    if (!ASTNode_get_constant(child, &value) || constant_type(child) != constant_type(node)) {
+        return;
+    }
+    ASTNode_set_int_slot_attribute(node, CONSTANT_SLOT,
+            (node->unaryop.operator == NEGOP ? WRAP(0u - (uint32_t)value) : !value));
+}
+
+void FoldConstantsVisitor_visit_binaryop (NodeVisitor* visitor, ASTNode* node)
+{
+    ASTNode* left = node->binaryop.left;
+    ASTNode* right = node->binaryop.right;
+    int a, b;
+    if (!ASTNode_get_constant(left, &a) || !ASTNode_get_constant(right, &b)) {
+        return;
+    }
+
+    /* operand types must match the operator */
+    DecafType type = constant_type(left);
+    BinaryOpType op = node->binaryop.operator;
+    if (type != constant_type(right) ||
+            ((op == OROP || op == ANDOP) && type != BOOL) ||
+            (op >= LTOP && type != INT)) {
+        return;
+    }
+
+    int result;
+    switch (op) {
+        case OROP:  result = a || b;    break;
+        case ANDOP: result = a && b;    break;
+        case EQOP:  result = a == b;    break;
+        case NEQOP: result = a != b;    break;
+        case LTOP:  result = a < b;     break;
+        case LEOP:  result = a <= b;    break;
+        case GEOP:  result = a >= b;    break;
+        case GTOP:  result = a > b;     break;
+        case ADDOP: result = WRAP((uint32_t)a + (uint32_t)b);   break;
+        case SUBOP: result = WRAP((uint32_t)a - (uint32_t)b);   break;
+        case MULOP: result = WRAP((uint32_t)a * (uint32_t)b);   break;
+        case DIVOP:
+        case MODOP:
+            if (b == 0 || (a == INT32_MIN && b == -1)) {
+                return;
+            }
+            result = (op == DIVOP ? a / b : a % b);
+            break;
+        default:
+            return;
+    }
+    ASTNode_set_int_slot_attribute(node, CONSTANT_SLOT, result);
+}
+
+#undef WRAP
+
+NodeVisitor* FoldConstantsVisitor_new ()
+{
+    NodeVisitor* v = NodeVisitor_new();
+    v->postvisit_literal  = FoldConstantsVisitor_visit_literal;
+    v->postvisit_unaryop  = FoldConstantsVisitor_visit_unaryop;
+    v->postvisit_binaryop = FoldConstantsVisitor_visit_binaryop;
+    return v;
+}
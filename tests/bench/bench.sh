@@ -0,0 +1,116 @@
+#!/bin/bash
+#
+# Benchmark harness: generates synthetic programs of increasing size along
+# several dimensions (see gen.c), compiles each one several times with
+# "--stats=json", and reports the best time of each phase along with the
+# overall throughput. Each series scales one dimension; if the time per node
+# grows by more than SCALING_LIMIT across a series, the series is flagged as a
+# possible super-linear scaling cliff.
+#
+# Environment variables:
+#   REPS           compilations per program (default 5)
+#   SCALE          multiplier for the size of every series (default 1)
+#   SCALING_LIMIT  allowed growth in time per node across a series (default 2)
+#   SERIES         space-separated list of series to run (default all)
+#
+
+cd "$(dirname "$0")"
+
+EXE=../../decaf
+GEN=./gen
+OUT=programs
+REPS=${REPS:-5}
+SCALE=${SCALE:-1}
+SCALING_LIMIT=${SCALING_LIMIT:-2}
+SERIES=${SERIES:-"functions globals depth chain arrays"}
+
+if [ ! -x "$EXE" ] || [ ! -x "$GEN" ]; then
+    echo "Build the compiler and the generator first (make bench)"
+    exit 1
+fi
+mkdir -p "$OUT"
+
+# print "step|generator arguments" for each step of a series
+function series_steps {
+    case $1 in
+        functions) for n in 1000 2000 4000 8000; do echo "$n|-f $((n * SCALE))"; done ;;
+        globals)   for n in 1000 2000 4000 8000; do echo "$n|-g $((n * SCALE)) -f 10"; done ;;
+        depth)     for n in 2 4 8 16;            do echo "$n|-d $n -f $((1000 * SCALE))"; done ;;
+        chain)     for n in 4 16 64;             do echo "$n|-e $n -f $((1000 * SCALE))"; done ;;
+        arrays)    for n in 0 8 32;              do echo "$n|-a $n -f $((1000 * SCALE))"; done ;;
+        *)         echo "Unknown series: $1" >&2 ;;
+    esac
+}
+
+# print the best (minimum) time of each phase over several --stats=json lines,
+# followed by the node count
+function best_of {
+    awk '
+    {
+        if (match($0, /"nodes": [0-9]+/)) {
+            nodes = substr($0, RSTART + 9, RLENGTH - 9)
+        }
+        n = split("front_end setup analysis output", phases, " ")
+        for (i = 1; i <= n; i++) {
+            ms = 0
+            if (match($0, "\"" phases[i] "\": \\{\"ms\": [0-9.]+")) {
+                s = substr($0, RSTART, RLENGTH)
+                sub(/.*"ms": /, "", s)
+                ms = s + 0
+            }
+            if (NR == 1 || ms < best[i]) {
+                best[i] = ms
+            }
+        }
+    }
+    END {
+        total = 0
+        for (i = 1; i <= n; i++) {
+            printf "%.3f ", best[i]
+            total += best[i]
+        }
+        printf "%.3f %d\n", total, nodes
+    }'
+}
+
+FAILED=0
+printf "%-10s %6s %9s %9s %10s %10s %10s %10s %10s %12s %12s %8s\n" \
+    "series" "step" "lines" "nodes" "front_end" "setup" "analysis" "output" "total(ms)" \
+    "lines/s" "nodes/s" "ns/node"
+for series in $SERIES; do
+    first_ns=""
+    last_ns=""
+    while IFS='|' read -r step args; do
+        [ -z "$step" ] && continue
+        program="$OUT/$series-$step.decaf"
+        $GEN $args >"$program"
+        lines=$(wc -l <"$program")
+
+        stats=""
+        for ((r = 0; r < REPS; r++)); do
+            stats+=$($EXE --stats=json "$program" 2>&1 >/dev/null | grep '^{')
+            stats+=$'\n'
+        done
+        read -r fe setup analysis output total nodes <<<"$(echo "$stats" | grep '^{' | best_of)"
+
+        read -r lps nps nspn <<<"$(awk -v l="$lines" -v n="$nodes" -v t="$total" 'BEGIN {
+            if (t <= 0) t = 0.001
+            printf "%.0f %.0f %.1f\n", l / (t / 1000), n / (t / 1000), (t * 1e6) / (n > 0 ? n : 1)
+        }')"
+        printf "%-10s %6s %9d %9d %10s %10s %10s %10s %10s %12s %12s %8s\n" \
+            "$series" "$step" "$lines" "$nodes" "$fe" "$setup" "$analysis" "$output" "$total" \
+            "$lps" "$nps" "$nspn"
+
+        [ -z "$first_ns" ] && first_ns=$nspn
+        last_ns=$nspn
+    done < <(series_steps "$series")
+
+    # flag series whose cost per node grows super-linearly
+    if [ -n "$first_ns" ] && awk -v a="$first_ns" -v b="$last_ns" -v k="$SCALING_LIMIT" \
+            'BEGIN { exit !(b > a * k) }'; then
+        echo "WARNING: time per node in series '$series' grew from $first_ns to $last_ns ns"
+        FAILED=1
+    fi
+done
+
+exit $FAILED
@@ -0,0 +1,239 @@
+/**
+ * @file gen.c
+ * @brief Synthetic Decaf program generator (for benchmarking)
+ *
+ * Writes a valid Decaf program (one that compiles with no errors) to standard
+ * output. The shape of the program is controlled by the following options
+ * (defaults in parentheses):
+ *
+ * - <tt>-g N</tt>: number of global scalar variables (10)
+ * - <tt>-f N</tt>: number of functions, not including @c main (100)
+ * - <tt>-d N</tt>: nesting depth of the if/while statements in each function (3)
+ * - <tt>-e N</tt>: number of operands in each arithmetic expression chain (8)
+ * - <tt>-a N</tt>: number of array accesses in the innermost block of each function (4)
+ * - <tt>-w N</tt>: number of locals redeclared (shadowing the enclosing block's) in every block (0)
+ * - <tt>-s N</tt>: random seed (1)
+ *
+ * Each function calls the previous one, so every function is reachable from
+ * @c main. Output is deterministic for a given set of options. Indentation
+ * stops growing after @ref MAX_INDENT levels, so that very deep programs
+ * aren't dominated by whitespace.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/**
+ * @brief Number of global arrays (the targets of array accesses)
+ */
+#define NUM_ARRAYS 4
+
+/**
+ * @brief Length of each global array
+ */
+#define ARRAY_LENGTH 100
+
+/**
+ * @brief Maximum indentation level
+ */
+#define MAX_INDENT 32
+
+/**
+ * @brief Generator settings
+ */
+typedef struct Options
+{
+    int globals;        /**< @brief Global scalar variables */
+    int functions;      /**< @brief Functions (not including main) */
+    int depth;          /**< @brief Statement nesting depth */
+    int chain;          /**< @brief Operands per expression chain */
+    int arrays;         /**< @brief Array accesses per function */
+    int shadows;        /**< @brief Shadowing locals per block */
+    uint64_t seed;      /**< @brief Random seed */
+} Options;
+
+/**
+ * @brief Random number generator state (xorshift64, so that the output doesn't
+ * depend on the C library)
+ */
+static uint64_t rng_state;
+
+static int random_below (int n)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (int)(rng_state % (uint64_t)n);
+}
+
+static void indent (int level)
+{
+    for (int i = 0; i < level && i < MAX_INDENT; i++) {
+        fputs("    ", stdout);
+    }
+}
+
+/**
+ * @brief Print a random integer operand that is in scope at the given depth
+ */
+static void print_operand (const Options* options, int depth)
+{
+    switch (random_below(5)) {
+        case 0:  printf("x");                                           break;
+        case 1:  printf("y");                                           break;
+        case 2:  printf("v%d", random_below(2));                        break;
+        case 3:
+            if (options->globals > 0) {
+                printf("g%d", random_below(options->globals));
+            } else {
+                printf("%d", random_below(1000));
+            }
+            break;
+        default:
+            if (depth > 0) {
+                printf("t%d", random_below(depth));
+            } else {
+                printf("%d", random_below(1000));
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Declare and assign the shadowing locals of a block
+ */
+static void print_shadows (const Options* options, int level)
+{
+    for (int i = 0; i < options->shadows; i++) {
+        indent(level);
+        printf("int s%d;\n", i);
+    }
+    for (int i = 0; i < options->shadows; i++) {
+        indent(level);
+        printf("s%d = v0 + s%d;\n", i, random_below(options->shadows));
+    }
+}
+
+/**
+ * @brief Print an arithmetic expression chain with the configured number of operands
+ */
+static void print_chain (const Options* options, int depth)
+{
+    static const char* const operators[] = { "+", "-", "*" };
+    print_operand(options, depth);
+    for (int i = 1; i < options->chain; i++) {
+        printf(" %s ", operators[random_below(3)]);
+        print_operand(options, depth);
+    }
+}
+
+static void print_function (const Options* options, int index)
+{
+    printf("def int f%d(int x, int y)\n{\n", index);
+    printf("    int v0;\n    int v1;\n");
+    print_shadows(options, 1);
+    printf("    v0 = ");
+    print_chain(options, 0);
+    printf(";\n    v1 = x;\n");
+
+    /* nested if/while statements, each with its own local */
+    for (int level = 0; level < options->depth; level++) {
+        indent(level + 1);
+        if (level % 2 == 0) {
+            printf("if (v0 < %d && v1 != y) {\n", random_below(1000));
+        } else {
+            printf("while (v1 > %d) {\n", random_below(1000));
+        }
+        indent(level + 2);
+        printf("int t%d;\n", level);
+        print_shadows(options, level + 2);
+        indent(level + 2);
+        printf("t%d = ", level);
+        print_chain(options, level);
+        printf(";\n");
+        indent(level + 2);
+        printf("v1 = v1 - t%d;\n", level);
+    }
+
+    /* array accesses and a call in the innermost block */
+    int level = options->depth + 1;
+    for (int i = 0; i < options->arrays; i++) {
+        int array = random_below(NUM_ARRAYS);
+        indent(level);
+        if (i % 2 == 0) {
+            printf("a%d[%d] = v0 + a%d[v1 %% %d];\n", array, random_below(ARRAY_LENGTH),
+                   random_below(NUM_ARRAYS), ARRAY_LENGTH);
+        } else {
+            printf("v0 = v0 * a%d[%d];\n", array, random_below(ARRAY_LENGTH));
+        }
+    }
+    if (index > 0) {
+        indent(level);
+        printf("v0 = f%d(v1, v0 + 1);\n", index - 1);
+    }
+
+    for (int l = options->depth - 1; l >= 0; l--) {
+        indent(l + 1);
+        printf("}\n");
+    }
+    printf("    return v0;\n}\n\n");
+}
+
+static int parse_count (const char* text)
+{
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (*end != '\0' || value < 0 || value > 100000000) {
+        fprintf(stderr, "Invalid count: %s\n", text);
+        exit(EXIT_FAILURE);
+    }
+    return (int)value;
+}
+
+int main (int argc, char** argv)
+{
+    Options options = { 10, 100, 3, 8, 4, 0, 1 };
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc || strlen(argv[i]) != 2 || argv[i][0] != '-') {
+            fprintf(stderr, "Usage: %s [-g globals] [-f functions] [-d depth] "
+                            "[-e chain-length] [-a array-accesses] [-w shadowing-locals] [-s seed]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        int value = parse_count(argv[++i]);
+        switch (argv[i-1][1]) {
+            case 'g': options.globals = value;          break;
+            case 'f': options.functions = value;        break;
+            case 'd': options.depth = value;            break;
+            case 'e': options.chain = (value > 0 ? value : 1); break;
+            case 'a': options.arrays = value;           break;
+            case 'w': options.shadows = value;          break;
+            case 's': options.seed = (uint64_t)value;   break;
+            default:
+                fprintf(stderr, "Unknown option: %s\n", argv[i-1]);
+                return EXIT_FAILURE;
+        }
+    }
+    rng_state = options.seed * 2654435761u + 88172645463325252ull;
+
+    printf("// generated by gen -g %d -f %d -d %d -e %d -a %d -w %d -s %d\n\n",
+           options.globals, options.functions, options.depth, options.chain,
+           options.arrays, options.shadows, (int)options.seed);
+    for (int i = 0; i < options.globals; i++) {
+        printf("int g%d;\n", i);
+    }
+    for (int i = 0; i < NUM_ARRAYS; i++) {
+        printf("int a%d[%d];\n", i, ARRAY_LENGTH);
+    }
+    printf("\n");
+    for (int i = 0; i < options.functions; i++) {
+        print_function(&options, i);
+    }
+    printf("def int main()\n{\n    int r;\n");
+    if (options.functions > 0) {
+        printf("    r = f%d(1, 2);\n", options.functions - 1);
+    }
+    printf("    return 0;\n}\n");
+    return EXIT_SUCCESS;
+}
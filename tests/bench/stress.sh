@@ -0,0 +1,96 @@
+#!/bin/bash
+#
+# Stress suite: generates pathological programs (see gen.c) that target the
+# known scaling cliffs of the compiler (deep scope nesting, huge global
+# scopes, very long expression chains, and heavy name shadowing), compiles
+# each one with "--stats=json", and checks its best time and peak resident set
+# size against a budget. A case fails if the compiler doesn't succeed or if it
+# exceeds either budget, which is how quadratic behavior shows up at these
+# sizes; the budgets leave several times the expected headroom for an
+# unoptimized build.
+#
+# Environment variables:
+#   REPS        compilations per program (default 3)
+#   TIME_SCALE  multiplier for every time budget (default 1)
+#   RSS_SCALE   multiplier for every memory budget (default 1)
+#   CASES       space-separated list of cases to run (default all)
+#
+
+cd "$(dirname "$0")"
+
+EXE=../../decaf
+GEN=./gen
+OUT=programs
+REPS=${REPS:-3}
+TIME_SCALE=${TIME_SCALE:-1}
+RSS_SCALE=${RSS_SCALE:-1}
+CASES=${CASES:-"deep_blocks globals long_chain shadowing"}
+
+if [ ! -x "$EXE" ] || [ ! -x "$GEN" ]; then
+    echo "Build the compiler and the generator first (make stress)"
+    exit 1
+fi
+mkdir -p "$OUT"
+
+# print "generator arguments|time budget (ms)|memory budget (MiB)" for a case
+function case_spec {
+    case $1 in
+        deep_blocks) echo "-d 10000 -f 1 -e 4 -a 0|3000|160" ;;
+        globals)     echo "-g 100000 -f 1|1500|200" ;;
+        long_chain)  echo "-e 50000 -d 0 -a 0 -f 1|2000|160" ;;
+        shadowing)   echo "-d 200 -w 50 -f 4|1500|100" ;;
+        *)           echo "Unknown case: $1" >&2 ;;
+    esac
+}
+
+FAILED=0
+printf "%-12s %9s %9s %10s %10s %10s %10s  %s\n" \
+    "case" "lines" "nodes" "time(ms)" "budget" "RSS(MiB)" "budget" "result"
+for name in $CASES; do
+    IFS='|' read -r args time_budget rss_budget <<<"$(case_spec "$name")"
+    [ -z "$args" ] && { FAILED=1; continue; }
+    program="$OUT/stress-$name.decaf"
+    $GEN $args >"$program"
+    lines=$(wc -l <"$program")
+
+    # best time and largest peak RSS over all runs
+    best_ms=""
+    peak_kb=0
+    nodes=0
+    status=0
+    for ((r = 0; r < REPS; r++)); do
+        $EXE --stats=json "$program" >/dev/null 2>"$OUT/stress.err" || status=1
+        stats=$(grep '^{' "$OUT/stress.err")
+        [ -z "$stats" ] && status=1
+        read -r ms kb n <<<"$(echo "$stats" | awk '{
+            ms = 0; kb = 0; n = 0
+            if (match($0, /"total_ms": [0-9.]+/))     ms = substr($0, RSTART + 12, RLENGTH - 12)
+            if (match($0, /"peak_rss_kb": [0-9]+/))   kb = substr($0, RSTART + 15, RLENGTH - 15)
+            if (match($0, /"nodes": [0-9]+/))         n = substr($0, RSTART + 9, RLENGTH - 9)
+            print ms + 0, kb + 0, n + 0
+        }')"
+        if [ -z "$best_ms" ] || awk -v a="$ms" -v b="$best_ms" 'BEGIN { exit !(a < b) }'; then
+            best_ms=$ms
+        fi
+        [ "$kb" -gt "$peak_kb" ] && peak_kb=$kb
+        nodes=$n
+    done
+
+    read -r time_limit rss_limit rss_mib <<<"$(awk -v t="$time_budget" -v m="$rss_budget" \
+        -v ts="$TIME_SCALE" -v rs="$RSS_SCALE" -v kb="$peak_kb" \
+        'BEGIN { printf "%.0f %.0f %.1f\n", t * ts, m * rs, kb / 1024 }')"
+    result="ok"
+    if [ $status -ne 0 ]; then
+        result="FAILED (compilation did not succeed)"
+    elif awk -v a="$best_ms" -v b="$time_limit" 'BEGIN { exit !(a > b) }'; then
+        result="FAILED (over time budget)"
+    elif awk -v a="$rss_mib" -v b="$rss_limit" 'BEGIN { exit !(a > b) }'; then
+        result="FAILED (over memory budget)"
+    fi
+    [ "$result" != "ok" ] && FAILED=1
+
+    printf "%-12s %9d %9d %10.1f %10s %10s %10s  %s\n" \
+        "$name" "$lines" "$nodes" "$best_ms" "$time_limit" "$rss_mib" "$rss_limit" "$result"
+done
+
+exit $FAILED
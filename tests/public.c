@@ -36,6 +36,228 @@ TEST_INVALID(A_invalid_main_var,      "int main; def int foo(int a) { return 0;
 
 // Tests we added
 TEST_INVALID(type_mismatch_expression, "bool i; def int main () { i = 2 + 3; return 0 }")
+TEST_VALID(shadowed_global_many,       "int a; int b; int c; int d; int e; int f; int g; int h; int i; int j; "
+                                       "def int main() { bool a; a = true; j = i; return 0; }")
+TEST_INVALID_MAIN(dup_var_local,       "int x; bool y; bool x; return 0;")
+TEST_INVALID_MAIN(folded_index_too_large, "int a[3]; a[1 + 2] = 0; return 0;")
+TEST_INVALID_MAIN(folded_index_negative,  "int a[3]; a[(2 - 3) * 4] = 0; return 0;")
+TEST_VALID_MAIN(folded_index_in_bounds,   "int a[3]; a[(7 % 4) - 1] = 0; a[1 / 0] = 1; return 0;")
+TEST_VALID(call_no_arguments,          "def void f() { return; } def int main() { f(); return 0; }")
+TEST_INVALID(call_too_few_arguments,   "def void f(int a, int b) { return; } def int main() { f(1); return 0; }")
+TEST_INVALID_MAIN(call_undefined,      "foo(); return 0;")
+TEST_INVALID_MAIN(call_variable,       "int x; x(); return 0;")
+TEST_INVALID_MAIN(undefined_array_assign, "x[1] = 5; return 0;")
+TEST_INVALID_MAIN(undefined_array_read,   "int y; y = x[2]; return 0;")
+TEST_VALID(nested_shadowing,           "int x; def int main() { bool x; while (x) { int x; x = 1; } x = true; return 0; }")
+TEST_INVALID(nested_shadowing_restored, "int x; def int main() { if (true) { bool x; x = true; } x = true; return 0; }")
+TEST_INVALID(call_second_argument,     "def void f(int a, bool b) { return; } def int main() { f(1, 2); return 0; }")
+
+/*
+ * Incremental analysis should report the same errors as a full analysis while
+ * only re-analyzing functions that changed (or whose callees changed)
+ */
+START_TEST (incremental_reanalysis)
+{
+    AnalysisCache* cache = AnalysisCache_new();
+    ErrorList* errors = run_incremental_analysis(
+            "def int f(int a) { return 1; } def int main() { return f(0); }", cache);
+    ck_assert (errors != NULL && ErrorList_is_empty(errors) && cache->misses == 2);
+
+    /* unchanged main is reused */
+    errors = run_incremental_analysis(
+            "def int f(int a) { return 2; } def int main() { return f(0); }", cache);
+    ck_assert (errors != NULL && ErrorList_is_empty(errors) && cache->hits == 1);
+
+    /* new callee signature invalidates main */
+    errors = run_incremental_analysis(
+            "def bool f(int a) { return true; } def int main() { return f(0); }", cache);
+    ck_assert (errors != NULL && ErrorList_size(errors) == 1 && cache->misses == 2);
+
+    /* cached errors are replayed */
+    errors = run_incremental_analysis(
+            "def bool f(int a) { return false; } def int main() { return f(0); }", cache);
+    ck_assert (errors != NULL && ErrorList_size(errors) == 1 && cache->hits == 1);
+
+    /* a loop in an earlier function affects whether a later break is valid */
+    errors = run_incremental_analysis(
+            "def int g() { while (true) { } return 0; } def int main() { break; return 0; }", cache);
+    ck_assert (errors != NULL && ErrorList_is_empty(errors));
+    errors = run_incremental_analysis(
+            "def int g() { return 0; } def int main() { break; return 0; }", cache);
+    ck_assert (errors != NULL && ErrorList_size(errors) == 1 && cache->misses == 2);
+    AnalysisCache_free(cache);
+}
+END_TEST
+
+/*
+ * A saved AST should reload with the same symbol tables, and damaged data
+ * should be rejected
+ */
+START_TEST (binary_ast_round_trip)
+{
+    ck_assert (binary_round_trip(
+            "int g; bool flags[4]; "
+            "def int f(int a, bool b) { int c; c = a * 2; if (b && c > 3) { return c; } return 0; } "
+            "def int main() { while (g < 10) { g = f(g, !flags[1]); } print_str(\"done\\n\"); return 0; }"));
+}
+END_TEST
+
+/*
+ * Error messages are only formatted on request, and the other error modes
+ * count the same errors while recording fewer of them
+ */
+START_TEST (deferred_error_modes)
+{
+    char* text = "def int main() { int x; x = true; return y; }";
+    ErrorList* errors = run_analysis(text);
+    ck_assert_int_eq (ErrorList_size(errors), 2);
+    ck_assert_int_eq (ErrorList_recorded(errors), 2);
+    char message[MAX_ERROR_LEN];
+    ErrorList_format(errors, 1, message, sizeof(message));
+    ck_assert (strcmp(message, "Symbol 'y' undefined on line 1") == 0);
+    ck_assert_int_eq (ErrorList_format(errors, 0, message, 8), 7);
+    ck_assert (strcmp(message, "Type mi") == 0);
+
+    errors = run_analysis_with_mode(text, FIRST_ERROR_ONLY);
+    ck_assert (ErrorList_size(errors) == 2 && ErrorList_recorded(errors) == 1);
+    errors = run_analysis_with_mode(text, COUNT_ERRORS_ONLY);
+    ck_assert (ErrorList_size(errors) == 2 && ErrorList_recorded(errors) == 0);
+}
+END_TEST
+
+/*
+ * Analyzing functions concurrently should report the same errors in the same
+ * (source) order
+ */
+START_TEST (parallel_analysis_order)
+{
+    char* text = "int g; def int f(int a) { return true; } def bool h() { return 1; } "
+                 "def int k() { g = false; return x; } def int main() { return f(1); }";
+    ErrorList* expected = run_analysis(text);
+    ErrorList* actual = run_parallel_analysis(text, 3);
+    ck_assert_int_eq (ErrorList_size(expected), 4);
+    ck_assert_int_eq (ErrorList_size(actual), ErrorList_size(expected));
+    char expected_msg[MAX_ERROR_LEN], actual_msg[MAX_ERROR_LEN];
+    for (int i = 0; i < ErrorList_size(expected); i++) {
+        ErrorList_format(expected, i, expected_msg, sizeof(expected_msg));
+        ErrorList_format(actual, i, actual_msg, sizeof(actual_msg));
+        ck_assert (strcmp(expected_msg, actual_msg) == 0);
+    }
+}
+END_TEST
+
+/*
+ * The loop state carries over from one function to the next in a sequential
+ * analysis, so a parallel analysis must start each function in the same state
+ */
+START_TEST (parallel_analysis_loop_state)
+{
+    char text[8192] = "def void h() { break; } def void g() { while (true) { } } ";
+    for (int i = 0; i < 100; i++) {
+        snprintf(text + strlen(text), sizeof(text) - strlen(text), "def void f%d() { continue; } ", i);
+    }
+    strcat(text, "def int main() { return 0; }");
+    ck_assert_int_eq (ErrorList_size(run_analysis(text)), 1);
+    ck_assert_int_eq (ErrorList_size(run_parallel_analysis(text, 4)), 1);
+}
+END_TEST
+
+/**
+ * A library context should report each kind of result and reuse its memory
+ * across compilations
+ */
+START_TEST (context_reuse)
+{
+    DecafContext* ctx = DecafContext_new(ALL_ERRORS);
+    char* valid = "def int main() { return 0; }";
+
+    ck_assert (DecafContext_compile_string(ctx, valid));
+    ck_assert (DecafContext_get_tree(ctx) != NULL);
+    ck_assert (DecafContext_get_fatal_error(ctx) == NULL);
+    ArenaChunk* chunk = ctx->arena->head;
+
+    ck_assert (!DecafContext_compile_string(ctx, "def int main() { return true; }"));
+    ck_assert_int_eq (ErrorList_size(DecafContext_get_errors(ctx)), 1);
+
+    ck_assert (!DecafContext_compile_string(ctx, "def int main( { return 0; }"));
+    ck_assert (DecafContext_get_tree(ctx) == NULL);
+    ck_assert (DecafContext_get_errors(ctx) == NULL);
+    ck_assert (DecafContext_get_fatal_error(ctx) != NULL);
+
+    ck_assert (DecafContext_compile_string(ctx, valid));
+    ck_assert (ctx->arena->head == chunk);
+    DecafContext_free(ctx);
+}
+END_TEST
+
+/*
+ * A lexical error takes precedence over an earlier syntax error, even though
+ * tokens are only lexed as the parser needs them
+ */
+START_TEST (lexical_error_precedence)
+{
+    DecafContext* ctx = DecafContext_new(ALL_ERRORS);
+    ck_assert (!DecafContext_compile_string(ctx, "def int main() { return 1 && ; }\n\"bad"));
+    ck_assert (strcmp(DecafContext_get_fatal_error(ctx), "Invalid token on line 2: \"\"bad\"\n") == 0);
+    ck_assert (!DecafContext_compile_string(ctx, "def int main() { return 1 && ; }"));
+    ck_assert (strncmp(DecafContext_get_fatal_error(ctx), "Invalid base expression", 23) == 0);
+    DecafContext_free(ctx);
+}
+END_TEST
+
+/*
+ * The TSV symbol dump should have one line per symbol with its scope
+ */
+START_TEST (symbols_tsv_format)
+{
+    DecafContext* ctx = DecafContext_new(ALL_ERRORS);
+    ck_assert (DecafContext_compile_string(ctx, "int a[3];\ndef int main() { bool b; return 0; }"));
+    FILE* output = tmpfile();
+    NodeVisitor_traverse_and_free(PrintSymbolsVisitor_new_with_format(output, TSV_SYMBOLS),
+                                  DecafContext_get_tree(ctx));
+    char text[1024];
+    size_t len = (size_t)ftell(output);
+    rewind(output);
+    ck_assert (len < sizeof(text));
+    text[fread(text, 1, len, output)] = '\0';
+    fclose(output);
+    ck_assert (strstr(text, "0\tprogram\t1\ta\tarray\tint\t3\t-\tnone\t0\n") != NULL);
+    ck_assert (strstr(text, "0\tprogram\t1\tprint_int\tfunction\tvoid\t1\tint\tnone\t0\n") != NULL);
+    ck_assert (strstr(text, "2\tblock\t2\tb\tscalar\tbool\t1\t-\tnone\t0\n") != NULL);
+    DecafContext_free(ctx);
+}
+END_TEST
+
+/*
+ * Write the DOT graph of a tree into a buffer
+ */
+static void write_dot (ASTNode* tree, char* text, size_t size)
+{
+    FILE* output = tmpfile();
+    NodeVisitor_traverse_and_free(GenerateASTGraph_new(output), tree);
+    size_t len = (size_t)ftell(output);
+    rewind(output);
+    ck_assert (len < size);
+    text[fread(text, 1, len, output)] = '\0';
+    fclose(output);
+}
+
+/*
+ * DOT node IDs are numbered from 0 in every graph, regardless of how many
+ * graphs were generated before
+ */
+START_TEST (dot_ids_per_graph)
+{
+    DecafContext* ctx = DecafContext_new(ALL_ERRORS);
+    ck_assert (DecafContext_compile_string(ctx, "def int main() { return 1 + 2; }"));
+    char first[4096], second[4096];
+    write_dot(DecafContext_get_tree(ctx), first, sizeof(first));
+    write_dot(DecafContext_get_tree(ctx), second, sizeof(second));
+    ck_assert (strstr(first, "\n0 [shape=box, label=\"Program") != NULL);
+    ck_assert (strcmp(first, second) == 0);
+    DecafContext_free(ctx);
+}
+END_TEST
 
 #endif
 
@@ -66,6 +288,29 @@ void public_tests (Suite *s)
 
     // added
     TEST(type_mismatch_expression);
+    TEST(shadowed_global_many);
+    TEST(dup_var_local);
+    TEST(folded_index_too_large);
+    TEST(folded_index_negative);
+    TEST(folded_index_in_bounds);
+    TEST(call_no_arguments);
+    TEST(call_too_few_arguments);
+    TEST(call_undefined);
+    TEST(call_variable);
+    TEST(undefined_array_assign);
+    TEST(undefined_array_read);
+    TEST(nested_shadowing);
+    TEST(nested_shadowing_restored);
+    TEST(call_second_argument);
+    TEST(incremental_reanalysis);
+    TEST(binary_ast_round_trip);
+    TEST(deferred_error_modes);
+    TEST(parallel_analysis_order);
+    TEST(parallel_analysis_loop_state);
+    TEST(context_reuse);
+    TEST(lexical_error_precedence);
+    TEST(symbols_tsv_format);
+    TEST(dot_ids_per_graph);
 
     suite_add_tcase (s, tc);
 }
@@ -1,13 +1,9 @@
 #include "testsuite.h"
 
-jmp_buf decaf_error;
-
-void Error_throw_printf (const char* format, ...)
-{
-    longjmp(decaf_error, 1);
-}
-
-ErrorList* run_analysis (char* text)
+/*
+ * run the front end and set up symbol tables (returns NULL on error)
+ */
+static ASTNode* build_tree (char* text)
 {
     ASTNode* tree = NULL;
     if (setjmp(decaf_error) == 0) {
@@ -17,10 +13,83 @@ ErrorList* run_analysis (char* text)
         /* error; return NULL */
         return NULL;
     }
-    NodeVisitor_traverse_and_free(SetParentVisitor_new(), tree);
-    NodeVisitor_traverse_and_free(CalcDepthVisitor_new(), tree);
-    NodeVisitor_traverse_and_free(BuildSymbolTablesVisitor_new(), tree);
-    return analyze(tree);
+    NodeVisitor* setup = CompositeVisitor_new();
+    CompositeVisitor_add(setup, SetParentVisitor_new());
+    CompositeVisitor_add(setup, CalcDepthVisitor_new());
+    CompositeVisitor_add(setup, BuildSymbolTablesVisitor_new());
+    NodeVisitor_traverse_and_free(setup, tree);
+    return tree;
+}
+
+ErrorList* run_analysis (char* text)
+{
+    return run_analysis_with_mode(text, ALL_ERRORS);
+}
+
+ErrorList* run_analysis_with_mode (char* text, ErrorMode mode)
+{
+    ASTNode* tree = build_tree(text);
+    return (tree == NULL ? NULL : analyze_with_mode(tree, mode));
+}
+
+ErrorList* run_incremental_analysis (char* text, AnalysisCache* cache)
+{
+    ASTNode* tree = build_tree(text);
+    return (tree == NULL ? NULL : analyze_incremental(tree, cache));
+}
+
+ErrorList* run_parallel_analysis (char* text, int num_threads)
+{
+    ASTNode* tree = build_tree(text);
+    return (tree == NULL ? NULL : analyze_parallel(tree, num_threads, ALL_ERRORS));
+}
+
+/*
+ * read the entire contents of a temporary file (returns a heap buffer)
+ */
+static char* read_back (FILE* file, size_t* length)
+{
+    *length = (size_t)ftell(file);
+    rewind(file);
+    char* data = (char*)malloc(*length + 1);
+    CHECK_MALLOC_PTR(data)
+    *length = fread(data, 1, *length, file);
+    data[*length] = '\0';
+    fclose(file);
+    return data;
+}
+
+bool binary_round_trip (char* text)
+{
+    ASTNode* tree = build_tree(text);
+    if (tree == NULL || !ErrorList_is_empty(analyze(tree))) {
+        return false;
+    }
+    FILE* expected = tmpfile();
+    FILE* binary = tmpfile();
+    NodeVisitor_traverse_and_free(PrintSymbolsVisitor_new(expected), tree);
+    bool written = ASTNode_write_binary(tree, binary);
+
+    size_t expected_len, binary_len;
+    char* expected_text = read_back(expected, &expected_len);
+    char* data = read_back(binary, &binary_len);
+    ASTNode* copy = ASTNode_decode_binary(data, binary_len);
+    bool truncated_rejected = (ASTNode_decode_binary(data, binary_len - 1) == NULL);
+    free(data);
+    if (!written || copy == NULL) {
+        free(expected_text);
+        return false;
+    }
+
+    FILE* actual = tmpfile();
+    NodeVisitor_traverse_and_free(PrintSymbolsVisitor_new(actual), copy);
+    size_t actual_len;
+    char* actual_text = read_back(actual, &actual_len);
+    bool same = (actual_len == expected_len && strcmp(actual_text, expected_text) == 0);
+    free(expected_text);
+    free(actual_text);
+    ASTNode_free(copy);
+    return same && truncated_rejected;
 }
 
 bool valid_program (char* text)
@@ -15,6 +15,8 @@
 #include "p1-lexer.h"
 #include "p2-parser.h"
 #include "p3-analysis.h"
+#include "serialize.h"
+#include "decaf.h"
 
 /**
  * @brief Define a test case with a valid program
@@ -57,6 +59,43 @@ END_TEST
  */
 ErrorList* run_analysis (char* text);
 
+/**
+ * @brief Run lexer, parser, and analysis on given text, recording errors in
+ * the given mode
+ *
+ * @param text Code to lex, parse, and analyze
+ * @param mode Which errors to record
+ * @returns List of errors or @c NULL if there was an error in the front end
+ */
+ErrorList* run_analysis_with_mode (char* text, ErrorMode mode);
+
+/**
+ * @brief Run lexer, parser, and incremental analysis on given text
+ *
+ * @param text Code to lex, parse, and analyze
+ * @param cache Results of previous analyses (updated)
+ * @returns List of errors or @c NULL if there was an error in the front end
+ */
+ErrorList* run_incremental_analysis (char* text, AnalysisCache* cache);
+
+/**
+ * @brief Run lexer, parser, and parallel analysis on given text
+ *
+ * @param text Code to lex, parse, and analyze
+ * @param num_threads Maximum number of analysis threads
+ * @returns List of errors or @c NULL if there was an error in the front end
+ */
+ErrorList* run_parallel_analysis (char* text, int num_threads);
+
+/**
+ * @brief Analyze given text, save the AST in binary format, and reload it
+ *
+ * @param text Code to lex, parse, and analyze (must be error-free)
+ * @returns True if and only if the reloaded AST prints the same symbol tables
+ * as the original and a truncated copy of the saved data is rejected
+ */
+bool binary_round_trip (char* text);
+
 /**
  * @brief Run lexer and parser on given text and verify that it throws an exception.
  *